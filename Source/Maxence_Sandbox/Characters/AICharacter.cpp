@@ -2,12 +2,21 @@
 
 
 #include "AICharacter.h"
+#include "Characters/Components/TargetableComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Gamemodes/SandboxAssets.h"
 
 // Sets default values
 AAICharacter::AAICharacter()
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Per-target work runs in the targeting subsystem batched tick. Blueprints with an Event Tick still turn it back on.
+	PrimaryActorTick.bCanEverTick = false;
+
+	Targetable = CreateDefaultSubobject<UTargetableComponent>(TEXT("Targetable"));
+
+	// Animation rate is also throttled by screen size on top of the significance levels.
+	GetMesh()->bEnableUpdateRateOptimizations = true;
 
 }
 
@@ -15,20 +24,38 @@ AAICharacter::AAICharacter()
 void AAICharacter::BeginPlay()
 {
 	Super::BeginPlay();
-	
 }
 
-// Called every frame
-void AAICharacter::Tick(float DeltaTime)
+// Called to bind functionality to input
+void AAICharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
-	Super::Tick(DeltaTime);
+	Super::SetupPlayerInputComponent(PlayerInputComponent);
 
 }
 
-// Called to bind functionality to input
-void AAICharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
+// Called by the targeting subsystem when the significance level of the character changes
+void AAICharacter::ApplySignificance(const FTargetSignificanceLevel& Level)
 {
-	Super::SetupPlayerInputComponent(PlayerInputComponent);
+	SetActorTickInterval(Level.TickInterval);
+	GetCharacterMovement()->SetComponentTickInterval(Level.MovementTickInterval);
+	GetMesh()->SetComponentTickInterval(Level.AnimTickInterval);
+	GetMesh()->SetForcedLOD(Level.ForcedLOD);
+}
 
+// Called by the target pool when the character is reused
+void AAICharacter::OnAcquiredFromPool()
+{
+	GetCharacterMovement()->SetDefaultMovementMode();
 }
 
+// Called by the target pool when the character is put back
+void AAICharacter::OnReleasedToPool()
+{
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+}
+
+FPrimaryAssetId AAICharacter::GetPrimaryAssetId() const
+{
+	return FSandboxAssets::GetBlueprintAssetId(this, FSandboxAssets::EnemyType);
+}
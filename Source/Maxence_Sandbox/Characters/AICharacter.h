@@ -20,11 +20,22 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	/** Registers the actor as a lock-on target. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Targeting")
+		class UTargetableComponent* Targetable;
 
+public:	
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	// Called by the targeting subsystem when the significance level of the character changes
+	virtual void ApplySignificance(const FTargetSignificanceLevel& Level) override;
+
+	// Called by the target pool when the character is reused and when it is put back
+	virtual void OnAcquiredFromPool() override;
+	virtual void OnReleasedToPool() override;
+
+	// Blueprints of the character are Enemy primary assets, preloaded while the map loads
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+
 };
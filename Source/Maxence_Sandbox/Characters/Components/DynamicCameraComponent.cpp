@@ -2,20 +2,73 @@
 
 
 #include "DynamicCameraComponent.h"
+#include "DynamicCameraStates.h"
 
 #include <Camera/CameraComponent.h>
+#include <GameFramework/PlayerController.h>
+#include <GameFramework/Pawn.h>
+#include <GameFramework/Character.h>
+#include <GameFramework/CharacterMovementComponent.h>
 #include <GameFramework/SpringArmComponent.h>
 #include <Components/SphereComponent.h>
 #include <Characters/Interfaces/Targetable.h>
+#include <Characters/Components/TargetableComponent.h>
+#include <Targeting/TargetingSubsystem.h>
+#include <Targeting/TargetingBudget.h>
+#include <Targeting/TargetingStats.h>
 
 #include <Runtime/Engine/Classes/Kismet/KismetMathLibrary.h>
 #include <Runtime/Engine/Classes/Kismet/GameplayStatics.h>
+#include <Net/UnrealNetwork.h>
+#include <Misc/ScopeExit.h>
 
 #include <Characters/Maxence_SandboxCharacter.h>
+#include <Components/SkeletalMeshComponent.h>
+#include <Engine/SkeletalMeshSocket.h>
 
 #include <typeinfo>
 #include <typeindex>
 
+DECLARE_CYCLE_STAT(TEXT("Tick"), STAT_DynamicCamera_Tick, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Gather candidates"), STAT_DynamicCamera_GatherCandidates, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Object enters range"), STAT_DynamicCamera_OnObjectEntersRange, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Object leaves range"), STAT_DynamicCamera_OnObjectLeavesRange, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Target removed"), STAT_DynamicCamera_OnTargetRemoved, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Reset camera"), STAT_DynamicCamera_ResetCamera, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Set mode free"), STAT_DynamicCamera_SetModeFree, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Set mode locked"), STAT_DynamicCamera_SetModeLocked, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Do action locked"), STAT_DynamicCamera_DoActionLocked, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Do action free"), STAT_DynamicCamera_DoActionFree, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Navigate targets"), STAT_DynamicCamera_NavigateTargets, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Target closest angle"), STAT_DynamicCamera_TargetClosestAngle, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Resolve pending selection"), STAT_DynamicCamera_ResolvePendingSelection, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Cluster pass"), STAT_DynamicCamera_ClusterPass, STATGROUP_DynamicCamera);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Look-at cache misses"), STAT_DynamicCamera_LookAtCacheMisses, STATGROUP_DynamicCamera);
+DECLARE_CYCLE_STAT(TEXT("Target selection"), STAT_TargetingSelection, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lock requests rejected"), STAT_TargetingLockRejected, STATGROUP_Targeting);
+
+DECLARE_CYCLE_STAT(TEXT("Arm probe"), STAT_DynamicCamera_ArmProbe, STATGROUP_DynamicCamera);
+
+static TAutoConsoleVariable<int32> CVarAsyncProbe(
+	TEXT("DynamicCamera.AsyncProbe"),
+	1,
+	TEXT("1: cameras with bAsyncCollisionProbe sweep their arm asynchronously and predict its length (default).\n")
+	TEXT("0: every camera runs the synchronous spring arm sweep."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarAsyncSolver(
+	TEXT("DynamicCamera.AsyncSolver"),
+	1,
+	TEXT("1: the camera state math is solved on a task graph worker from a snapshot taken after the owner movement (default).\n")
+	TEXT("0: it is solved in the camera tick."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarLockRangeTolerance(
+	TEXT("Targeting.Net.LockRangeTolerance"),
+	1.1f,
+	TEXT("Scale of the selection range the server accepts client locks in, to absorb the client being ahead of the server."),
+	ECVF_Default);
+
 // Sets default values
 UDynamicCameraComponent::UDynamicCameraComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
@@ -48,6 +101,14 @@ UDynamicCameraComponent::UDynamicCameraComponent(const FObjectInitializer& Objec
 
 	PrimaryComponentTick.bCanEverTick = true;
 	PrimaryComponentTick.TickInterval = 0.0f;
+
+	// The spring arm ticks post physics: the solve overlaps the physics frame.
+	SolverTickFunction.bCanEverTick = true;
+	SolverTickFunction.bStartWithTickEnabled = true;
+	SolverTickFunction.TickGroup = TG_PrePhysics;
+
+	// Only the lock state replicates, and only when the server validated a change.
+	bReplicates = true;
 	YAxisDirection = 1;
 
 	ResetCameraRate = 1.f;
@@ -77,6 +138,22 @@ void UDynamicCameraComponent::BeginPlay()
 
 	CameraRangeSphere->SetSphereRadius(MinimumRangeToSelect);
 
+	TargetingSubsystem = UTargetingSubsystem::Get(this);
+	UpdateCandidateSource();
+
+	OwnerPlayer = Cast<AMaxence_SandboxCharacter>(GetOwner());
+	if (USkeletalMeshComponent* mesh = OwnerPlayer ? OwnerPlayer->GetMesh() : nullptr)
+	{
+		ResolveLookAtBone();
+		mesh->OnBoneTransformsFinalized.AddDynamic(this, &UDynamicCameraComponent::OnOwnerBoneTransformsFinalized);
+	}
+
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->RegisterCamera(this);
+		TargetRemovedHandle = TargetingSubsystem->OnTargetRemoved.AddUObject(this, &UDynamicCameraComponent::OnTargetRemoved);
+	}
+
 	SetModeFree(CameraStates::CVOID);
 }
 
@@ -84,6 +161,43 @@ void UDynamicCameraComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
 	Super::EndPlay(EndPlayReason);
 
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->UnregisterCamera(this);
+		TargetingSubsystem->OnTargetRemoved.Remove(TargetRemovedHandle);
+	}
+
+	if (USkeletalMeshComponent* mesh = OwnerPlayer ? OwnerPlayer->GetMesh() : nullptr)
+	{
+		mesh->OnBoneTransformsFinalized.RemoveDynamic(this, &UDynamicCameraComponent::OnOwnerBoneTransformsFinalized);
+	}
+	OwnerPlayer = nullptr;
+	bLookAtCached = false;
+
+	// Release the targets the server locked for a remote owner.
+	APawn* pawn = Cast<APawn>(GetOwner());
+	if (GetOwnerRole() == ROLE_Authority && IsValid(LockState.Target) && pawn && !pawn->IsLocallyControlled())
+	{
+		ToggleTargetLock(LockState.Target, false);
+	}
+	LockState = FReplicatedLockState();
+	RequestedLockTarget.Reset();
+	CurrentTarget.Reset();
+
+	VisibilityBatch.Cancel();
+	VisibilityCache.Reset();
+	AngularRing.Reset();
+	Clusters.Reset();
+	ClusterPool.Reset();
+	Candidates.Reset();
+	SharedViewId = INDEX_NONE;
+	CollisionProbe.Reset();
+	ProbedArmLength = -1.f;
+	Solver.Reset();
+
+	CurrentState = CameraStates::CVOID;
+	bDormant = false;
+
 	CameraRangeSphere->SetSphereRadius(MinimumRangeToSelect);
 	CameraRangeSphere->OnComponentBeginOverlap.RemoveDynamic(this, &UDynamicCameraComponent::OnObjectEntersRange);
 	CameraRangeSphere->OnComponentEndOverlap.RemoveDynamic(this, &UDynamicCameraComponent::OnObjectLeavesRange);
@@ -92,46 +206,494 @@ void UDynamicCameraComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 // Called every frame
 void UDynamicCameraComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction * ThisTickFunction)
 {
-	DoActionCamera.ExecuteIfBound();
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_Tick);
+
+#if DYNAMIC_CAMERA_PROFILING
+	const uint32 startCycles = FPlatformTime::Cycles();
+	ON_SCOPE_EXIT { LastTickCycles = FPlatformTime::Cycles() - startCycles; };
+#endif
+
+	// The spring arm still has to follow the character while the state machine sleeps.
+	if (UpdateDormancy())
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	{
+		FTargetingBudget::FScope budgetScope;
+
+		if (TargetLocked || bNavigateOnlyVisible)
+		{
+			GatherCandidates();
+		}
+
+		CSV_CUSTOM_STAT(DynamicCamera, Candidates, ObjectsInRange.Num(), ECsvCustomStatOp::Set);
+
+		if (bNavigateOnlyVisible)
+		{
+			// A shared view refreshes its cache once per frame for all its cameras.
+			const bool bShared = SharedViewId != INDEX_NONE && TargetingSubsystem->GetSharedViews().UpdateVisibility(SharedViewId, GetWorld()) != nullptr;
+			if (!bShared)
+			{
+				VisibilityCache.Update(GetWorld(), GetVisibilityEye(), ObjectsInRange);
+			}
+		}
+
+		// Keeping the ring repaired every frame keeps each repair close to O(n). Over budget it is repaired less often,
+		// navigation still sorts it before walking it. Hordes navigate by cluster instead, kept up to date the same way.
+		if (TargetLocked && FTargetingBudget::ShouldSortRing(GFrameCounter))
+		{
+			if (FTargetClusters::ShouldCluster(ObjectsInRange.Num()))
+				Clusters.Update(ObjectsInRange);
+			else
+				AngularRing.Update(GetComponentLocation(), ObjectsInRange);
+		}
+
+		if (PendingSelection != EPendingTargetSelection::None && VisibilityBatch.IsReady())
+		{
+			ResolvePendingSelection();
+		}
+	}
+
+	VisitCameraState(CurrentState, [this, DeltaTime](auto State) { State.Tick(*this, DeltaTime); });
 
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 }
 
+void FDynamicCameraSolverTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && !Target->IsPendingKill() && (TickType != LEVELTICK_ViewportsOnly || Target->bTickInEditor))
+	{
+		Target->DispatchSolver();
+	}
+}
+
+FString FDynamicCameraSolverTickFunction::DiagnosticMessage()
+{
+	return Target ? Target->GetFullName() + TEXT("[DispatchSolver]") : TEXT("DynamicCameraSolverTick");
+}
+
+void UDynamicCameraComponent::RegisterComponentTickFunctions(bool bRegister)
+{
+	Super::RegisterComponentTickFunctions(bRegister);
+
+	if (bRegister)
+	{
+		if (SetupActorComponentTickFunction(&SolverTickFunction))
+		{
+			SolverTickFunction.Target = this;
+
+			// The snapshot reads this frame's owner location.
+			const ACharacter* character = Cast<ACharacter>(GetOwner());
+			if (UCharacterMovementComponent* movement = character ? character->GetCharacterMovement() : nullptr)
+			{
+				SolverTickFunction.AddPrerequisite(movement, movement->PrimaryComponentTick);
+			}
+		}
+	}
+	else if (SolverTickFunction.IsTickFunctionRegistered())
+	{
+		SolverTickFunction.UnRegisterTickFunction();
+	}
+}
+
+void UDynamicCameraComponent::DispatchSolver()
+{
+	if (CVarAsyncSolver.GetValueOnGameThread() == 0 || bDormant)
+		return;
+
+	// Same early outs as the state ticks, they are decided again on the game thread when applying.
+	const bool bLocked = CurrentState == CameraStates::LOCKED;
+	if (CurrentState == CameraStates::CVOID || (bLocked && (!TargetLocked || ObjectsInRange.Num() == 0 || GetCurrentTarget() == nullptr)))
+		return;
+
+	FDynamicCameraSolverInput input;
+	SnapshotSolverInput(input, bLocked, GetWorld()->GetDeltaSeconds());
+	Solver.Dispatch(input);
+}
+
+void UDynamicCameraComponent::SnapshotSolverInput(FDynamicCameraSolverInput& Input, bool bLocked, float DeltaTime) const
+{
+	const AActor* owner = GetOwner();
+	const AController* controller = owner ? owner->GetInstigatorController() : nullptr;
+
+	Input.Frame = GFrameCounter;
+	Input.DeltaTime = DeltaTime;
+	Input.bLocked = bLocked;
+	Input.Target = GetCurrentTarget();
+	Input.ControlRotation = controller ? controller->GetControlRotation() : FRotator::ZeroRotator;
+	Input.CameraLocation = Camera->GetComponentLocation();
+	Input.CameraRotation = Camera->GetComponentRotation();
+	Input.TargetArmLength = TargetArmLength;
+	Input.SocketOffset = SocketOffset;
+	Input.RotationInterpSpeed = RotationInterpSpeed;
+
+	Input.bTargetLocked = TargetLocked;
+	Input.MinPitch = MinPitchAngle;
+	Input.MaxPitch = MaxPitchAngle;
+	Input.MinPitchLocked = MinPitchAngleWhenLocked;
+	Input.MaxPitchLocked = MaxPitchAngleWhenLocked;
+
+	Input.bForceReset = ForceReset;
+	Input.bResetting = IsCameraReseting;
+	Input.ResetTime = ResetCurrentTime;
+
+	if (bLocked)
+	{
+		Input.AimPoint = GetTargetAimPoint(Input.Target);
+		return;
+	}
+
+	Input.DistanceUnlocked = DistanceCameraWhenUnlocked;
+	Input.PositionOffsetFree = PositionOffsetFree;
+	Input.TimeBeforeReset = TimeBeforeReset;
+	Input.CosFacingAngleNotResetting = FMath::Cos(FacingAngleNotReseting);
+	Input.ResetRate = ResetCameraRate;
+	Input.ArmLocation = GetComponentLocation();
+
+	if (OwnerPlayer)
+	{
+		Input.OwnerForward = OwnerPlayer->GetActorForwardVector();
+		Input.OwnerYaw = OwnerPlayer->GetActorRotation().Yaw;
+		Input.LookAtLocation = GetLookAtLocation();
+	}
+}
+
+void UDynamicCameraComponent::ResolveLookAtBone()
+{
+	const USkeletalMeshComponent* mesh = OwnerPlayer ? OwnerPlayer->GetMesh() : nullptr;
+
+	LookAtBoneIndex = INDEX_NONE;
+	LookAtSocketOffset = FTransform::Identity;
+	ResolvedLookAtBone = LookAtCameraBone;
+	ResolvedLookAtMesh = mesh ? mesh->SkeletalMesh : nullptr;
+	bLookAtCached = false;
+
+	if (ResolvedLookAtMesh == nullptr)
+		return;
+
+	// Same lookup as GetSocketLocation: a socket first, then a bone.
+	if (const USkeletalMeshSocket* socket = mesh->GetSocketByName(LookAtCameraBone))
+	{
+		LookAtBoneIndex = mesh->GetBoneIndex(socket->BoneName);
+		LookAtSocketOffset = FTransform(socket->RelativeRotation, socket->RelativeLocation, socket->RelativeScale);
+	}
+	else
+	{
+		LookAtBoneIndex = mesh->GetBoneIndex(LookAtCameraBone);
+	}
+}
+
+void UDynamicCameraComponent::OnOwnerBoneTransformsFinalized()
+{
+	const USkeletalMeshComponent* mesh = OwnerPlayer ? OwnerPlayer->GetMesh() : nullptr;
+	if (mesh == nullptr)
+		return;
+
+	if (mesh->SkeletalMesh != ResolvedLookAtMesh || LookAtCameraBone != ResolvedLookAtBone)
+	{
+		ResolveLookAtBone();
+	}
+
+	// Called on the game thread once the evaluation landed: reading the pose here never waits on the animation tasks.
+	const TArray<FTransform>& componentSpace = mesh->GetComponentSpaceTransforms();
+	bLookAtCached = componentSpace.IsValidIndex(LookAtBoneIndex);
+	if (bLookAtCached)
+	{
+		LookAtComponentLocation = (LookAtSocketOffset * componentSpace[LookAtBoneIndex]).GetLocation();
+	}
+}
+
+FVector UDynamicCameraComponent::GetLookAtLocation() const
+{
+	const USkeletalMeshComponent* mesh = OwnerPlayer->GetMesh();
+
+	// The pose is the last evaluated one, the component transform is the current one, like a socket query.
+	if (bLookAtCached && LookAtCameraBone == ResolvedLookAtBone)
+		return mesh->GetComponentTransform().TransformPosition(LookAtComponentLocation);
+
+	INC_DWORD_STAT(STAT_DynamicCamera_LookAtCacheMisses);
+	return mesh->GetSocketLocation(LookAtCameraBone);
+}
+
+bool UDynamicCameraComponent::IsSolveCurrent(const FDynamicCameraSolverInput& Input) const
+{
+	const AActor* owner = GetOwner();
+	const AController* controller = owner ? owner->GetInstigatorController() : nullptr;
+	const FRotator controlRotation = controller ? controller->GetControlRotation() : FRotator::ZeroRotator;
+
+	return Input.Frame == GFrameCounter
+		&& Input.bLocked == (CurrentState == CameraStates::LOCKED)
+		&& Input.Target == GetCurrentTarget()
+		&& Input.bTargetLocked == TargetLocked
+		&& Input.ControlRotation == controlRotation
+		&& Input.TargetArmLength == TargetArmLength
+		&& Input.SocketOffset == SocketOffset
+		&& Input.bForceReset == ForceReset
+		&& Input.bResetting == IsCameraReseting
+		&& Input.ResetTime == ResetCurrentTime;
+}
+
+void UDynamicCameraComponent::SolveCameraState()
+{
+	const FDynamicCameraSolverInput* solvedInput = nullptr;
+	const FDynamicCameraSolverOutput* solved = Solver.Fetch(solvedInput);
+	if (solved && IsSolveCurrent(*solvedInput))
+	{
+		ApplySolverOutput(*solvedInput, *solved);
+		return;
+	}
+
+	// Nothing dispatched, or the state changed since the snapshot (transition, selection, reset request).
+	FDynamicCameraSolverInput input;
+	SnapshotSolverInput(input, CurrentState == CameraStates::LOCKED, GetWorld()->GetDeltaSeconds());
+	FDynamicCameraSolver::Solve(input, SyncSolverOutput);
+	ApplySolverOutput(input, SyncSolverOutput);
+}
+
+void UDynamicCameraComponent::ApplySolverOutput(const FDynamicCameraSolverInput& Input, const FDynamicCameraSolverOutput& Output)
+{
+	if (Input.bLocked)
+	{
+		GetOwner()->GetInstigatorController()->SetControlRotation(Output.ControlRotation);
+		return;
+	}
+
+	TargetArmLength = Output.TargetArmLength;
+	SocketOffset = Output.SocketOffset;
+	ApplyResetOutput(Output);
+}
+
+void UDynamicCameraComponent::ApplyResetOutput(const FDynamicCameraSolverOutput& Output)
+{
+	ForceReset = Output.bForceReset;
+	IsCameraReseting = Output.bResetting;
+	ResetCurrentTime = Output.ResetTime;
+	bResetSettled = Output.bResetSettled;
+
+	if (APawn* pawn = Cast<APawn>(GetOwner()))
+	{
+		pawn->AddControllerYawInput(Output.YawInput);
+		pawn->AddControllerPitchInput(Output.PitchInput);
+	}
+}
+
+void UDynamicCameraComponent::UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime)
+{
+	if (!bDoTrace || !bAsyncCollisionProbe || CVarAsyncProbe.GetValueOnGameThread() == 0 || TargetArmLength == 0.f)
+	{
+		CollisionProbe.Reset();
+		ProbedArmLength = -1.f;
+		Super::UpdateDesiredArmLocation(bDoTrace, bDoLocationLag, bDoRotationLag, DeltaTime);
+		return;
+	}
+
+	// Desired arm with the lags applied, without the synchronous sweep.
+	Super::UpdateDesiredArmLocation(false, bDoLocationLag, bDoRotationLag, DeltaTime);
+
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_ArmProbe);
+
+	const FVector armOrigin = PreviousArmOrigin;
+	const FVector desiredLocation = UnfixedCameraPosition;
+	const FVector arm = desiredLocation - armOrigin;
+	const float desiredLength = arm.Size();
+	if (desiredLength < KINDA_SMALL_NUMBER)
+		return;
+
+	const FVector armDirection = arm / desiredLength;
+
+	// The probe issued last frame has landed while this frame ran.
+	if (CollisionProbe.IsPending())
+	{
+		CollisionProbe.Resolve(GetWorld());
+	}
+
+	// A hit is one frame old: move it by the distance the character covered towards the camera since.
+	float predictedLength = desiredLength;
+	if (CollisionProbe.HasHit())
+	{
+		const float approach = FVector::DotProduct(GetOwner()->GetVelocity(), armDirection) * DeltaTime;
+		predictedLength = FMath::Clamp(CollisionProbe.GetClearFraction() * desiredLength - approach, 0.f, desiredLength);
+	}
+
+	// Pull in at once so the camera never goes through, ease back out.
+	ProbedArmLength = ProbedArmLength < 0.f || predictedLength < ProbedArmLength
+		? predictedLength
+		: FMath::FInterpTo(ProbedArmLength, predictedLength, DeltaTime, ProbeRecoverySpeed);
+
+	FDynamicCameraProbe::FSettings settings;
+	settings.Channel = ProbeChannel;
+	settings.ProbeSize = ProbeSize;
+	settings.NumRays = ProbeRays;
+	settings.Spread = ProbeSpread;
+	settings.SideWeight = ProbeSideWeight;
+	CollisionProbe.Issue(GetWorld(), armOrigin, desiredLocation, PreviousDesiredRot, GetOwner(), settings);
+
+	bIsCameraFixed = ProbedArmLength < desiredLength;
+	if (!bIsCameraFixed)
+		return;
+
+	// Same socket update as the spring arm, from the probed location.
+	const FTransform worldCameraTransform(PreviousDesiredRot, armOrigin + armDirection * ProbedArmLength);
+	const FTransform relativeCameraTransform = worldCameraTransform.GetRelativeTransform(GetComponentTransform());
+
+	RelativeSocketLocation = relativeCameraTransform.GetLocation();
+	RelativeSocketRotation = relativeCameraTransform.GetRotation();
+
+	UpdateChildTransforms();
+}
+
 
 #pragma region CAMERA
 
-void UDynamicCameraComponent::HandlingFinishedState(CameraStates PrevState)
+void UDynamicCameraComponent::TransitionTo(CameraStates NewState)
+{
+	if (NewState == CurrentState)
+		return;
+
+	VisitCameraState(CurrentState, [this](auto State) { State.Exit(*this); });
+	CurrentState = NewState;
+	VisitCameraState(CurrentState, [this](auto State) { State.Enter(*this); });
+
+	bDormant = false;
+}
+
+bool UDynamicCameraComponent::UpdateDormancy()
 {
-	switch (PrevState)
+	const AActor* owner = GetOwner();
+	const AController* controller = owner ? owner->GetInstigatorController() : nullptr;
+	const FRotator ownerRotation = owner ? owner->GetActorRotation() : FRotator::ZeroRotator;
+	const FRotator controlRotation = controller ? controller->GetControlRotation() : FRotator::ZeroRotator;
+
+	// A selection waiting on its visibility batch resolves on the next ticks, whatever the state.
+	// The idle check also catches Blueprint writes (reset, arm length, offset) made while dormant.
+	const bool bIdle = PendingSelection == EPendingTargetSelection::None
+		&& VisitCameraState(CurrentState, [this](auto State) { return State.IsIdle(*this); }, false);
+
+	if (bDormant)
 	{
-	case CameraStates::LOCKED:
-		EndModeLocked();
-		break;
-	case CameraStates::FREE:
-		EndModeFree();
-		UGameplayStatics::GetPlayerCameraManager(this, 0)->ViewPitchMax = MAX_FLT;
-		UGameplayStatics::GetPlayerCameraManager(this, 0)->ViewPitchMin = -MAX_FLT;
-		break;
-	default:
+		if (bIdle && ownerRotation.Equals(DormantOwnerRotation) && controlRotation.Equals(DormantControlRotation))
+			return true;
+
+		bDormant = false;
+		CSV_CUSTOM_STAT(DynamicCamera, Dormant, 0, ECsvCustomStatOp::Set);
+		return false;
+	}
+
+	if (!bIdle)
+		return false;
+
+	bDormant = true;
+	DormantOwnerRotation = ownerRotation;
+	DormantControlRotation = controlRotation;
+
+	// Nothing refreshes the cache while dormant: the next selection traces its candidates again.
+	VisibilityCache.Reset();
+	SharedViewId = INDEX_NONE;
+	CSV_CUSTOM_STAT(DynamicCamera, Dormant, 1, ECsvCustomStatOp::Set);
+	return true;
+}
+
+void UDynamicCameraComponent::UpdateCandidateSource()
+{
+	const bool bWantsSpatialIndex = TargetingSubsystem != nullptr && UTargetingSubsystem::IsSpatialIndexEnabled();
+	if (bWantsSpatialIndex == bUseSpatialIndex)
 		return;
+
+	bUseSpatialIndex = bWantsSpatialIndex;
+
+	// The sphere only costs overlap events while it can generate them.
+	CameraRangeSphere->SetGenerateOverlapEvents(!bUseSpatialIndex);
+	CameraRangeSphere->SetCollisionEnabled(bUseSpatialIndex ? ECollisionEnabled::NoCollision : ECollisionEnabled::QueryOnly);
+
+	Candidates.Reset();
+	if (!bUseSpatialIndex)
+	{
+		CameraRangeSphere->UpdateOverlaps();
 	}
 }
 
+void UDynamicCameraComponent::GatherCandidates()
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_GatherCandidates);
+
+	UpdateCandidateSource();
+
+	if (!bUseSpatialIndex)
+		return;
+
+	if (FTargetingSharedViews::IsEnabled())
+	{
+		SharedViewId = TargetingSubsystem->GetSharedViews().Gather(*TargetingSubsystem, GetVisibilityEye(), Camera->GetComponentLocation(), MinimumRangeToSelect, GetOwner(), ObjectsInRange);
+		CapCandidates();
+		Candidates.OnGathered();
+		return;
+	}
+
+	SharedViewId = INDEX_NONE;
+	ObjectsInRange.Reset();
+	TargetingSubsystem->QueryRadius(Camera->GetComponentLocation(), MinimumRangeToSelect, ObjectsInRange, GetOwner());
+	CapCandidates();
+	Candidates.OnGathered();
+}
+
+void UDynamicCameraComponent::CapCandidates()
+{
+	const int32 maxCandidates = FTargetingBudget::GetMaxCandidates();
+	if (maxCandidates <= 0 || ObjectsInRange.Num() <= maxCandidates)
+		return;
+
+	AActor* currentTarget = GetCurrentTarget();
+	const FVector origin = Camera->GetComponentLocation();
+
+	// The current target goes first whatever its distance, the camera keeps looking at it.
+	ObjectsInRange.Sort([currentTarget, &origin](const AActor& lhs, const AActor& rhs)
+	{
+		if (&lhs == currentTarget || &rhs == currentTarget)
+			return &lhs == currentTarget;
+
+		return FVector::DistSquared(origin, lhs.GetActorLocation()) < FVector::DistSquared(origin, rhs.GetActorLocation());
+	});
+	ObjectsInRange.SetNum(maxCandidates, false);
+}
+
+FTargetVisibilityCache& UDynamicCameraComponent::GetVisibilityCache()
+{
+	FTargetVisibilityCache* SharedCache = (TargetingSubsystem && SharedViewId != INDEX_NONE)
+		? TargetingSubsystem->GetSharedViews().FindVisibility(SharedViewId)
+		: nullptr;
+
+	return SharedCache ? *SharedCache : VisibilityCache;
+}
+
+APlayerCameraManager* UDynamicCameraComponent::GetOwnerCameraManager() const
+{
+	const APawn* pawn = Cast<APawn>(GetOwner());
+	const APlayerController* controller = pawn ? Cast<APlayerController>(pawn->GetController()) : nullptr;
+	return controller ? controller->PlayerCameraManager : nullptr;
+}
+
 void UDynamicCameraComponent::OnObjectEntersRange(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_OnObjectEntersRange);
+
 	// Other Actor is the actor that triggered the event. Check that is not ourself
-	if ((OtherActor != nullptr) && (OtherActor != GetOwner()) && (OtherComp != nullptr) && (Cast<ITargetable>(OtherActor)))
+	if ((OtherActor != nullptr) && (OtherActor != GetOwner()) && (OtherComp != nullptr) && IsTargetable(OtherActor) && !GetTargetHandle(OtherActor).IsNull())
 	{
-		ObjectsInRange.AddUnique(OtherActor);
+		// Counted per component: an actor with several colliders stays in range until the last one leaves.
+		Candidates.Add(OtherActor);
 	}
 }
 
 void UDynamicCameraComponent::OnObjectLeavesRange(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
 {
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_OnObjectLeavesRange);
+
 	// Other Actor is the actor that triggered the event. Check that is not ourself.  
-	if ((OtherActor != nullptr) && (OtherActor != GetOwner()) && (OtherComp != nullptr) && (ObjectsInRange.Contains(OtherActor)))
+	if ((OtherActor != nullptr) && (OtherActor != GetOwner()) && (OtherComp != nullptr))
 	{
-		ObjectsInRange.RemoveSingle(OtherActor);
+		Candidates.Remove(OtherActor);
 	}
 }
 
@@ -143,99 +705,76 @@ void UDynamicCameraComponent::PreventResetCamera(bool _HardStop)
 
 	ResetCurrentTime = 0;
 	IsCameraReseting = false;
+	bResetSettled = true;
 }
 
 void UDynamicCameraComponent::ResetCamera(float DeltaSeconds)
 {
-	AMaxence_SandboxCharacter* Player = Cast<AMaxence_SandboxCharacter>(GetOwner());
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_ResetCamera);
 
-	float angleBetweenForwards = FMath::Acos(FVector::DotProduct(Camera->GetForwardVector(), Player->GetActorForwardVector()));
-	if (!ForceReset)
-	{
-		if (FMath::Abs(angleBetweenForwards) > FacingAngleNotReseting)
-		{
-			PreventResetCamera(false);
-			return;
-		}
-		if (!IsCameraReseting)
-		{
-			ResetCurrentTime += DeltaSeconds;
-			if (ResetCurrentTime >= TimeBeforeReset)
-				IsCameraReseting = true;
-			return;
-		}
-	}
-
-	//if(Player->GetLocomotion()->GetRotationMode() == ELocomotionRotationMode::LRM_LookingDirection)
-	//	targetRotation = ((targetRotation + Player->GetLocomotion()->GetLookingRotation()) * 0.5f);
+	FDynamicCameraSolverInput input;
+	SnapshotSolverInput(input, false, DeltaSeconds);
 
-	FRotator targetRotation = UKismetMathLibrary::FindLookAtRotation(GetComponentLocation(), Player->GetMesh()->GetSocketLocation(LookAtCameraBone));
-	targetRotation.Yaw = Player->GetActorRotation().Yaw;
-
-	FRotator deltaRotation = UKismetMathLibrary::NormalizedDeltaRotator(targetRotation, Camera->GetComponentRotation());
-	Player->AddControllerYawInput(deltaRotation.Yaw * DeltaSeconds * ResetCameraRate);
-	Player->AddControllerPitchInput(deltaRotation.Pitch * DeltaSeconds * ResetCameraRate * -1.f);
-
-	// Stop camera reset when reset is complete
-	// TODO should add reset threshold ?
-	if (deltaRotation.IsNearlyZero(1.f))
-		PreventResetCamera(true);
+	FDynamicCameraSolverOutput output;
+	FDynamicCameraSolver::SolveReset(input, output);
+	ApplyResetOutput(output);
 }
 
 void UDynamicCameraComponent::SetModeFree(CameraStates PrevState)
 {
-	HandlingFinishedState(PrevState);
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_SetModeFree);
+
+	PendingSelection = EPendingTargetSelection::None;
+	VisibilityBatch.Cancel();
 
-	UGameplayStatics::GetPlayerCameraManager(this, 0)->ViewPitchMax = MaxPitchAngle;
-	UGameplayStatics::GetPlayerCameraManager(this, 0)->ViewPitchMin = MinPitchAngle;
+	CSV_CUSTOM_STAT(DynamicCamera, StateTransitions, 1, ECsvCustomStatOp::Accumulate);
 
-	DoActionCamera.BindUFunction(this, FName("DoActionFree"));
+	TransitionTo(CameraStates::FREE);
 
 	OnCameraChangeTarget.Broadcast(nullptr);
 	OnCameraUnlock.Broadcast();
 
-	CurrentTarget = nullptr;
+	CurrentTarget.Reset();
+
+	ReplicateLockState();
 }
 
 void UDynamicCameraComponent::SetModeLocked(CameraStates PrevState)
 {
-	HandlingFinishedState(PrevState);
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_SetModeLocked);
+	FTargetingBudget::FScope budgetScope;
+
+	GatherCandidates();
+
+	// The camera stays in its current mode until the visibility batch lands.
+	if (bNavigateOnlyVisible && RequestVisibility(EPendingTargetSelection::Lock, GetLockPool(MinimumRangeToSelect)))
+		return;
+
+	FinishSetModeLocked();
+}
+
+void UDynamicCameraComponent::FinishSetModeLocked()
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetingSelection);
 
 	ClosestTargetDistance = MinimumRangeToSelect;
 
-	float distance = 0.f;
 	AActor* newTarget = nullptr;
 
-	FHitResult HitInfos;
-
 	// Select target within range
-	for (AActor* actor : ObjectsInRange)
+	const TArray<AActor*>& pool = GetLockPool(MinimumRangeToSelect);
+	const int32 bestId = SelectBestCandidate(pool, MinimumRangeToSelect, nullptr);
+	if (bestId != INDEX_NONE)
 	{
-		
-		// Instant select valid target.
-		if (bNavigateOnlyVisible)
-		{
-			// Check visibility
-			if (GetWorld()->LineTraceSingleByChannel(HitInfos, Camera->GetComponentLocation() + NavigationRaycastOffset, actor->GetActorLocation(), ECollisionChannel::ECC_Visibility)
-				&& HitInfos.Actor.Get() != actor)
-			{
-				continue;
-			}
-		}
-
-		distance = GetOwner()->GetDistanceTo(actor);
-		if (distance < ClosestTargetDistance)
-		{
-			ClosestTargetDistance = distance;
-			newTarget = actor;
-			UE_LOG(LogTemp, Warning, TEXT("Distance from current Target: %f"), distance);
-		}
+		ClosestTargetDistance = ScoringKernel.GetDistance(bestId);
+		newTarget = pool[bestId];
 	}
 
 	if (newTarget != nullptr)
 	{
-		TargetLocked = true;
-		DoActionCamera.BindUFunction(this, FName("DoActionLocked"));
+		TransitionTo(CameraStates::LOCKED);
+
+		CSV_CUSTOM_STAT(DynamicCamera, StateTransitions, 1, ECsvCustomStatOp::Accumulate);
 
 		SetCurrentTarget(newTarget);
 	}
@@ -247,47 +786,46 @@ void UDynamicCameraComponent::SetModeLocked(CameraStates PrevState)
 
 void UDynamicCameraComponent::DoActionLocked()
 {
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_DoActionLocked);
+
 	if (!TargetLocked || ObjectsInRange.Num() == 0)
 	{
 		SetModeFree(CameraStates::LOCKED);
 		return;
 	}
 
-	AActor* owner = GetOwner();
-	check(owner != nullptr);
+	// The current target went away and its replacement waits on the visibility batch.
+	if (GetCurrentTarget() == nullptr)
+		return;
+
+	check(GetOwner() != nullptr);
 
 	//LockCameraPosition(SocketOffset, TargetArmLength);
 
-	FRotator newRotation = FRotator();
-	LookAt(newRotation);
-	owner->GetInstigatorController()->SetControlRotation(newRotation);
+	SolveCameraState();
 }
 
 void UDynamicCameraComponent::DoActionFree()
 {
-	// Update spring arm data
-	TargetArmLength = UKismetMathLibrary::FInterpTo(TargetArmLength, DistanceCameraWhenUnlocked, GetWorld()->GetDeltaSeconds(), RotationInterpSpeed);
-	SocketOffset = UKismetMathLibrary::VInterpTo(SocketOffset, PositionOffsetFree, GetWorld()->GetDeltaSeconds(), RotationInterpSpeed);
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_DoActionFree);
 
+	// Spring arm data and reset
 	//DynamicPositionning();
-	ResetCamera(GetWorld()->DeltaTimeSeconds);
+	SolveCameraState();
 }
 
 void UDynamicCameraComponent::EndModeFree()
 {
-	DoActionCamera.Unbind();
 }
 
 void UDynamicCameraComponent::EndModeLocked()
 {
-	DoActionCamera.Unbind();
-
-	if (IsValid(CurrentTarget))
+	if (AActor* currentTarget = GetCurrentTarget())
 	{
-		Cast<ITargetable>(CurrentTarget)->Execute_ToggleLock(CurrentTarget, false);
+		ToggleTargetLock(currentTarget, false);
 	}
 
-	CurrentTarget = nullptr;
+	CurrentTarget.Reset();
 	TargetLocked = false;
 }
 
@@ -298,6 +836,9 @@ void UDynamicCameraComponent::InvertYAxis(bool IsInverted)
 
 void UDynamicCameraComponent::NavigateTargets(float AxisValue)
 {
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_NavigateTargets);
+	FTargetingBudget::FScope budgetScope;
+
 	// Check threshold.
 	if (FMath::Abs(AxisValue) < NavigateThreshold)
 	{
@@ -310,195 +851,625 @@ void UDynamicCameraComponent::NavigateTargets(float AxisValue)
 	if (IncrementSign == prevNavIncrementSign)
 		return;
 
+	GatherCandidates();
+
 	if (ObjectsInRange.Num() <= 0)
 	{
 		SetModeFree(CameraStates::LOCKED);
 		return;
 	}
 
-	struct FSignedAngleSort
+	// Holding the stick does not issue a new batch every frame.
+	AActor* currentTarget = GetCurrentTarget();
+	const bool bClustered = currentTarget && FTargetClusters::ShouldCluster(ObjectsInRange.Num());
+	if (bNavigateOnlyVisible && RequestVisibility(EPendingTargetSelection::Navigate, bClustered ? GetNavigationPool(currentTarget, IncrementSign) : ObjectsInRange))
 	{
-		FVector ComponentLocation;
-		FVector TargetDir;
-
-		bool operator()(const AActor& lhs, const AActor& rhs) const
-		{
-			// Sort by singed angle.
+		PendingNavigationSign = IncrementSign;
+		prevNavIncrementSign = IncrementSign;
+		return;
+	}
 
-			FVector LhsDir = (lhs.GetActorLocation() - ComponentLocation).GetSafeNormal();
-			float LhsAngle = FMath::Acos(FVector::DotProduct(TargetDir, LhsDir)) * FMath::Sign(FVector::DotProduct(FVector::CrossProduct(LhsDir, TargetDir), FVector::UpVector));
+	FinishNavigateTargets(IncrementSign);
+}
 
-			FVector RhsDir = (rhs.GetActorLocation() - ComponentLocation).GetSafeNormal();
-			float RhsAngle = FMath::Acos(FVector::DotProduct(TargetDir, RhsDir)) * FMath::Sign(FVector::DotProduct(FVector::CrossProduct(RhsDir, TargetDir), FVector::UpVector));
+void UDynamicCameraComponent::FinishNavigateTargets(int IncrementSign)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetingSelection);
 
-			return LhsAngle > RhsAngle;
-		}
-	};
+	AActor* currentTarget = GetCurrentTarget();
+	if (currentTarget == nullptr || ObjectsInRange.Num() <= 0)
+		return;
 
-	ObjectsInRange.Sort(FSignedAngleSort{ GetComponentLocation(), (CurrentTarget->GetActorLocation() - GetComponentLocation()).GetSafeNormal() });
+	const bool bClustered = FTargetClusters::ShouldCluster(ObjectsInRange.Num());
+	const TArray<AActor*>* pool = nullptr;
+	int32 CurrTargetIndex = INDEX_NONE;
 
-	//TODO Maxence: instead of setting camera to free mode set CurrTargetIndex to 0 can be harzardous so do not do it for BETA build
-	int CurrTargetIndex = ObjectsInRange.Find(CurrentTarget);
-	if (CurrTargetIndex < 0)
+	if (bClustered)
 	{
-		SetModeFree(CameraStates::LOCKED);
-		return;
+		pool = &GetNavigationPool(currentTarget, IncrementSign);
 	}
+	else
+	{
+		AngularRing.Update(GetComponentLocation(), ObjectsInRange);
 
-	// Increment and clamp.
-	FHitResult HitInfos;
+		//TODO Maxence: instead of setting camera to free mode set CurrTargetIndex to 0 can be harzardous so do not do it for BETA build
+		CurrTargetIndex = AngularRing.IndexOf(currentTarget);
+		if (CurrTargetIndex == INDEX_NONE)
+		{
+			SetModeFree(CameraStates::LOCKED);
+			return;
+		}
+	}
 
-	int PrevTargetIndex = CurrTargetIndex;
-	int TargetIndex = CurrTargetIndex + IncrementSign;
-	FVector PrevTargetDir = (ObjectsInRange[PrevTargetIndex]->GetActorLocation() - GetComponentLocation()).GetSafeNormal();
+	// Walk the ring, or the cluster pool, from the current target.
+	AActor* NewTarget = nullptr;
+	FVector PrevTargetDir = (currentTarget->GetActorLocation() - GetComponentLocation()).GetSafeNormal();
+	const float CosMaxAngleNavigation = FMath::Cos(FMath::DegreesToRadians(MaxAngleNavigation));
 
-	for (; TargetIndex != CurrTargetIndex; TargetIndex += IncrementSign)
+	const int32 NumSteps = bClustered ? pool->Num() : AngularRing.Num() - 1;
+	for (int32 Step = 0; Step < NumSteps; ++Step)
 	{
-		// Clamp.
-		if (TargetIndex < 0)
-			TargetIndex = ObjectsInRange.Num() - 1;
-		else if (TargetIndex >= ObjectsInRange.Num())
-			TargetIndex = 0;
-
-		if (ObjectsInRange[TargetIndex] == CurrentTarget)
-			break;
-
+		AActor* Candidate = bClustered ? (*pool)[Step] : AngularRing.GetNeighbour(CurrTargetIndex, (Step + 1) * IncrementSign);
+		if (!IsValid(Candidate))
+			continue;
 
 		if (!bCyclicNavigation)
 		{
 			// Min or max reached.
-			FVector TargetDir = (ObjectsInRange[TargetIndex]->GetActorLocation() - GetComponentLocation()).GetSafeNormal();
+			FVector TargetDir = (Candidate->GetActorLocation() - GetComponentLocation()).GetSafeNormal();
 
-			if (FMath::RadiansToDegrees(FMath::Acos(FVector::DotProduct(PrevTargetDir, TargetDir))) >= MaxAngleNavigation)
+			if (FVector::DotProduct(PrevTargetDir, TargetDir) <= CosMaxAngleNavigation)
 				return;
 
 			PrevTargetDir = TargetDir;
 		}
 
-		// Instant select valid target.
-		if (!bNavigateOnlyVisible)
-			break;
-
-		// Check visiiblity: break on first no hit.
-		if (!GetWorld()->LineTraceSingleByChannel(HitInfos, Camera->GetComponentLocation() + NavigationRaycastOffset, ObjectsInRange[TargetIndex]->GetActorLocation(), ECollisionChannel::ECC_Visibility)
-			|| HitInfos.Actor.Get() == ObjectsInRange[TargetIndex])
+		// Instant select valid target, or first visible.
+		if (!bNavigateOnlyVisible || GetVisibilityCache().IsVisible(Candidate))
 		{
+			NewTarget = Candidate;
 			break;
 		}
 	}
 
-	if (TargetIndex == CurrTargetIndex)
+	if (NewTarget == nullptr)
 		return;
 
-	CurrTargetIndex = TargetIndex;
 	prevNavIncrementSign = IncrementSign;
 
-	SetCurrentTarget(ObjectsInRange[CurrTargetIndex]);
+	SetCurrentTarget(NewTarget);
 }
 
 void UDynamicCameraComponent::TargetClosestAngle()
 {
-	FHitResult HitInfos;
-	int bestId = -1;
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_TargetClosestAngle);
+	FTargetingBudget::FScope budgetScope;
 
-	float bestDistance = autoLockedDistance;
-	for (int targetId = 0; targetId < ObjectsInRange.Num(); ++targetId)
-	{
-		if (ObjectsInRange[targetId] == CurrentTarget)
-			continue;
+	GatherCandidates();
 
-		// Instant select valid target.
-		if (bNavigateOnlyVisible)
-		{
-			// Check visibility
-			if (GetWorld()->LineTraceSingleByChannel(HitInfos, Camera->GetComponentLocation() + NavigationRaycastOffset, ObjectsInRange[targetId]->GetActorLocation(), ECollisionChannel::ECC_Visibility)
-				&& HitInfos.Actor.Get() != ObjectsInRange[targetId])
-			{
-				continue;
-			}
-		}
+	if (bNavigateOnlyVisible && RequestVisibility(EPendingTargetSelection::ClosestAngle, GetLockPool(autoLockedDistance)))
+		return;
 
-		float dist = GetOwner()->GetDistanceTo(ObjectsInRange[targetId]);
-		if (dist < bestDistance)
-		{
-			bestDistance = dist;
-			bestId = targetId;
-		}
+	FinishTargetClosestAngle();
+}
+
+void UDynamicCameraComponent::FinishTargetClosestAngle(bool bScoreAll)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetingSelection);
+
+	const TArray<AActor*>& pool = bScoreAll ? ObjectsInRange : GetLockPool(autoLockedDistance);
+	const int32 bestId = SelectBestCandidate(pool, autoLockedDistance, GetCurrentTarget());
+
+	// The best clusters may only hold the current target: score every candidate before giving up,
+	// once the ones the first visibility batch skipped are traced.
+	if (bestId == INDEX_NONE && &pool != &ObjectsInRange)
+	{
+		if (bNavigateOnlyVisible && RequestVisibility(EPendingTargetSelection::ClosestAngleAll, ObjectsInRange))
+			return;
+
+		FinishTargetClosestAngle(true);
+		return;
 	}
 
 	// No visible target: unlock.
-	if (bestId >= 0 && bestId < ObjectsInRange.Num())
-		SetCurrentTarget(ObjectsInRange[bestId]);
+	if (bestId >= 0 && bestId < pool.Num())
+		SetCurrentTarget(pool[bestId]);
 	else
 		SetCurrentTarget(nullptr);
 }
 
+bool UDynamicCameraComponent::RequestVisibility(EPendingTargetSelection Selection, const TArray<AActor*>& Pool)
+{
+	FTargetVisibilityCache& visibilityCache = GetVisibilityCache();
+
+	TArray<AActor*> UnknownTargets;
+	visibilityCache.GetUnknown(Pool, UnknownTargets);
+
+	if (UnknownTargets.Num() == 0)
+		return false;
+
+	const FVector Eye = GetVisibilityEye();
+
+	if (!FTargetVisibilityBatch::IsEnabled())
+	{
+		for (AActor* Target : UnknownTargets)
+		{
+			visibilityCache.Store(Target, IsTargetVisible(Target), Eye, Target->GetActorLocation());
+		}
+		return false;
+	}
+
+	VisibilityBatch.Issue(GetWorld(), Eye, UnknownTargets);
+	PendingSelection = Selection;
+
+	return true;
+}
+
+void UDynamicCameraComponent::ResolvePendingSelection()
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_ResolvePendingSelection);
+	FTargetingBudget::FScope budgetScope;
+
+	const EPendingTargetSelection Selection = PendingSelection;
+	PendingSelection = EPendingTargetSelection::None;
+
+	FTargetVisibilityCache& visibilityCache = GetVisibilityCache();
+	VisibilityBatch.Resolve(GetWorld(), [&visibilityCache](AActor* Candidate, bool bVisible, const FVector& Start, const FVector& End)
+	{
+		visibilityCache.Store(Candidate, bVisible, Start, End);
+	});
+
+	// Candidates that entered range after the batch was issued count as occluded until the cache traces them.
+	switch (Selection)
+	{
+	case EPendingTargetSelection::Lock:
+		FinishSetModeLocked();
+		break;
+	case EPendingTargetSelection::Navigate:
+		if (TargetLocked)
+			FinishNavigateTargets(PendingNavigationSign);
+		break;
+	case EPendingTargetSelection::ClosestAngle:
+		if (TargetLocked)
+			FinishTargetClosestAngle();
+		break;
+	case EPendingTargetSelection::ClosestAngleAll:
+		if (TargetLocked)
+			FinishTargetClosestAngle(true);
+		break;
+	default:
+		break;
+	}
+}
+
+FVector UDynamicCameraComponent::GetVisibilityEye() const
+{
+	return Camera->GetComponentLocation() + NavigationRaycastOffset;
+}
+
+bool UDynamicCameraComponent::IsTargetVisible(AActor* Target) const
+{
+	static const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TargetVisibility));
+
+	bool bBakedVisible;
+	const FTargetVisibilityTable* table = TargetingSubsystem ? TargetingSubsystem->GetVisibilityTable() : nullptr;
+	if (FTargetVisibilityBatch::QueryTable(table, GetVisibilityEye(), Target->GetActorLocation(), bBakedVisible))
+		return bBakedVisible;
+
+	INC_DWORD_STAT(STAT_TargetingVisibilityTraces);
+	CSV_CUSTOM_STAT(DynamicCamera, TracesIssued, 1, ECsvCustomStatOp::Accumulate);
+
+	FHitResult HitInfos;
+	const bool bBlockingHit = GetWorld()->LineTraceSingleByChannel(HitInfos, GetVisibilityEye(), Target->GetActorLocation(), ECollisionChannel::ECC_Visibility, QueryParams);
+
+	return FTargetVisibilityBatch::IsVisibleHit(bBlockingHit, HitInfos, Target);
+}
+
 void UDynamicCameraComponent::SetCurrentTarget(AActor* NewTarget)
 {
 	// Unlock previous target.
-	if (IsValid(CurrentTarget))
+	if (AActor* previousTarget = GetCurrentTarget())
 	{
-		Cast<ITargetable>(CurrentTarget)->Execute_ToggleLock(CurrentTarget, false);
+		ToggleTargetLock(previousTarget, false);
 	}
 	else
 		OnCameraLock.Broadcast();
 
 	// Lock new Target.
-	CurrentTarget = NewTarget;
+	CurrentTarget = IsValid(NewTarget) ? GetTargetHandle(NewTarget) : FTargetHandle();
 
-	if (IsValid(CurrentTarget))
+	AActor* currentTarget = GetCurrentTarget();
+	if (currentTarget)
 	{
-		Cast<ITargetable>(CurrentTarget)->Execute_ToggleLock(CurrentTarget, true);
+		ToggleTargetLock(currentTarget, true);
 	}
 	else
 		SetModeFree(CameraStates::LOCKED);
 
-	OnCameraChangeTarget.Broadcast(CurrentTarget);
+	OnCameraChangeTarget.Broadcast(currentTarget);
+
+	ReplicateLockState();
+}
+
+void UDynamicCameraComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The owner knows its lock before the server does.
+	DOREPLIFETIME_CONDITION(UDynamicCameraComponent, LockState, COND_SkipOwner);
+}
+
+void UDynamicCameraComponent::ReplicateLockState()
+{
+	if (GetNetMode() == NM_Standalone)
+		return;
+
+	APawn* pawn = Cast<APawn>(GetOwner());
+	if (pawn == nullptr || !pawn->IsLocallyControlled())
+		return;
+
+	const FTargetHandle target = TargetLocked ? CurrentTarget : FTargetHandle();
+	if (target == RequestedLockTarget)
+		return;
+
+	RequestedLockTarget = target;
+
+	FReplicatedLockState request;
+	request.Target = TargetingSubsystem ? TargetingSubsystem->Resolve(target) : nullptr;
+	request.SetAim(pawn->GetControlRotation());
+
+	// A listen server owner is its own authority, its camera already toggled the targets.
+	if (GetOwnerRole() == ROLE_Authority)
+		ApplyLockState(request, false);
+	else
+		ServerRequestLock(request);
+}
+
+bool UDynamicCameraComponent::ValidateLock(AActor* Target) const
+{
+	if (!IsValid(Target) || !IsTargetable(Target))
+		return false;
+
+	const FVector center = Camera->GetComponentLocation();
+	const float range = MinimumRangeToSelect * CVarLockRangeTolerance.GetValueOnGameThread();
+
+	if (TargetingSubsystem && TargetingSubsystem->IsRegistered(Target))
+	{
+		// Same query as the owner gather, widened by the tolerance.
+		TArray<AActor*> candidates;
+		TargetingSubsystem->QueryRadius(center, range, candidates, GetOwner());
+		if (!candidates.Contains(Target))
+			return false;
+	}
+	else if (FVector::DistSquared(center, Target->GetActorLocation()) > range * range)
+	{
+		return false;
+	}
+
+	return !bNavigateOnlyVisible || IsTargetVisible(Target);
+}
+
+void UDynamicCameraComponent::ApplyLockState(const FReplicatedLockState& NewState, bool bToggleTargets)
+{
+	if (NewState == LockState)
+		return;
+
+	if (bToggleTargets && LockState.Target != NewState.Target)
+	{
+		if (IsValid(LockState.Target))
+		{
+			ToggleTargetLock(LockState.Target, false);
+		}
+		if (IsValid(NewState.Target))
+		{
+			ToggleTargetLock(NewState.Target, true);
+		}
+	}
+
+	LockState = NewState;
+
+	// Sent on this net update instead of waiting for the owner next one; unchanged states send nothing.
+	GetOwner()->ForceNetUpdate();
+}
+
+void UDynamicCameraComponent::OnRep_LockState()
+{
+	OnReplicatedLockChanged.Broadcast(LockState.Target);
+}
+
+bool UDynamicCameraComponent::ServerRequestLock_Validate(const FReplicatedLockState& Request)
+{
+	// Out of range or hidden targets are refused in the implementation, without kicking the client.
+	return true;
+}
+
+void UDynamicCameraComponent::ServerRequestLock_Implementation(const FReplicatedLockState& Request)
+{
+	if (Request.Target != nullptr && !ValidateLock(Request.Target))
+	{
+		INC_DWORD_STAT(STAT_TargetingLockRejected);
+
+		ApplyLockState(FReplicatedLockState(), true);
+		ClientRejectLock(Request.Target);
+		return;
+	}
+
+	ApplyLockState(Request, true);
+}
+
+void UDynamicCameraComponent::ClientRejectLock_Implementation(AActor* Target)
+{
+	if (Target != nullptr && GetCurrentTarget() == Target)
+	{
+		// The server is already unlocked, no need to request it.
+		RequestedLockTarget.Reset();
+		SetModeFree(CameraStates::LOCKED);
+	}
 }
 
 
 void UDynamicCameraComponent::LookAt(FRotator& ReturnRotation)
 {
-	float deltaSeconds = GetWorld()->GetDeltaSeconds();
-	FRotator controllerRotation = GetOwner()->GetInstigatorController()->GetControlRotation();
-	FRotator temp = UKismetMathLibrary::RInterpTo(controllerRotation,
-		UKismetMathLibrary::FindLookAtRotation(Camera->GetComponentLocation(), CurrentTarget->GetActorLocation()), deltaSeconds, RotationInterpSpeed);
-	temp.Roll = controllerRotation.Roll;
-	if (!TargetLocked)
+	FDynamicCameraSolverInput input;
+	SnapshotSolverInput(input, true, GetWorld()->GetDeltaSeconds());
+	ReturnRotation = FDynamicCameraSolver::SolveLookAt(input);
+}
+
+FVector UDynamicCameraComponent::GetTargetAimPoint(const AActor* Target) const
+{
+	return TargetingSubsystem ? TargetingSubsystem->GetAimPoint(Target) : Target->GetActorLocation();
+}
+
+int32 UDynamicCameraComponent::SelectBestCandidate(float MaxDistance, const AActor* Exclude)
+{
+	return SelectBestCandidate(ObjectsInRange, MaxDistance, Exclude);
+}
+
+int32 UDynamicCameraComponent::SelectBestCandidate(const TArray<AActor*>& Pool, float MaxDistance, const AActor* Exclude)
+{
+	ScoringKernel.Reset(Pool.Num());
+	const FTargetVisibilityCache& visibilityCache = GetVisibilityCache();
+
+	for (AActor* candidate : Pool)
 	{
-		temp.Pitch = FMath::Clamp(controllerRotation.Pitch, MinPitchAngle, MaxPitchAngle);
+		// Instant select valid target.
+		const bool bEligible = candidate != Exclude && (!bNavigateOnlyVisible || visibilityCache.IsVisible(candidate));
+		AddScoringCandidate(candidate, bEligible);
 	}
-	else
+
+	ScoringKernel.Score(GetOwner()->GetActorLocation(), Camera->GetComponentLocation(), Camera->GetForwardVector(), MaxDistance, SelectionWeights);
+
+	return ScoringKernel.SelectBest();
+}
+
+void UDynamicCameraComponent::AddScoringCandidate(AActor* Candidate, bool bEligible)
+{
+	FVector location;
+	float priority = 1.f;
+	float timeSinceLocked = MAX_FLT;
+	if (TargetingSubsystem == nullptr || !TargetingSubsystem->GetScoringInputs(Candidate, location, priority, timeSinceLocked))
 	{
-		temp.Pitch = FMath::Clamp(temp.Pitch, MinPitchAngleWhenLocked, MaxPitchAngleWhenLocked);
+		location = Candidate->GetActorLocation();
 	}
-	ReturnRotation = temp;
+
+	ScoringKernel.Add(location, priority, timeSinceLocked, bEligible);
 }
 
-void UDynamicCameraComponent::MoveCamera(FVector NewPos, FVector& LerpedPos, float& Length)
+const TArray<AActor*>& UDynamicCameraComponent::GetLockPool(float MaxDistance)
 {
-	float deltaSeconds = GetWorld()->GetDeltaSeconds();
-	FVector temp = NewPos;
-	temp.X = 0;
+	if (!FTargetClusters::ShouldCluster(ObjectsInRange.Num()))
+		return ObjectsInRange;
+
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_ClusterPass);
+
+	Clusters.Update(ObjectsInRange);
+
+	// Representatives pass, visibility is only known for the members scored afterwards.
+	TArray<int32, TInlineAllocator<64>> clusterIndices;
+	ScoringKernel.Reset(Clusters.Num());
+	Clusters.ForEachCluster([this, &clusterIndices](int32 cluster)
+	{
+		clusterIndices.Add(cluster);
+		AddScoringCandidate(Clusters.GetRepresentative(cluster), true);
+	});
+
+	// A representative may be out of range while other members of its cluster are not.
+	const float clusterRadius = FTargetClusters::GetSize() * FMath::Sqrt(2.f);
+	ScoringKernel.Score(GetOwner()->GetActorLocation(), Camera->GetComponentLocation(), Camera->GetForwardVector(), MaxDistance + clusterRadius, SelectionWeights);
+
+	TArray<int32> bestClusters;
+	ScoringKernel.SelectBest(FTargetClusters::GetNumRefined(), bestClusters);
+
+	ClusterPool.Reset();
+	for (int32 best : bestClusters)
+	{
+		ClusterPool.Append(Clusters.GetMembers(clusterIndices[best]));
+	}
 
-	Length = UKismetMathLibrary::FInterpTo(TargetArmLength, DistanceCameraWhenLocked, deltaSeconds, RotationInterpSpeed);
-	LerpedPos = UKismetMathLibrary::VInterpTo(SocketOffset, temp, deltaSeconds, RotationInterpSpeed);
+	CSV_CUSTOM_STAT(DynamicCamera, ClusterPool, ClusterPool.Num(), ECsvCustomStatOp::Set);
+	return ClusterPool;
+}
+
+const TArray<AActor*>& UDynamicCameraComponent::GetNavigationPool(AActor* From, int IncrementSign)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_ClusterPass);
+
+	Clusters.Update(ObjectsInRange);
+
+	const FVector center = GetComponentLocation();
+	const float fromAngle = FTargetAngularRing::PseudoAngle(From->GetActorLocation() - center);
+
+	// Azimuth step from From in the navigation direction, in (0, 4].
+	auto getStep = [&center, fromAngle, IncrementSign](const FVector& location)
+	{
+		const float step = IncrementSign * (FTargetAngularRing::PseudoAngle(location - center) - fromAngle);
+		return step > 0.f ? step : step + 4.f;
+	};
+
+	// Representatives pass: the clusters right after From.
+	const int32 fromCluster = Clusters.FindCluster(From);
+	const int32 numRefined = FTargetClusters::GetNumRefined();
+
+	TArray<TPair<float, int32>, TInlineAllocator<8>> nextClusters;
+	Clusters.ForEachCluster([&](int32 cluster)
+	{
+		if (cluster == fromCluster)
+			return;
+
+		const float step = getStep(Clusters.GetCentroid(cluster));
+		if (nextClusters.Num() < numRefined)
+		{
+			nextClusters.Add(TPair<float, int32>(step, cluster));
+			return;
+		}
+
+		int32 farthest = 0;
+		for (int32 index = 1; index < nextClusters.Num(); ++index)
+		{
+			if (nextClusters[index].Key > nextClusters[farthest].Key)
+				farthest = index;
+		}
+		if (step < nextClusters[farthest].Key)
+			nextClusters[farthest] = TPair<float, int32>(step, cluster);
+	});
+
+	// Refine: azimuth order inside the picked clusters.
+	TArray<TPair<float, AActor*>, TInlineAllocator<64>> steps;
+	auto addMembers = [&](int32 cluster)
+	{
+		for (AActor* member : Clusters.GetMembers(cluster))
+		{
+			if (member != From)
+				steps.Add(TPair<float, AActor*>(getStep(member->GetActorLocation()), member));
+		}
+	};
+
+	if (fromCluster != INDEX_NONE)
+		addMembers(fromCluster);
+	for (const TPair<float, int32>& next : nextClusters)
+	{
+		addMembers(next.Value);
+	}
+
+	steps.Sort([](const TPair<float, AActor*>& lhs, const TPair<float, AActor*>& rhs) { return lhs.Key < rhs.Key; });
+
+	ClusterPool.Reset(steps.Num());
+	for (const TPair<float, AActor*>& step : steps)
+	{
+		ClusterPool.Add(step.Value);
+	}
+
+	CSV_CUSTOM_STAT(DynamicCamera, ClusterPool, ClusterPool.Num(), ECsvCustomStatOp::Set);
+	return ClusterPool;
+}
+
+void UDynamicCameraComponent::ToggleTargetLock(AActor* Target, bool bLocked)
+{
+	// Native path for targetable components, reflected interface event for ITargetable only actors.
+	UTargetableComponent* Targetable = TargetingSubsystem ? TargetingSubsystem->GetTargetable(Target) : nullptr;
+	if (Targetable == nullptr && !bLocked)
+	{
+		// Released after it left the targeting index, e.g. from OnTargetRemoved.
+		Targetable = Target->FindComponentByClass<UTargetableComponent>();
+	}
+
+	if (Targetable)
+	{
+		Targetable->SetLocked(bLocked);
+		return;
+	}
+
+	if (Target->GetClass()->ImplementsInterface(UTargetable::StaticClass()))
+	{
+		ITargetable::Execute_ToggleLock(Target, bLocked);
+	}
+
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->SetTargetLocked(Target, bLocked);
+	}
+}
+
+bool UDynamicCameraComponent::IsTargetable(const AActor* Actor) const
+{
+	// Actors registered bare, e.g. from Blueprint, have nothing to receive the lock.
+	return (TargetingSubsystem && TargetingSubsystem->GetTargetable(Actor) != nullptr) || Actor->GetClass()->ImplementsInterface(UTargetable::StaticClass());
+}
+
+FTargetHandle UDynamicCameraComponent::GetTargetHandle(AActor* Target) const
+{
+	if (TargetingSubsystem == nullptr)
+		return FTargetHandle();
+
+	FTargetHandle handle = TargetingSubsystem->GetHandle(Target);
+
+	// Targetable components register their owner themselves, an unregistered one is pooled or out of play.
+	if (handle.IsNull() && Target->FindComponentByClass<UTargetableComponent>() == nullptr && Target->GetClass()->ImplementsInterface(UTargetable::StaticClass()))
+	{
+		TargetingSubsystem->RegisterTarget(Target);
+		handle = TargetingSubsystem->GetHandle(Target);
+	}
+
+	return handle;
+}
+
+void UDynamicCameraComponent::OnTargetRemoved(FTargetHandle Handle, AActor* Target)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_OnTargetRemoved);
+
+	Candidates.RemoveAll(Target);
+
+	// Server side lock of a remote owner: its client goes back to free mode.
+	if (LockState.Target == Target && GetOwnerRole() == ROLE_Authority)
+	{
+		APawn* pawn = Cast<APawn>(GetOwner());
+		if (pawn && !pawn->IsLocallyControlled())
+		{
+			ApplyLockState(FReplicatedLockState(), true);
+			ClientRejectLock(Target);
+		}
+	}
+
+	if (Handle != CurrentTarget)
+		return;
+
+	// A target that died or was unregistered from Blueprint is still around: release it before picking the next one.
+	if (IsValid(Target))
+	{
+		ToggleTargetLock(Target, false);
+	}
+	CurrentTarget.Reset();
+
+	// Unlocks when no other candidate is eligible.
+	if (CurrentState == CameraStates::LOCKED)
+		TargetClosestAngle();
+}
+
+void UDynamicCameraComponent::MoveCamera(FVector NewPos, FVector& LerpedPos, float& Length)
+{
+	FDynamicCameraSolverInput input;
+	SnapshotSolverInput(input, true, GetWorld()->GetDeltaSeconds());
+	FDynamicCameraSolver::SolveMove(input, DistanceCameraWhenLocked, NewPos, LerpedPos, Length);
 }
 
 bool UDynamicCameraComponent::IsInArray(AActor* OtherObject)
 {
-	return ObjectsInRange.Contains(OtherObject);
+	return Candidates.Contains(OtherObject);
 }
 
 AActor* UDynamicCameraComponent::GetCurrentTarget() const
 {
-	return CurrentTarget;
+	return TargetingSubsystem ? TargetingSubsystem->Resolve(CurrentTarget) : nullptr;
 }
 
 void UDynamicCameraComponent::SetCameraReseting(bool _Value)
 {
 	IsCameraReseting = _Value;
 	ResetCurrentTime = _Value ? TimeBeforeReset : 0;
+
+	// The reset timer only advances while ticking.
+	if (_Value)
+		bDormant = false;
 }
 
 #pragma endregion
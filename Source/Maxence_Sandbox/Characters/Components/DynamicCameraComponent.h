@@ -4,6 +4,17 @@
 
 #include "CoreMinimal.h"
 #include <GameFramework/SpringArmComponent.h>
+#include <Targeting/TargetVisibilityBatch.h>
+#include <Targeting/TargetVisibilityCache.h>
+#include <Targeting/TargetAngularRing.h>
+#include <Targeting/TargetClusters.h>
+#include <Targeting/TargetCandidateSet.h>
+#include <Targeting/TargetHandle.h>
+#include <Targeting/TargetScoring.h>
+#include <Targeting/TargetLockReplication.h>
+#include <Targeting/TargetingStats.h>
+#include "DynamicCameraProbe.h"
+#include "DynamicCameraSolver.h"
 #include "DynamicCameraComponent.generated.h"
 
 UENUM()
@@ -13,14 +24,41 @@ enum CameraStates
 	LOCKED,
 	CVOID
 };
+
+/// Target selection waiting for its visibility batch.
+enum class EPendingTargetSelection : uint8
+{
+	None,
+	Lock,
+	Navigate,
+	ClosestAngle,
+	/// Closest angle retarget over every candidate, after the best clusters held nothing eligible.
+	ClosestAngleAll
+};
+
 class UCameraComponent;
+class UDynamicCameraComponent;
+class APlayerCameraManager;
 class UTargetable;
+class UTargetingSubsystem;
+class AMaxence_SandboxCharacter;
+class USkeletalMesh;
+struct FCameraStateFree;
+struct FCameraStateLocked;
 #define MIN_LEFT_ANGLE 181
 #define MAX_LEFT_ANGLE 359
 #define MIN_RIGHT_ANGLE 1
 #define MAX_RIGHT_ANGLE 179
 
-DECLARE_DELEGATE(Action);
+/// Takes the solver snapshot of a camera once its owner moved and dispatches the solve (DynamicCamera.AsyncSolver).
+struct FDynamicCameraSolverTickFunction : public FTickFunction
+{
+	UDynamicCameraComponent* Target = nullptr;
+
+	void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	FString DiagnosticMessage() override;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FChangingState);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FChangingTarget, AActor*, NewTarget);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FSwitchingTargetDelegate, AActor*, EnemyElement, AActor*, CurrentTarget);
@@ -30,6 +68,14 @@ class UDynamicCameraComponent : public USpringArmComponent
 {
 	GENERATED_BODY()
 
+	friend struct FCameraStateFree;
+	friend struct FCameraStateLocked;
+
+	/// Drives the state handlers directly when timing them.
+	friend class FTargetingBenchmark;
+
+	friend struct FDynamicCameraSolverTickFunction;
+
 public:
 	// Sets default values for this actor's properties
 	UDynamicCameraComponent(const FObjectInitializer& ObjectInitializer);
@@ -53,17 +99,227 @@ protected:
 	/** VARIABLES */
 
 	float ResetCurrentTime;
-	/// The current target
-	AActor* CurrentTarget;
+	/// The current target, resolved through the targeting subsystem: it reads nullptr as soon as the target left the index.
+	FTargetHandle CurrentTarget;
 
 	const TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypesLock{ EObjectTypeQuery::ObjectTypeQuery1, EObjectTypeQuery::ObjectTypeQuery2, EObjectTypeQuery::ObjectTypeQuery3 };
 
+	/// World targeting index, replaces the range sphere while Targeting.UseSpatialIndex is set.
+	UPROPERTY(Transient)
+		UTargetingSubsystem* TargetingSubsystem = nullptr;
+
+	/// Whether ObjectsInRange is fed by the targeting index (true) or by the range sphere overlaps (false).
+	bool bUseSpatialIndex = false;
+
+	/// Owner when it is the player character, cast once at BeginPlay.
+	UPROPERTY(Transient)
+		AMaxence_SandboxCharacter* OwnerPlayer = nullptr;
+
+	/// LookAtCameraBone resolved on the owner mesh at BeginPlay: bone index and socket offset from the bone.
+	/// Resolved again when the mesh or the bone name changes.
+	int32 LookAtBoneIndex = INDEX_NONE;
+	FTransform LookAtSocketOffset;
+	FName ResolvedLookAtBone;
+	const USkeletalMesh* ResolvedLookAtMesh = nullptr;
+
+	/// Component space location of LookAtCameraBone, cached once per animation evaluation.
+	FVector LookAtComponentLocation = FVector::ZeroVector;
+	bool bLookAtCached = false;
+
+	void ResolveLookAtBone();
+
+	/// Caches the look-at bone when the owner mesh finalized its bone transforms, parallel evaluation included.
+	UFUNCTION()
+		void OnOwnerBoneTransformsFinalized();
+
+	/// World location of LookAtCameraBone from the cached pose, from a socket query until the first evaluation.
+	FVector GetLookAtLocation() const;
+
+	/// Current state of the camera state machine, see DynamicCameraStates.h.
+	CameraStates CurrentState = CameraStates::CVOID;
+
+	/// Whether the current state is idle and the camera only runs the spring arm update.
+	bool bDormant = false;
+
+#if DYNAMIC_CAMERA_PROFILING
+	uint32 LastTickCycles = 0;
+#endif
+
+	/// Async collision probe of the arm, read back one frame after it is issued.
+	FDynamicCameraProbe CollisionProbe;
+
+	/// Arm length applied by the async probe, eased out towards the predicted clear length.
+	float ProbedArmLength = -1.f;
+
+	/// Spring arm update with the collision sweep issued asynchronously: the arm length is predicted from the
+	/// last probe result and the character velocity, and corrected as soon as the next probe lands.
+	void UpdateDesiredArmLocation(bool bDoTrace, bool bDoLocationLag, bool bDoRotationLag, float DeltaTime) override;
+
+	/// Pre-physics tick dispatching the solver, after the owner movement.
+	FDynamicCameraSolverTickFunction SolverTickFunction;
+
+	/// State math of the camera, solved on a worker between the snapshot tick and the camera tick.
+	FDynamicCameraSolver Solver;
+
+	/// Result of the last synchronous solve.
+	FDynamicCameraSolverOutput SyncSolverOutput;
+
+	void RegisterComponentTickFunctions(bool bRegister) override;
+
+	/// Snapshots the solver input and dispatches the solve when DynamicCamera.AsyncSolver is set and the state has math to run.
+	void DispatchSolver();
+
+	/// Copies the state math inputs. Only the inputs of the locked or the free state are read, following bLocked.
+	void SnapshotSolverInput(FDynamicCameraSolverInput& Input, bool bLocked, float DeltaTime) const;
+
+	/// Whether nothing the solve of Input read changed since the snapshot.
+	bool IsSolveCurrent(const FDynamicCameraSolverInput& Input) const;
+
+	/// Fetches the solve dispatched this frame, or solves synchronously if there is none or it is out of date, and applies it.
+	void SolveCameraState();
+
+	/// Writes the solve back to the camera, the owner and its controller.
+	void ApplySolverOutput(const FDynamicCameraSolverInput& Input, const FDynamicCameraSolverOutput& Output);
+
+	/// Writes the reset state and the reset rotation inputs of a free state solve.
+	void ApplyResetOutput(const FDynamicCameraSolverOutput& Output);
+
+	/// Owner and control rotations when the camera went dormant: any change wakes it up.
+	FRotator DormantOwnerRotation;
+	FRotator DormantControlRotation;
+
 	/** METHODS */
-	/// DoAction camera. Basically acting like the update. 
-/// We bind methods to this delegate according to the current state of the camera
-	Action DoActionCamera;
+	/// Runs the exit hook of the current state and the enter hook of NewState.
+	void TransitionTo(CameraStates NewState);
+
+	/// Puts the camera to sleep while its state is idle and wakes it up on rotation changes.
+	/// <returns>true if the camera is dormant this frame.</returns>
+	bool UpdateDormancy();
+
+	/// Switches between the targeting index and the range sphere according to Targeting.UseSpatialIndex.
+	void UpdateCandidateSource();
+
+	/// Refreshes ObjectsInRange from the targeting index. Range sphere mode keeps it up to date through overlaps.
+	void GatherCandidates();
+
+	/// Keeps the closest candidates, and the current target, when the targeting budget caps them.
+	void CapCandidates();
+
+	/// O(1) membership and overlap counts of ObjectsInRange.
+	FTargetCandidateSet Candidates{ ObjectsInRange };
+
+	/// Last known line of sight of the candidates, refreshed within a per frame trace budget.
+	FTargetVisibilityCache VisibilityCache;
+
+	/// Candidates ordered by azimuth around the camera, for left/right navigation.
+	FTargetAngularRing AngularRing;
+
+	/// Spatial clusters of the candidates. Lock and navigation go through them above Targeting.Clusters.MinCandidates.
+	FTargetClusters Clusters;
+
+	/// Members of the clusters picked by the last cluster pass.
+	TArray<AActor*> ClusterPool;
+
+	/// Shared view the candidates were gathered from this frame, INDEX_NONE when gathering on its own.
+	int32 SharedViewId = INDEX_NONE;
 
-	void HandlingFinishedState(CameraStates PrevState);
+	/// Candidate scoring storage, reused across selections.
+	FTargetScoringKernel ScoringKernel;
+
+	/// Line of sight of the candidates missing from the cache on a lock or navigation input, traced asynchronously.
+	FTargetVisibilityBatch VisibilityBatch;
+
+	/// Selection to finish once VisibilityBatch lands.
+	EPendingTargetSelection PendingSelection = EPendingTargetSelection::None;
+	int PendingNavigationSign = 0;
+
+	/// Makes sure every candidate of Pool is in the visibility cache.
+	/// Missing candidates are traced in a batch and Selection is deferred to its resolution.
+	/// <returns>true if Selection has been deferred.</returns>
+	bool RequestVisibility(EPendingTargetSelection Selection, const TArray<AActor*>& Pool);
+
+	/// Candidates a lock scores: ObjectsInRange, or the members of the best scored cluster representatives.
+	const TArray<AActor*>& GetLockPool(float MaxDistance);
+
+	/// Candidates a clustered navigation from From walks: the members of its cluster and of the next cluster
+	/// representatives in the IncrementSign direction, ordered by azimuth step from From.
+	const TArray<AActor*>& GetNavigationPool(AActor* From, int IncrementSign);
+
+	/// Stores the landed visibility batch in the cache and finishes the pending selection.
+	void ResolvePendingSelection();
+
+	/// Visibility cache of the shared view the camera looks from, or its own one.
+	FTargetVisibilityCache& GetVisibilityCache();
+
+	/// Camera manager of the player controlling the owner, nullptr for AI and spectator owners without one.
+	APlayerCameraManager* GetOwnerCameraManager() const;
+
+	/// Camera eye used for line of sight tests.
+	FVector GetVisibilityEye() const;
+
+	/// Synchronous line of sight test from the camera to Target.
+	bool IsTargetVisible(AActor* Target) const;
+
+	/// Point the camera looks at on Target, from the targeting batched tick when available.
+	FVector GetTargetAimPoint(const AActor* Target) const;
+
+	/// Scores ObjectsInRange with SelectionWeights and returns the index of the best candidate, INDEX_NONE if none.
+	/// <param name="MaxDistance">Candidates farther from the owner are ignored.</param>
+	/// <param name="Exclude">Candidate to ignore (usually the current target).</param>
+	int32 SelectBestCandidate(float MaxDistance, const AActor* Exclude);
+
+	/// Same as above over Pool, returns an index in Pool.
+	int32 SelectBestCandidate(const TArray<AActor*>& Pool, float MaxDistance, const AActor* Exclude);
+
+	/// Adds Candidate to the scoring kernel with its targeting inputs.
+	void AddScoringCandidate(AActor* Candidate, bool bEligible);
+
+	/// Notifies Target and the targeting subsystem of a lock change.
+	void ToggleTargetLock(AActor* Target, bool bLocked);
+
+	/// Whether Actor can be locked: registered in the targeting subsystem or implementing ITargetable.
+	bool IsTargetable(const AActor* Actor) const;
+
+	/// Handle of Target, registering ITargetable only actors on first use. Null if Target cannot be registered.
+	FTargetHandle GetTargetHandle(AActor* Target) const;
+
+	/// Drops a target that left the targeting index from the candidates, and retargets when it was the current one.
+	void OnTargetRemoved(FTargetHandle Handle, AActor* Target);
+
+	FDelegateHandle TargetRemovedHandle;
+
+	/// Lock state of the owner, set by the server once it validated the lock and replicated to the other clients.
+	UPROPERTY(ReplicatedUsing = OnRep_LockState)
+		FReplicatedLockState LockState;
+
+	/// Target the owning client last sent to the server, so an unchanged lock is not requested again.
+	FTargetHandle RequestedLockTarget;
+
+	/// Sends the local lock state to the server when it changed. Does nothing offline and on non owning machines.
+	void ReplicateLockState();
+
+	/// Whether the owner can lock Target according to the server own targeting query.
+	bool ValidateLock(AActor* Target) const;
+
+	/// Stores the validated lock state and notifies the locked targets of the server.
+	/// <param name="bToggleTargets">false when the local camera already toggled them (listen server owner).</param>
+	void ApplyLockState(const FReplicatedLockState& NewState, bool bToggleTargets);
+
+	UFUNCTION()
+		void OnRep_LockState();
+
+	/// Lock or unlock request of the owning client (nullptr target).
+	UFUNCTION(Server, Reliable, WithValidation)
+		void ServerRequestLock(const FReplicatedLockState& Request);
+
+	/// The server refused the lock of Target: the owning client goes back to free mode.
+	UFUNCTION(Client, Reliable)
+		void ClientRejectLock(AActor* Target);
+
+	void FinishSetModeLocked();
+	void FinishNavigateTargets(int IncrementSign);
+	/// <param name="bScoreAll">Score every candidate instead of the lock pool.</param>
+	void FinishTargetClosestAngle(bool bScoreAll = false);
 	UFUNCTION()
 		/// Called when object enters camera range.
 		void OnObjectEntersRange(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
@@ -71,12 +327,10 @@ protected:
 		/// Called when object leaves camera range.
 		void OnObjectLeavesRange(UPrimitiveComponent* OverlappedComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 	/// Does the action camera locked.
-	UFUNCTION()
-		void DoActionLocked();
+	void DoActionLocked();
 
 	/// Does the action camera free.
-	UFUNCTION()
-		void DoActionFree();
+	void DoActionFree();
 
 
 #pragma endregion
@@ -84,6 +338,9 @@ protected:
 	void BeginPlay() override;
 	void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
+public:
+	void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 public:
 
 #pragma region CAMERA
@@ -98,9 +355,8 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera")
 		FName LookAtCameraBone = "LookAt_J";
 
-	/// The objects in range
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "[STARK]|Kojima Camera")
-		TArray<AActor*> ObjectsInRange;
+	/// The objects in range. Not a UPROPERTY: every candidate is a registered target, removed on OnTargetRemoved before it goes away.
+	TArray<AActor*> ObjectsInRange;
 
 	/// The minimum pitch when target unlocked
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Unlocked Mode")
@@ -174,6 +430,30 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Locked Mode")
 		float autoLockedDistance = 1000.f;
 
+	/// Weights of the target selection when locking and when picking the closest target.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Locked Mode")
+		FTargetScoringWeights SelectionWeights;
+
+	/// Whether the collision sweep of the arm is issued asynchronously and its result predicted (DynamicCamera.AsyncProbe).
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Collision")
+		bool bAsyncCollisionProbe = true;
+
+	/// Sweeps of the async probe: the arm one, then side ones around the camera for a smoother pull-in.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Collision", meta = (ClampMin = "1", ClampMax = "8", EditCondition = "bAsyncCollisionProbe"))
+		int32 ProbeRays = 5;
+
+	/// Distance of the side sweeps from the camera.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Collision", meta = (EditCondition = "bAsyncCollisionProbe"))
+		float ProbeSpread = 30.f;
+
+	/// Share of a side sweep hit that pulls the camera in, the arm sweep always pulls it in fully.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Collision", meta = (ClampMin = "0", ClampMax = "1", EditCondition = "bAsyncCollisionProbe"))
+		float ProbeSideWeight = 0.5f;
+
+	/// Speed the arm extends back at once an obstacle is gone. It always pulls in at once.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Collision", meta = (EditCondition = "bAsyncCollisionProbe"))
+		float ProbeRecoverySpeed = 10.f;
+
 	/// Offset to raycast from the player (head offset).
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Locked Mode")
 		FVector NavigationRaycastOffset;
@@ -189,6 +469,9 @@ public:
 	////Reset Camera /////
 	bool IsCameraReseting;
 
+	/// Whether the last reset update was stopped by PreventResetCamera, so the reset has nothing to do until the rotations change.
+	bool bResetSettled = false;
+
 	/// Rate speed of camera reset
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "[STARK]|Kojima Camera|Reset")
 		float ResetCameraRate;
@@ -232,6 +515,16 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Lock")
 		FChangingTarget OnCameraChangeTarget;
 
+	/** Callback on the other machines when the server validated a lock change of the owner, nullptr when unlocked. */
+	UPROPERTY(BlueprintAssignable, Category = "Lock")
+		FChangingTarget OnReplicatedLockChanged;
+
+	/** Lock state of the owner as validated by the server. */
+	UFUNCTION(BlueprintPure, Category = "Lock")
+		const FReplicatedLockState& GetReplicatedLockState() const { return LockState; }
+
+	/// Sets the mode free camera.
+	/// PrevState is kept for Blueprint compatibility: the state machine exits its actual current state.
 	UFUNCTION(BlueprintCallable, meta = (Category, OverrideNativeName = "SetModeFree"))
 		virtual void SetModeFree(CameraStates PrevState);
 
@@ -283,8 +576,9 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Camera")
 		void SetCurrentTarget(AActor* NewTarget);
 
-	/*UFUNCTION(Category = "Camera")
-		void OnTargetDie(ITargetable* _Target);*/
+	/** Return the objects in range. */
+	UFUNCTION(BlueprintPure, Category = "Camera")
+		const TArray<AActor*>& GetObjectsInRange() const { return ObjectsInRange; }
 
 	UFUNCTION(BlueprintCallable, Category = "Camera")
 		void SetCameraReseting(bool _Value);
@@ -292,6 +586,14 @@ public:
 	/** Set new target to closest angle. */
 	void TargetClosestAngle();
 
+	/// Current state of the camera state machine.
+	CameraStates GetState() const { return CurrentState; }
+
+#if DYNAMIC_CAMERA_PROFILING
+	/// Duration of the last TickComponent, in cycles.
+	uint32 GetLastTickCycles() const { return LastTickCycles; }
+#endif
+
 
 	void ResetCamera(float DeltaSeconds);
 #pragma endregion
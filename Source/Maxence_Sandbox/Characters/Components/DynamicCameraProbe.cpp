@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DynamicCameraProbe.h"
+
+#include <Engine/World.h>
+#include <GameFramework/Actor.h>
+#include <Targeting/TargetingStats.h>
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Arm probe sweeps"), STAT_DynamicCamera_ProbeSweeps, STATGROUP_DynamicCamera);
+
+void FDynamicCameraProbe::Issue(UWorld* World, const FVector& Origin, const FVector& End, const FRotator& Rotation, const AActor* Ignore, const FSettings& Settings)
+{
+	Handles.Reset();
+	Weights.Reset();
+
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(DynamicCameraProbe), false, Ignore);
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(Settings.ProbeSize);
+
+	Handles.Add(World->AsyncSweepByChannel(EAsyncTraceType::Single, Origin, End, Settings.Channel, Shape, QueryParams));
+	Weights.Add(1.f);
+
+	// Side sweeps evenly spread on a circle around the camera end, in the arm plane.
+	const FRotationMatrix Axes(Rotation);
+	const FVector Right = Axes.GetUnitAxis(EAxis::Y);
+	const FVector Up = Axes.GetUnitAxis(EAxis::Z);
+	const int32 NumSides = FMath::Max(Settings.NumRays - 1, 0);
+	for (int32 Side = 0; Side < NumSides; ++Side)
+	{
+		float Sin, Cos;
+		FMath::SinCos(&Sin, &Cos, 2.f * PI * Side / NumSides);
+
+		const FVector SideEnd = End + (Right * Cos + Up * Sin) * Settings.Spread;
+		Handles.Add(World->AsyncSweepByChannel(EAsyncTraceType::Single, Origin, SideEnd, Settings.Channel, Shape, QueryParams));
+		Weights.Add(Settings.SideWeight);
+	}
+
+	INC_DWORD_STAT_BY(STAT_DynamicCamera_ProbeSweeps, Handles.Num());
+}
+
+bool FDynamicCameraProbe::Resolve(UWorld* World)
+{
+	FTraceDatum Datum;
+
+	bool bLanded = false;
+	float Fraction = 1.f;
+
+	for (int32 Index = 0; Index < Handles.Num(); ++Index)
+	{
+		if (!World->QueryTraceData(Handles[Index], Datum))
+			continue;
+
+		bLanded = true;
+
+		if (Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit)
+		{
+			// A side hit at Time only pulls the camera in by its weight.
+			Fraction = FMath::Min(Fraction, 1.f - Weights[Index] * (1.f - Datum.OutHits[0].Time));
+		}
+	}
+
+	Handles.Reset();
+	Weights.Reset();
+
+	if (bLanded)
+	{
+		ClearFraction = Fraction;
+	}
+
+	return bLanded;
+}
+
+void FDynamicCameraProbe::Reset()
+{
+	Handles.Reset();
+	Weights.Reset();
+	ClearFraction = 1.f;
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "WorldCollision.h"
+
+class UWorld;
+class AActor;
+
+/**
+ * Spring arm collision probe issued through the async trace system.
+ * A center sweep along the arm and optional side sweeps around the camera end are resolved by the physics scene
+ * in parallel with the rest of the frame they are issued in, and read back from the next frame on.
+ * The result is the fraction of the arm that is clear: side sweeps only pull the camera in by their weight,
+ * so the camera eases in before an obstacle reaches the center sweep.
+ */
+class FDynamicCameraProbe
+{
+public:
+	struct FSettings
+	{
+		ECollisionChannel Channel;
+		float ProbeSize;
+
+		/// Sweeps per probe: the center one, then side ones spread around the camera end.
+		int32 NumRays;
+		float Spread;
+
+		/// Share of a side sweep hit that pulls the camera in.
+		float SideWeight;
+	};
+
+	/// Issues the sweeps of the arm from Origin to End, in the orientation of Rotation. Replaces any pending probe.
+	void Issue(UWorld* World, const FVector& Origin, const FVector& End, const FRotator& Rotation, const AActor* Ignore, const FSettings& Settings);
+
+	/// Reads the landed sweeps back into the clear fraction and ends the probe.
+	/// <returns>false if no sweep landed, the clear fraction is left unchanged.</returns>
+	bool Resolve(UWorld* World);
+
+	bool IsPending() const { return Handles.Num() > 0; }
+
+	/// Clear fraction of the arm, from the last resolved probe.
+	float GetClearFraction() const { return ClearFraction; }
+
+	/// Whether the last resolved probe hit something.
+	bool HasHit() const { return ClearFraction < 1.f; }
+
+	void Reset();
+
+private:
+	TArray<FTraceHandle, TInlineAllocator<8>> Handles;
+	TArray<float, TInlineAllocator<8>> Weights;
+
+	float ClearFraction = 1.f;
+};
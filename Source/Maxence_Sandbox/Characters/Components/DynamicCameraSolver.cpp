@@ -0,0 +1,169 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DynamicCameraSolver.h"
+
+#include <Kismet/KismetMathLibrary.h>
+#include <Targeting/TargetingStats.h>
+
+DECLARE_CYCLE_STAT(TEXT("Solver wait"), STAT_DynamicCamera_SolverWait, STATGROUP_DynamicCamera);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Solver game thread time saved (ms)"), STAT_DynamicCamera_SolverSaved, STATGROUP_DynamicCamera);
+
+FDynamicCameraSolver::~FDynamicCameraSolver()
+{
+	Wait();
+}
+
+FRotator FDynamicCameraSolver::SolveLookAt(const FDynamicCameraSolverInput& Input)
+{
+	FRotator rotation = UKismetMathLibrary::RInterpTo(Input.ControlRotation,
+		UKismetMathLibrary::FindLookAtRotation(Input.CameraLocation, Input.AimPoint), Input.DeltaTime, Input.RotationInterpSpeed);
+	rotation.Roll = Input.ControlRotation.Roll;
+
+	if (!Input.bTargetLocked)
+	{
+		rotation.Pitch = FMath::Clamp(Input.ControlRotation.Pitch, Input.MinPitch, Input.MaxPitch);
+	}
+	else
+	{
+		rotation.Pitch = FMath::Clamp(rotation.Pitch, Input.MinPitchLocked, Input.MaxPitchLocked);
+	}
+
+	return rotation;
+}
+
+void FDynamicCameraSolver::SolveMove(const FDynamicCameraSolverInput& Input, float DistanceLocked, const FVector& NewPos, FVector& OutSocketOffset, float& OutLength)
+{
+	FVector offset = NewPos;
+	offset.X = 0;
+
+	OutLength = UKismetMathLibrary::FInterpTo(Input.TargetArmLength, DistanceLocked, Input.DeltaTime, Input.RotationInterpSpeed);
+	OutSocketOffset = UKismetMathLibrary::VInterpTo(Input.SocketOffset, offset, Input.DeltaTime, Input.RotationInterpSpeed);
+}
+
+void FDynamicCameraSolver::SolveReset(const FDynamicCameraSolverInput& Input, FDynamicCameraSolverOutput& Output)
+{
+	Output.YawInput = 0.f;
+	Output.PitchInput = 0.f;
+	Output.bForceReset = Input.bForceReset;
+	Output.bResetting = Input.bResetting;
+	Output.ResetTime = Input.ResetTime;
+	Output.bResetSettled = false;
+
+	// Same as PreventResetCamera.
+	auto Settle = [&Output](bool bHardStop)
+	{
+		if (bHardStop)
+			Output.bForceReset = false;
+
+		Output.ResetTime = 0.f;
+		Output.bResetting = false;
+		Output.bResetSettled = true;
+	};
+
+	const FVector cameraForward = Input.CameraRotation.Vector();
+	const float cosBetweenForwards = FVector::DotProduct(cameraForward, Input.OwnerForward);
+	if (!Input.bForceReset)
+	{
+		if (cosBetweenForwards < Input.CosFacingAngleNotResetting)
+		{
+			Settle(false);
+			return;
+		}
+		if (!Input.bResetting)
+		{
+			Output.ResetTime += Input.DeltaTime;
+			if (Output.ResetTime >= Input.TimeBeforeReset)
+				Output.bResetting = true;
+			return;
+		}
+	}
+
+	FRotator targetRotation = UKismetMathLibrary::FindLookAtRotation(Input.ArmLocation, Input.LookAtLocation);
+	targetRotation.Yaw = Input.OwnerYaw;
+
+	const FRotator deltaRotation = UKismetMathLibrary::NormalizedDeltaRotator(targetRotation, Input.CameraRotation);
+	Output.YawInput = deltaRotation.Yaw * Input.DeltaTime * Input.ResetRate;
+	Output.PitchInput = deltaRotation.Pitch * Input.DeltaTime * Input.ResetRate * -1.f;
+
+	// Stop camera reset when reset is complete
+	if (deltaRotation.IsNearlyZero(1.f))
+		Settle(true);
+}
+
+void FDynamicCameraSolver::Solve(const FDynamicCameraSolverInput& Input, FDynamicCameraSolverOutput& Output)
+{
+	const uint32 startCycles = FPlatformTime::Cycles();
+
+	Output.Frame = Input.Frame;
+
+	if (Input.bLocked)
+	{
+		Output.ControlRotation = SolveLookAt(Input);
+	}
+	else
+	{
+		Output.TargetArmLength = UKismetMathLibrary::FInterpTo(Input.TargetArmLength, Input.DistanceUnlocked, Input.DeltaTime, Input.RotationInterpSpeed);
+		Output.SocketOffset = UKismetMathLibrary::VInterpTo(Input.SocketOffset, Input.PositionOffsetFree, Input.DeltaTime, Input.RotationInterpSpeed);
+		SolveReset(Input, Output);
+	}
+
+	Output.SolveCycles = FPlatformTime::Cycles() - startCycles;
+}
+
+void FDynamicCameraSolver::Dispatch(const FDynamicCameraSolverInput& Input)
+{
+	Wait();
+
+	FDynamicCameraSolverInput* backInput = &Inputs[BackIndex];
+	FDynamicCameraSolverOutput* backOutput = &Outputs[BackIndex];
+	*backInput = Input;
+
+	Task = FFunctionGraphTask::CreateAndDispatchWhenReady([backInput, backOutput]()
+	{
+		Solve(*backInput, *backOutput);
+	}, TStatId(), nullptr, ENamedThreads::AnyHiPriThreadHiPriTask);
+}
+
+const FDynamicCameraSolverOutput* FDynamicCameraSolver::Fetch(const FDynamicCameraSolverInput*& OutInput)
+{
+	OutInput = nullptr;
+	if (!Task.IsValid())
+		return nullptr;
+
+	uint32 waitCycles = 0;
+	if (!Task->IsComplete())
+	{
+		DYNAMIC_CAMERA_SCOPE(STAT_DynamicCamera_SolverWait);
+
+		const uint32 startCycles = FPlatformTime::Cycles();
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(Task, ENamedThreads::GameThread_Local);
+		waitCycles = FPlatformTime::Cycles() - startCycles;
+	}
+	Task = nullptr;
+
+	const int32 frontIndex = BackIndex;
+	BackIndex ^= 1;
+
+	// The solve ran off the game thread, minus what the game thread still spent blocked on it.
+	const float savedMs = float((double(Outputs[frontIndex].SolveCycles) - double(waitCycles)) * FPlatformTime::GetSecondsPerCycle() * 1000.0);
+	INC_FLOAT_STAT_BY(STAT_DynamicCamera_SolverSaved, savedMs);
+	CSV_CUSTOM_STAT(DynamicCamera, SolverSavedMs, savedMs, ECsvCustomStatOp::Accumulate);
+
+	OutInput = &Inputs[frontIndex];
+	return &Outputs[frontIndex];
+}
+
+void FDynamicCameraSolver::Reset()
+{
+	Wait();
+}
+
+void FDynamicCameraSolver::Wait()
+{
+	if (Task.IsValid())
+	{
+		FTaskGraphInterface::Get().WaitUntilTaskCompletes(Task, ENamedThreads::GameThread_Local);
+		Task = nullptr;
+	}
+}
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/TaskGraphInterfaces.h"
+
+class AActor;
+
+/// Everything the camera solver reads, copied on the game thread so the solve touches no UObject.
+struct FDynamicCameraSolverInput
+{
+	/// Frame the snapshot was taken in.
+	uint64 Frame = 0;
+	float DeltaTime = 0.f;
+
+	/// Solves the locked state (look at the target) instead of the free state (arm easing and reset).
+	bool bLocked = false;
+
+	/// Identity of the locked target, never dereferenced by the solver.
+	const AActor* Target = nullptr;
+
+	FRotator ControlRotation = FRotator::ZeroRotator;
+	FVector CameraLocation = FVector::ZeroVector;
+	FRotator CameraRotation = FRotator::ZeroRotator;
+
+	/// Locked state.
+	FVector AimPoint = FVector::ZeroVector;
+	bool bTargetLocked = false;
+	float MinPitch = 0.f;
+	float MaxPitch = 0.f;
+	float MinPitchLocked = 0.f;
+	float MaxPitchLocked = 0.f;
+
+	/// Free state.
+	FVector ArmLocation = FVector::ZeroVector;
+	FVector LookAtLocation = FVector::ZeroVector;
+	FVector OwnerForward = FVector::ForwardVector;
+	float OwnerYaw = 0.f;
+	float TargetArmLength = 0.f;
+	FVector SocketOffset = FVector::ZeroVector;
+	float DistanceUnlocked = 0.f;
+	FVector PositionOffsetFree = FVector::ZeroVector;
+
+	/// Reset of the free state.
+	bool bForceReset = false;
+	bool bResetting = false;
+	float ResetTime = 0.f;
+	float TimeBeforeReset = 0.f;
+	/// Cosine of the facing angle the reset is prevented beyond, compared to the forwards dot product without acos.
+	float CosFacingAngleNotResetting = 1.f;
+	float ResetRate = 0.f;
+
+	float RotationInterpSpeed = 0.f;
+};
+
+/// What the camera applies from a solve.
+struct FDynamicCameraSolverOutput
+{
+	uint64 Frame = 0;
+
+	/// Locked state.
+	FRotator ControlRotation = FRotator::ZeroRotator;
+
+	/// Free state.
+	float TargetArmLength = 0.f;
+	FVector SocketOffset = FVector::ZeroVector;
+	float YawInput = 0.f;
+	float PitchInput = 0.f;
+
+	/// Reset state after the solve.
+	bool bForceReset = false;
+	bool bResetting = false;
+	float ResetTime = 0.f;
+	bool bResetSettled = false;
+
+	/// Duration of the solve, in cycles.
+	uint32 SolveCycles = 0;
+};
+
+/**
+ * Camera state math (DoActionLocked, DoActionFree, LookAt, MoveCamera and ResetCamera) as pure functions of a snapshot,
+ * so it can run on a task graph worker overlapped with the game thread.
+ * The snapshot is taken after the owner movement, solved in a task writing the back buffer, and the camera swaps
+ * and applies the front buffer in its own tick, before the spring arm and the camera manager update.
+ */
+class FDynamicCameraSolver
+{
+public:
+	~FDynamicCameraSolver();
+
+	/// Locked state: control rotation easing towards the aim point, pitch clamped.
+	static FRotator SolveLookAt(const FDynamicCameraSolverInput& Input);
+
+	/// Locked state arm easing towards DistanceLocked and the socket offset of NewPos.
+	static void SolveMove(const FDynamicCameraSolverInput& Input, float DistanceLocked, const FVector& NewPos, FVector& OutSocketOffset, float& OutLength);
+
+	/// Free state reset behind the owner, writes the reset inputs and state of Output.
+	static void SolveReset(const FDynamicCameraSolverInput& Input, FDynamicCameraSolverOutput& Output);
+
+	/// Solves the state of Input.
+	static void Solve(const FDynamicCameraSolverInput& Input, FDynamicCameraSolverOutput& Output);
+
+	/// Solves Input on a worker. Waits for the previous dispatch first.
+	void Dispatch(const FDynamicCameraSolverInput& Input);
+
+	/// Waits for the dispatched solve and swaps it to the front.
+	/// <returns>The input and output of the solve, nullptr if nothing was dispatched since the last fetch.</returns>
+	const FDynamicCameraSolverOutput* Fetch(const FDynamicCameraSolverInput*& OutInput);
+
+	bool IsPending() const { return Task.IsValid(); }
+
+	/// Waits for any dispatched solve and drops it.
+	void Reset();
+
+private:
+	void Wait();
+
+	FDynamicCameraSolverInput Inputs[2];
+	FDynamicCameraSolverOutput Outputs[2];
+
+	/// Buffers the worker writes, the other ones are the last fetched solve.
+	int32 BackIndex = 0;
+
+	FGraphEventRef Task;
+};
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "DynamicCameraStates.h"
+
+#include <Camera/PlayerCameraManager.h>
+
+namespace
+{
+	/** Arm length and socket offset tolerance under which the free camera is considered settled. */
+	constexpr float SettledTolerance = 0.5f;
+
+	void SetViewPitchLimits(UDynamicCameraComponent& Camera, float Min, float Max)
+	{
+		// Each camera drives the manager of its own player, not the first local player.
+		if (APlayerCameraManager* CameraManager = Camera.GetOwnerCameraManager())
+		{
+			CameraManager->ViewPitchMin = Min;
+			CameraManager->ViewPitchMax = Max;
+		}
+	}
+}
+
+#pragma region FREE
+
+void FCameraStateFree::Enter(UDynamicCameraComponent& Camera)
+{
+	SetViewPitchLimits(Camera, Camera.MinPitchAngle, Camera.MaxPitchAngle);
+}
+
+void FCameraStateFree::Tick(UDynamicCameraComponent& Camera, float DeltaTime)
+{
+	Camera.DoActionFree();
+}
+
+void FCameraStateFree::Exit(UDynamicCameraComponent& Camera)
+{
+	Camera.EndModeFree();
+	SetViewPitchLimits(Camera, -MAX_FLT, MAX_FLT);
+}
+
+bool FCameraStateFree::IsIdle(const UDynamicCameraComponent& Camera)
+{
+	// A running or upcoming reset keeps the camera awake: the reset timer only advances while ticking.
+	if (Camera.ForceReset || Camera.IsCameraReseting || !Camera.bResetSettled)
+		return false;
+
+	if (Camera.PendingSelection != EPendingTargetSelection::None)
+		return false;
+
+	return FMath::IsNearlyEqual(Camera.TargetArmLength, Camera.DistanceCameraWhenUnlocked, SettledTolerance)
+		&& Camera.SocketOffset.Equals(Camera.PositionOffsetFree, SettledTolerance);
+}
+
+#pragma endregion
+
+#pragma region LOCKED
+
+void FCameraStateLocked::Enter(UDynamicCameraComponent& Camera)
+{
+	Camera.TargetLocked = true;
+}
+
+void FCameraStateLocked::Tick(UDynamicCameraComponent& Camera, float DeltaTime)
+{
+	Camera.DoActionLocked();
+}
+
+void FCameraStateLocked::Exit(UDynamicCameraComponent& Camera)
+{
+	Camera.EndModeLocked();
+}
+
+#pragma endregion
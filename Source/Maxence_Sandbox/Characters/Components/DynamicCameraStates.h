@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DynamicCameraComponent.h"
+
+/**
+ * Camera state policies. Each state describes its enter, tick and exit hooks at compile time,
+ * and the camera dispatches them with a switch on its current CameraStates instead of a reflected delegate.
+ */
+
+/** Camera follows the player controls and resets behind the character. */
+struct FCameraStateFree
+{
+	static void Enter(UDynamicCameraComponent& Camera);
+	static void Tick(UDynamicCameraComponent& Camera, float DeltaTime);
+	static void Exit(UDynamicCameraComponent& Camera);
+
+	/// Whether the state has nothing left to do until the player or the character rotates.
+	static bool IsIdle(const UDynamicCameraComponent& Camera);
+};
+
+/** Camera looks at its current target. */
+struct FCameraStateLocked
+{
+	static void Enter(UDynamicCameraComponent& Camera);
+	static void Tick(UDynamicCameraComponent& Camera, float DeltaTime);
+	static void Exit(UDynamicCameraComponent& Camera);
+
+	static bool IsIdle(const UDynamicCameraComponent& Camera) { return false; }
+};
+
+/** Calls Visitor with the policy of State. CVOID has no policy. */
+template<typename VisitorType>
+void VisitCameraState(CameraStates State, VisitorType&& Visitor)
+{
+	switch (State)
+	{
+	case CameraStates::FREE:
+		Visitor(FCameraStateFree());
+		break;
+	case CameraStates::LOCKED:
+		Visitor(FCameraStateLocked());
+		break;
+	default:
+		break;
+	}
+}
+
+/** Returns Visitor's result for the policy of State, Fallback for CVOID. */
+template<typename ResultType, typename VisitorType>
+ResultType VisitCameraState(CameraStates State, VisitorType&& Visitor, ResultType Fallback)
+{
+	switch (State)
+	{
+	case CameraStates::FREE:
+		return Visitor(FCameraStateFree());
+	case CameraStates::LOCKED:
+		return Visitor(FCameraStateLocked());
+	default:
+		return Fallback;
+	}
+}
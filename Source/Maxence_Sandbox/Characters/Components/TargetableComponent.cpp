@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetableComponent.h"
+
+#include <GameFramework/Actor.h>
+#include <Characters/Interfaces/Targetable.h>
+#include <Targeting/TargetingSubsystem.h>
+
+UTargetableComponent::UTargetableComponent()
+{
+	// Per-target work runs in the targeting subsystem batched tick.
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+void UTargetableComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AActor* Owner = GetOwner();
+
+	// Resolved once: the reflected events are skipped entirely when no Blueprint implements them.
+	bHasBlueprintLockChanged = GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(UTargetableComponent, ReceiveLockChanged));
+	bHasBlueprintToggleLock = Owner->GetClass()->ImplementsInterface(UTargetable::StaticClass())
+		&& Owner->GetClass()->IsFunctionImplementedInBlueprint(GET_FUNCTION_NAME_CHECKED(ITargetable, ToggleLock));
+
+	AimComponent = nullptr;
+	if (!AimSocket.IsNone())
+	{
+		TInlineComponentArray<USceneComponent*> SceneComponents(Owner);
+		for (USceneComponent* SceneComponent : SceneComponents)
+		{
+			if (SceneComponent->DoesSocketExist(AimSocket))
+			{
+				AimComponent = SceneComponent;
+				break;
+			}
+		}
+	}
+
+	TargetingSubsystem = UTargetingSubsystem::Get(this);
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->RegisterTargetable(this);
+	}
+}
+
+void UTargetableComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->UnregisterTarget(GetOwner());
+		TargetingSubsystem = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UTargetableComponent::SetRegistered(bool bRegistered)
+{
+	if (!bRegistered)
+	{
+		SetLocked(false);
+
+		if (TargetingSubsystem)
+		{
+			TargetingSubsystem->UnregisterTarget(GetOwner());
+		}
+		return;
+	}
+
+	if (TargetingSubsystem == nullptr)
+	{
+		TargetingSubsystem = UTargetingSubsystem::Get(this);
+	}
+
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->RegisterTargetable(this);
+	}
+}
+
+void UTargetableComponent::NotifyTargetDestroyed()
+{
+	SetRegistered(false);
+}
+
+void UTargetableComponent::SetLocked(bool bLocked)
+{
+	if (bLocked == bIsLocked)
+		return;
+
+	bIsLocked = bLocked;
+
+	if (TargetingSubsystem)
+	{
+		TargetingSubsystem->SetTargetLocked(GetOwner(), bLocked);
+	}
+
+	NativeOnLockChanged(bLocked);
+	OnLockChanged.Broadcast(this, bLocked);
+
+	if (bHasBlueprintLockChanged)
+	{
+		ReceiveLockChanged(bLocked);
+	}
+
+	if (bHasBlueprintToggleLock)
+	{
+		ITargetable::Execute_ToggleLock(GetOwner(), bLocked);
+	}
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "TargetableComponent.generated.h"
+
+class UTargetingSubsystem;
+
+DECLARE_MULTICAST_DELEGATE_TwoParams(FTargetableLockChanged, class UTargetableComponent*, bool);
+
+/**
+ * Makes its owner a lock-on target. Registers the owner in the targeting subsystem at BeginPlay, where its aim socket
+ * and priority live in contiguous arrays next to the other targets.
+ *
+ * Lock changes go through the native SetLocked. The ReceiveLockChanged event and the owner ITargetable::ToggleLock
+ * Blueprint event are only sent when a Blueprint implements them. ITargetable stays for actors without the component.
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class MAXENCE_SANDBOX_API UTargetableComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTargetableComponent();
+
+	/// Notifies the target that a camera locked or released it.
+	virtual void SetLocked(bool bLocked);
+
+	bool IsLocked() const { return bIsLocked; }
+
+	/// Adds the owner to the targeting index or removes it, without waiting for BeginPlay or EndPlay.
+	/// Used by the target pool: a released target is unlocked first.
+	void SetRegistered(bool bRegistered);
+
+	/// Takes the owner out of targeting right away, for targets that die before their actor goes away.
+	/// The cameras locked on it release it and retarget at once.
+	UFUNCTION(BlueprintCallable, Category = "Targeting")
+		void NotifyTargetDestroyed();
+
+	/// Mesh the aim socket is read from, nullptr when the aim point is the owner root plus AimOffset.
+	USceneComponent* GetAimComponent() const { return AimComponent; }
+
+	/// Native listeners of SetLocked, called before the Blueprint events.
+	FTargetableLockChanged OnLockChanged;
+
+	/** Socket the cameras look at. None uses AimOffset from the owner root. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Targeting")
+		FName AimSocket;
+
+	/** Aim point relative to the owner root when there is no aim socket. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Targeting")
+		FVector AimOffset = FVector::ZeroVector;
+
+	/** Selection priority, higher is picked first among comparable targets. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Targeting")
+		float Priority = 1.f;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/// Native lock hook for subclasses.
+	virtual void NativeOnLockChanged(bool bLocked) {}
+
+	/** Called when a camera locks or releases the owner. */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Targeting", meta = (DisplayName = "On Lock Changed"))
+		void ReceiveLockChanged(bool bLocked);
+
+private:
+	UPROPERTY(Transient)
+		USceneComponent* AimComponent = nullptr;
+
+	UPROPERTY(Transient)
+		UTargetingSubsystem* TargetingSubsystem = nullptr;
+
+	bool bIsLocked = false;
+
+	/// Whether the Blueprint events are implemented, resolved once at BeginPlay.
+	bool bHasBlueprintLockChanged = false;
+	bool bHasBlueprintToggleLock = false;
+};
@@ -2,25 +2,25 @@
 
 
 #include "Dummy.h"
+#include "Characters/Components/TargetableComponent.h"
+#include "Gamemodes/SandboxAssets.h"
 
 // Sets default values
 ADummy::ADummy()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Per-target work runs in the targeting subsystem batched tick. Blueprints with an Event Tick still turn it back on.
+	PrimaryActorTick.bCanEverTick = false;
+
+	Targetable = CreateDefaultSubobject<UTargetableComponent>(TEXT("Targetable"));
 }
 
 // Called when the game starts or when spawned
 void ADummy::BeginPlay()
 {
 	Super::BeginPlay();
-	
 }
 
-// Called every frame
-void ADummy::Tick(float DeltaTime)
+FPrimaryAssetId ADummy::GetPrimaryAssetId() const
 {
-	Super::Tick(DeltaTime);
-
+	return FSandboxAssets::GetBlueprintAssetId(this, FSandboxAssets::EnemyType);
 }
-
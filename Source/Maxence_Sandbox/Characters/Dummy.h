@@ -21,8 +21,12 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
+	/** Registers the actor as a lock-on target. */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Targeting")
+		class UTargetableComponent* Targetable;
+
+public:
+	// Blueprints of the dummy are Enemy primary assets, preloaded while the map loads
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
 
 };
@@ -3,3 +3,23 @@
 
 #include "Targetable.h"
 
+#include <Characters/Components/TargetableComponent.h>
+#include <GameFramework/Actor.h>
+#include <Targeting/TargetingSubsystem.h>
+
+void ITargetable::NotifyTargetDestroyed()
+{
+	AActor* Actor = Cast<AActor>(_getUObject());
+	if (Actor == nullptr)
+		return;
+
+	// Through the component, which releases its lock before leaving the index.
+	if (UTargetableComponent* Targetable = Actor->FindComponentByClass<UTargetableComponent>())
+	{
+		Targetable->NotifyTargetDestroyed();
+	}
+	else if (UTargetingSubsystem* TargetingSubsystem = UTargetingSubsystem::Get(Actor))
+	{
+		TargetingSubsystem->UnregisterTarget(Actor);
+	}
+}
@@ -6,6 +6,7 @@
 #include "UObject/Interface.h"
 #include "Materials/Material.h"
 #include "Components/StaticMeshComponent.h"
+#include "Targeting/TargetSignificance.h"
 #include "Targetable.generated.h"
 
 // This class does not need to be modified.
@@ -28,4 +29,18 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent, Category = "Interfaces")
 		void ToggleLock(bool IsLocked);
 
+	/// Applies the update rates of the significance level picked by the targeting subsystem. Native targets only.
+	virtual void ApplySignificance(const FTargetSignificanceLevel& Level) {}
+
+	/// Resets the gameplay state of the target when the target pool hands it out. Native targets only.
+	virtual void OnAcquiredFromPool() {}
+
+	/// Stops the target when it goes back to the target pool, before it is hidden. Native targets only.
+	virtual void OnReleasedToPool() {}
+
+	/// Takes the target out of targeting right away, for targets that die before their actor goes away.
+	/// Cameras drop it from their candidates and the ones locked on it retarget at once.
+	/// Blueprints call UTargetableComponent::NotifyTargetDestroyed or UTargetingSubsystem::UnregisterTarget.
+	void NotifyTargetDestroyed();
+
 };
@@ -9,6 +9,7 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/Controller.h"
 #include "GameFramework/SpringArmComponent.h"
+#include "Gamemodes/SandboxAssets.h"
 
 //////////////////////////////////////////////////////////////////////////
 // AMaxence_SandboxCharacter
@@ -59,7 +60,7 @@ void AMaxence_SandboxCharacter::SetupPlayerInputComponent(class UInputComponent*
 	InputComponent->BindAxis("RightThumbstickXAxisLocked", this, &AMaxence_SandboxCharacter::CameraMoveRightLocked);
 	InputComponent->BindAxis("RightThumbstickYAxis", this, &AMaxence_SandboxCharacter::CameraMoveForward);
 
-	InputComponent->BindAction("RightThumbstickButton", EInputEvent::IE_Pressed, this, &AMaxence_SandboxCharacter::PressedTargettingButton);
+	InputComponent->BindAction("RightThumbstickButton", EInputEvent::IE_Pressed, this, &AMaxence_SandboxCharacter::OnTargettingButton);
 
 }
 
@@ -149,6 +150,21 @@ void AMaxence_SandboxCharacter::CameraMoveForward_Implementation(float _AxisInpu
 	}
 }
 
+void AMaxence_SandboxCharacter::OnTargettingButton()
+{
+	if (TargettingButtonPresses < MAX_uint8)
+		++TargettingButtonPresses;
+
+	PressedTargettingButton();
+}
+
+uint8 AMaxence_SandboxCharacter::ConsumeTargettingButtonPresses()
+{
+	const uint8 Presses = TargettingButtonPresses;
+	TargettingButtonPresses = 0;
+	return Presses;
+}
+
 void AMaxence_SandboxCharacter::PressedTargettingButton_Implementation()
 {
 	if (CameraBoom->TargetLocked)
@@ -160,4 +176,9 @@ void AMaxence_SandboxCharacter::PressedTargettingButton_Implementation()
 		CameraBoom->SetModeLocked(CameraStates::FREE);
 	}
 
-}
\ No newline at end of file
+}
+
+FPrimaryAssetId AMaxence_SandboxCharacter::GetPrimaryAssetId() const
+{
+	return FSandboxAssets::GetBlueprintAssetId(this, FSandboxAssets::PlayerCharacterType);
+}
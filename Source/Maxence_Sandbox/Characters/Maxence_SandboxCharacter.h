@@ -11,6 +11,9 @@ class AMaxence_SandboxCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	/// Feeds recorded movement input.
+	friend class FCameraReplay;
+
 	/** Camera boom positioning the camera behind the character */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Camera, meta = (AllowPrivateAccess = "true"))
 	class UDynamicCameraComponent* CameraBoom;
@@ -61,12 +64,21 @@ protected:
 	/** Handler for when a touch input stops. */
 	void TouchStopped(ETouchIndex::Type FingerIndex, FVector Location);
 
+	/** Bound on the targeting button, counts the presses for the camera recorder. */
+	void OnTargettingButton();
+
+	/** Targeting button presses not consumed by the camera recorder yet. */
+	uint8 TargettingButtonPresses = 0;
+
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
 
 public:
+	/** Blueprints of the character are PlayerCharacter primary assets, preloaded while the map loads. */
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class UDynamicCameraComponent* GetCameraBoom() const { return CameraBoom; }
 
@@ -81,6 +93,9 @@ public:
 	UFUNCTION(BlueprintNativeEvent, Category = "CameraMovement")
 		void CameraMoveForward(float _AxisInput);
 
+	/** Returns and resets the targeting button presses since the last call. */
+	uint8 ConsumeTargettingButtonPresses();
+
 	/** Function bound on Right thumbstick input (ie: R3Button). */
 	UFUNCTION(BlueprintNativeEvent, Category = "Misc")
 	void PressedTargettingButton();
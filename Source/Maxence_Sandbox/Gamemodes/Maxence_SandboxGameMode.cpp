@@ -1,15 +1,82 @@
 // Copyright 1998-2019 Epic Games, Inc. All Rights Reserved.
 
 #include "Gamemodes/Maxence_SandboxGameMode.h"
+#include "Gamemodes/StartupLoadSubsystem.h"
 #include "Characters/Maxence_SandboxCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "Engine/AssetManager.h"
+#include "GameFramework/PlayerController.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogSandboxGameMode, Log, All);
 
 AMaxence_SandboxGameMode::AMaxence_SandboxGameMode()
 {
-	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/_Sandbox/Blueprints/BP_SandboxCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	// set default pawn class to our Blueprinted character, resolved when the game starts
+	PlayerPawnClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/_Sandbox/Blueprints/BP_SandboxCharacter.BP_SandboxCharacter_C")));
+}
+
+void AMaxence_SandboxGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	if (PlayerPawnClass.IsNull())
+		return;
+
+	// Usually already there, preloaded with the PlayerCharacter primary assets.
+	if (UClass* Class = PlayerPawnClass.Get())
+	{
+		DefaultPawnClass = Class;
+		return;
+	}
+
+	// Set first: the completion delegate may run from RequestAsyncLoad itself.
+	bPlayerPawnClassPending = true;
+	PlayerPawnClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(PlayerPawnClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &AMaxence_SandboxGameMode::OnPlayerPawnClassLoaded), FStreamableManager::AsyncLoadHighPriority);
+
+	// No request, e.g. an invalid path: nothing will call back.
+	if (!PlayerPawnClassHandle.IsValid())
+	{
+		OnPlayerPawnClassLoaded();
+	}
+}
+
+void AMaxence_SandboxGameMode::RestartPlayer(AController* NewPlayer)
+{
+	if (bPlayerPawnClassPending)
+	{
+		PendingPlayers.AddUnique(NewPlayer);
+		return;
+	}
+
+	Super::RestartPlayer(NewPlayer);
+}
+
+void AMaxence_SandboxGameMode::OnPlayerPawnClassLoaded()
+{
+	if (UClass* Class = PlayerPawnClass.Get())
+	{
+		DefaultPawnClass = Class;
+	}
+	else
+	{
+		UE_LOG(LogSandboxGameMode, Warning, TEXT("Cannot load the player pawn class %s"), *PlayerPawnClass.ToString());
+	}
+
+	// DefaultPawnClass keeps the class loaded.
+	PlayerPawnClassHandle.Reset();
+	bPlayerPawnClassPending = false;
+
+	if (UStartupLoadSubsystem* StartupLoad = UStartupLoadSubsystem::Get(this))
+	{
+		StartupLoad->MarkPhase(TEXT("PawnClassLoaded"));
+	}
+
+	TArray<TWeakObjectPtr<AController>> Players = MoveTemp(PendingPlayers);
+	for (const TWeakObjectPtr<AController>& Player : Players)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		if (Player.IsValid() && Player->GetPawn() == nullptr && PlayerCanRestart(Cast<APlayerController>(Player.Get())))
+		{
+			RestartPlayer(Player.Get());
+		}
 	}
 }
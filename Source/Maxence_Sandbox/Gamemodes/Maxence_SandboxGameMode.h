@@ -6,13 +6,36 @@
 #include "GameFramework/GameModeBase.h"
 #include "Maxence_SandboxGameMode.generated.h"
 
-UCLASS(minimalapi)
+struct FStreamableHandle;
+
+UCLASS(minimalapi, config=Game)
 class AMaxence_SandboxGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
 public:
 	AMaxence_SandboxGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	/** Players restarting before the pawn class is loaded spawn once it is. */
+	virtual void RestartPlayer(AController* NewPlayer) override;
+
+protected:
+	/** Pawn of the players, loaded asynchronously while the map loads instead of with the game mode class. */
+	UPROPERTY(config, EditDefaultsOnly, Category = "Classes")
+		TSoftClassPtr<APawn> PlayerPawnClass;
+
+private:
+	void OnPlayerPawnClassLoaded();
+
+	TSharedPtr<FStreamableHandle> PlayerPawnClassHandle;
+
+	/** Set until OnPlayerPawnClassLoaded resolved DefaultPawnClass. The handle reports the load done before that. */
+	bool bPlayerPawnClassPending = false;
+
+	/** Players waiting for the pawn class. */
+	TArray<TWeakObjectPtr<AController>> PendingPlayers;
 };
 
 
@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxAssets.h"
+
+#include <Misc/PackageName.h>
+#include <UObject/Class.h>
+#include <UObject/Package.h>
+
+const FPrimaryAssetType FSandboxAssets::PlayerCharacterType(TEXT("PlayerCharacter"));
+const FPrimaryAssetType FSandboxAssets::EnemyType(TEXT("Enemy"));
+
+FPrimaryAssetId FSandboxAssets::GetBlueprintAssetId(const UObject* Object, FPrimaryAssetType Type)
+{
+	// Blueprint default objects live in the blueprint package, named like the asset.
+	if (!Object->HasAnyFlags(RF_ClassDefaultObject) || Object->GetClass()->HasAnyClassFlags(CLASS_Native))
+		return FPrimaryAssetId();
+
+	return FPrimaryAssetId(Type, FPackageName::GetShortFName(Object->GetOutermost()->GetFName()));
+}
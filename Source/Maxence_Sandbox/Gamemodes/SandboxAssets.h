@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/PrimaryAssetId.h"
+
+/**
+ * Primary asset types of the sandbox, scanned by the asset manager (AssetManagerSettings in DefaultGame.ini), so the
+ * startup content is preloaded by id while the map loads instead of being pulled in by hard references.
+ * The ids are asset registry tags, written when a blueprint is saved or cooked. Each type scans its own SpecificAssets,
+ * so the editor guesses the ids of blueprints saved before their native class overrode GetPrimaryAssetId.
+ */
+struct MAXENCE_SANDBOX_API FSandboxAssets
+{
+	/// Playable characters, blueprints of AMaxence_SandboxCharacter.
+	static const FPrimaryAssetType PlayerCharacterType;
+
+	/// Lock-on targets, blueprints of AAICharacter and ADummy.
+	static const FPrimaryAssetType EnemyType;
+
+	/// Id of type Type named after the blueprint Object is the class default object of. Invalid for native classes and instances.
+	static FPrimaryAssetId GetBlueprintAssetId(const UObject* Object, FPrimaryAssetType Type);
+};
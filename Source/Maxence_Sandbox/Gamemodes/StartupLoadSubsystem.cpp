@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "StartupLoadSubsystem.h"
+
+#include <CoreGlobals.h>
+#include <Engine/AssetManager.h>
+#include <Engine/Engine.h>
+#include <Engine/GameInstance.h>
+#include <Engine/World.h>
+#include <GameFramework/Pawn.h>
+#include <GameFramework/PlayerController.h>
+#include <HAL/PlatformMisc.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/CommandLine.h>
+#include <Misc/CoreDelegates.h>
+#include <UObject/UObjectGlobals.h>
+
+#include <Profiling/ProfilingReport.h>
+#include <SandboxSubsystems.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogStartupLoad, Log, All);
+
+UStartupLoadSubsystem* UStartupLoadSubsystem::Get(const UObject* WorldContextObject)
+{
+	return GetGameInstanceSubsystem<UStartupLoadSubsystem>(WorldContextObject);
+}
+
+void UStartupLoadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject(this, &UStartupLoadSubsystem::OnPreLoadMap);
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UStartupLoadSubsystem::OnPostLoadMap);
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &UStartupLoadSubsystem::OnEndFrame);
+
+	MarkPhase(TEXT("GameInstanceInit"));
+
+	UAssetManager* AssetManager = UAssetManager::GetIfValid();
+	if (AssetManager == nullptr)
+		return;
+
+	for (const FPrimaryAssetType& Type : PreloadTypes)
+	{
+		if (!AssetManager->GetPrimaryAssetIdList(Type, PreloadedAssets))
+		{
+			UE_LOG(LogStartupLoad, Warning, TEXT("No %s primary asset to preload: check the SpecificAssets of the type in AssetManagerSettings."), *Type.ToString());
+		}
+	}
+
+	if (PreloadedAssets.Num() > 0)
+	{
+		MarkPhase(TEXT("PreloadRequested"));
+
+		// High priority: the map hard references queue behind the preloaded assets and share their packages.
+		PreloadHandle = AssetManager->LoadPrimaryAssets(PreloadedAssets, TArray<FName>(),
+			FStreamableDelegate::CreateUObject(this, &UStartupLoadSubsystem::OnAssetsPreloaded), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+
+void UStartupLoadSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove(PreLoadMapHandle);
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	if (PreloadHandle.IsValid())
+	{
+		PreloadHandle->CancelHandle();
+		PreloadHandle.Reset();
+	}
+
+	if (UAssetManager* AssetManager = UAssetManager::GetIfValid())
+	{
+		AssetManager->UnloadPrimaryAssets(PreloadedAssets);
+	}
+	PreloadedAssets.Empty();
+
+	Super::Deinitialize();
+}
+
+void UStartupLoadSubsystem::MarkPhase(const TCHAR* Phase)
+{
+	const double Time = FPlatformTime::Seconds() - GStartTime;
+	const double PreviousTime = Phases.Num() > 0 ? Phases.Last().Time : Time;
+	Phases.Add({ Phase, Time });
+
+	UE_LOG(LogStartupLoad, Log, TEXT("%s at %.1fms (+%.1fms)"), Phase, Time * 1000.0, (Time - PreviousTime) * 1000.0);
+}
+
+void UStartupLoadSubsystem::OnAssetsPreloaded()
+{
+	MarkPhase(TEXT("AssetsPreloaded"));
+}
+
+void UStartupLoadSubsystem::OnPreLoadMap(const FString& InMapName)
+{
+	// A travel after the startup load is timed on its own.
+	if (!EndFrameHandle.IsValid())
+	{
+		Phases.Reset();
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddUObject(this, &UStartupLoadSubsystem::OnEndFrame);
+	}
+
+	MapName = InMapName;
+	MarkPhase(TEXT("MapLoadStart"));
+}
+
+void UStartupLoadSubsystem::OnPostLoadMap(UWorld* World)
+{
+	if (World && World->GetGameInstance() == GetGameInstance())
+	{
+		MarkPhase(TEXT("MapLoaded"));
+	}
+}
+
+void UStartupLoadSubsystem::OnEndFrame()
+{
+	UGameInstance* GameInstance = GetGameInstance();
+	APlayerController* PlayerController = GameInstance->GetFirstLocalPlayerController(GameInstance->GetWorld());
+	if (PlayerController == nullptr || PlayerController->GetPawn() == nullptr)
+		return;
+
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+
+	MarkPhase(TEXT("FirstInteractiveFrame"));
+	Report();
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("ExitAfterStartup")))
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UStartupLoadSubsystem::Report()
+{
+	const double StartTime = Phases[0].Time;
+
+	UE_LOG(LogStartupLoad, Log, TEXT("Load of %s: first interactive frame %.1fms after %s, %.1fms after process start"),
+		MapName.IsEmpty() ? TEXT("the startup map") : *MapName, (Phases.Last().Time - StartTime) * 1000.0, *Phases[0].Name, Phases.Last().Time * 1000.0);
+
+	FString Csv = TEXT("Phase,Ms,SincePreviousMs\n");
+	for (int32 Index = 0; Index < Phases.Num(); ++Index)
+	{
+		const double PreviousTime = Index > 0 ? Phases[Index - 1].Time : Phases[Index].Time;
+		Csv += FString::Printf(TEXT("%s,%.2f,%.2f\n"), *Phases[Index].Name, Phases[Index].Time * 1000.0, (Phases[Index].Time - PreviousTime) * 1000.0);
+	}
+
+	FProfilingReport::WriteCsv(Csv, TEXT("Startup"), TEXT("Startup"));
+}
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "UObject/PrimaryAssetId.h"
+#include "StartupLoadSubsystem.generated.h"
+
+struct FStreamableHandle;
+
+/**
+ * Startup loading: preloads the primary assets of PreloadTypes asynchronously from the game instance initialization,
+ * so they stream in while the map loads, and times every load phase up to the first interactive frame, the first frame
+ * ending with a local player in possession of a pawn.
+ *
+ * Each map load is reported in the log and in Saved/Profiling/Startup. Runnable headless:
+ *   UE4Editor Maxence_Sandbox -game -nullrhi -unattended -log -ExitAfterStartup
+ * -ExitAfterStartup quits once the first interactive frame is reported.
+ */
+UCLASS(config = Game)
+class MAXENCE_SANDBOX_API UStartupLoadSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the startup load subsystem of the world context, if any. */
+	static UStartupLoadSubsystem* Get(const UObject* WorldContextObject);
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+
+	/// Records the end of the load phase Phase of the current map load.
+	void MarkPhase(const TCHAR* Phase);
+
+protected:
+	/** Primary asset types preloaded on startup and kept loaded. */
+	UPROPERTY(config)
+		TArray<FPrimaryAssetType> PreloadTypes;
+
+private:
+	struct FPhase
+	{
+		FString Name;
+		/// Seconds since the process started.
+		double Time;
+	};
+
+	void OnAssetsPreloaded();
+
+	void OnPreLoadMap(const FString& MapName);
+	void OnPostLoadMap(UWorld* World);
+
+	/// Reports the load once a local player controls a pawn.
+	void OnEndFrame();
+
+	void Report();
+
+	/// Phases of the current load, in order.
+	TArray<FPhase> Phases;
+
+	/// Map of the current load.
+	FString MapName;
+
+	TArray<FPrimaryAssetId> PreloadedAssets;
+	TSharedPtr<FStreamableHandle> PreloadHandle;
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+	FDelegateHandle EndFrameHandle;
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProfilingReport.h"
+
+#include <Misc/DateTime.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogProfilingReport, Log, All);
+
+bool FProfilingReport::WriteCsv(const FString& Csv, const TCHAR* Folder, const FString& Name)
+{
+	const FString Filename = FPaths::ProfilingDir() / Folder / FString::Printf(TEXT("%s-%s.csv"), *Name, *FDateTime::Now().ToString());
+	if (!FFileHelper::SaveStringToFile(Csv, *Filename))
+	{
+		UE_LOG(LogProfilingReport, Warning, TEXT("Cannot write %s"), *Filename);
+		return false;
+	}
+
+	UE_LOG(LogProfilingReport, Display, TEXT("%s written to %s"), *Name, *Filename);
+	return true;
+}
+
+double FProfilingReport::Percentile(const TArray<double>& SortedValues, double Fraction)
+{
+	if (SortedValues.Num() == 0)
+		return 0.0;
+
+	return SortedValues[FMath::Clamp(FMath::RoundToInt(Fraction * (SortedValues.Num() - 1)), 0, SortedValues.Num() - 1)];
+}
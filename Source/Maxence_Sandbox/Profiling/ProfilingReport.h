@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Output shared by the benchmarks and reports: timestamped CSV files under Saved/Profiling and percentiles. */
+struct MAXENCE_SANDBOX_API FProfilingReport
+{
+	/// Writes Csv to Saved/Profiling/<Folder>/<Name>-<date>.csv and logs its path. Returns false when it cannot be written.
+	static bool WriteCsv(const FString& Csv, const TCHAR* Folder, const FString& Name);
+
+	/// Value at Fraction, from 0 to 1, of SortedValues, sorted in ascending order. 0 when empty.
+	static double Percentile(const TArray<double>& SortedValues, double Fraction);
+};
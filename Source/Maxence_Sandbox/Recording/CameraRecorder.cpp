@@ -0,0 +1,435 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include <Components/InputComponent.h>
+#include <Engine/World.h>
+#include <EngineUtils.h>
+#include <GameFramework/PlayerController.h>
+#include <HAL/IConsoleManager.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/App.h>
+#include <Misc/CoreDelegates.h>
+#include <Misc/Paths.h>
+#include <Kismet/GameplayStatics.h>
+
+#include <Characters/Maxence_SandboxCharacter.h>
+#include <Characters/Components/DynamicCameraComponent.h>
+#include <Profiling/ProfilingReport.h>
+#include <Recording/CameraRecording.h>
+#include <Targeting/TargetingSubsystem.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogCameraRecorder, Log, All);
+
+namespace
+{
+	/** Axes bound by AMaxence_SandboxCharacter::SetupPlayerInputComponent, in FCameraRecordingFrame order. */
+	const FName RecordedAxes[] = {
+		TEXT("MoveForward"),
+		TEXT("MoveRight"),
+		TEXT("RightThumbstickXAxis"),
+		TEXT("RightThumbstickXAxisLocked"),
+		TEXT("RightThumbstickYAxis")
+	};
+
+	FString GetRecordingPath(const FString& Name)
+	{
+		return CameraRecording::GetDirectory() / (FPaths::GetExtension(Name).IsEmpty() ? Name + TEXT(".camrec") : Name);
+	}
+}
+
+/**
+ * Records the first player camera inputs, the registered targets and the camera state every frame:
+ *   DynamicCamera.Record [Name=<file>]   starts, or stops the current recording
+ * Targets registered after the start are not recorded.
+ */
+class FCameraRecorder
+{
+public:
+	static void Run(const TArray<FString>& Args, UWorld* World);
+
+private:
+	bool Start(UWorld* InWorld, const FString& Name);
+	void Stop();
+
+	void OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<AMaxence_SandboxCharacter> Character;
+	TArray<TWeakObjectPtr<AActor>> Targets;
+	TMap<const AActor*, int32> TargetIndices;
+
+	FCameraRecordingWriter Writer;
+	FCameraRecordingFrame Frame;
+	FString Path;
+
+	FDelegateHandle PreActorTickHandle;
+	FDelegateHandle PostActorTickHandle;
+
+	static TUniquePtr<FCameraRecorder> Current;
+};
+
+/**
+ * Re-runs a recording with the recorded frame times, inputs and target locations, runnable headless:
+ *   UE4Editor Maxence_Sandbox <Map> -game -nullrhi -unattended -ExecCmds="DynamicCamera.Replay File=<file> Quit"
+ * Writes the camera tick and game frame time of every frame to Saved/Profiling/CameraReplay, and flags the frames
+ * whose camera state or rotation diverged from the recording.
+ */
+class FCameraReplay
+{
+public:
+	static void Run(const TArray<FString>& Args, UWorld* World);
+
+private:
+	bool Start(UWorld* InWorld, const FString& Name);
+	void Finish();
+
+	void OnBeginFrame();
+	void OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+	void OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds);
+
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<AMaxence_SandboxCharacter> Character;
+	TArray<TWeakObjectPtr<AActor>> Targets;
+
+	FCameraRecordingReader Reader;
+	FCameraRecordingFrame Frame;
+	bool bHasFrame = false;
+	bool bQuit = false;
+
+	bool bWasUsingFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+
+	uint64 FrameStartCycles = 0;
+	TArray<double> CameraTimings;
+	int32 Divergences = 0;
+	FString Csv;
+	FString Name;
+
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle PreActorTickHandle;
+	FDelegateHandle PostActorTickHandle;
+
+	static TUniquePtr<FCameraReplay> Current;
+};
+
+TUniquePtr<FCameraRecorder> FCameraRecorder::Current;
+TUniquePtr<FCameraReplay> FCameraReplay::Current;
+
+static FAutoConsoleCommandWithWorldAndArgs GCameraRecordCommand(
+	TEXT("DynamicCamera.Record"),
+	TEXT("Starts recording the first player camera inputs and state to Saved/Recordings/Camera, or stops the current recording.\n")
+	TEXT("Name=<file>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FCameraRecorder::Run));
+
+static FAutoConsoleCommandWithWorldAndArgs GCameraReplayCommand(
+	TEXT("DynamicCamera.Replay"),
+	TEXT("Replays a camera recording and writes the per-frame targeting timings to Saved/Profiling/CameraReplay.\n")
+	TEXT("File=<file> [Quit]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FCameraReplay::Run));
+
+void FCameraRecorder::Run(const TArray<FString>& Args, UWorld* InWorld)
+{
+	if (Current.IsValid())
+	{
+		Current->Stop();
+		Current.Reset();
+		return;
+	}
+
+	FString Name = FString::Printf(TEXT("Camera-%s"), *FDateTime::Now().ToString());
+	FParse::Value(*FString::Join(Args, TEXT(" ")), TEXT("Name="), Name);
+
+	TUniquePtr<FCameraRecorder> Recorder = MakeUnique<FCameraRecorder>();
+	if (Recorder->Start(InWorld, Name))
+	{
+		Current = MoveTemp(Recorder);
+	}
+}
+
+bool FCameraRecorder::Start(UWorld* InWorld, const FString& Name)
+{
+	AMaxence_SandboxCharacter* PlayerCharacter = Cast<AMaxence_SandboxCharacter>(UGameplayStatics::GetPlayerCharacter(InWorld, 0));
+	UTargetingSubsystem* TargetingSubsystem = UTargetingSubsystem::Get(InWorld);
+	if (PlayerCharacter == nullptr || TargetingSubsystem == nullptr)
+	{
+		UE_LOG(LogCameraRecorder, Warning, TEXT("DynamicCamera.Record needs a player character and the targeting subsystem."));
+		return false;
+	}
+
+	TArray<FString> TargetNames;
+	for (AActor* Target : TargetingSubsystem->GetTargets())
+	{
+		TargetIndices.Add(Target, Targets.Num());
+		Targets.Add(Target);
+		TargetNames.Add(Target->GetName());
+	}
+
+	Path = GetRecordingPath(Name);
+	if (!Writer.Open(Path, TargetNames))
+		return false;
+
+	World = InWorld;
+	Character = PlayerCharacter;
+	PlayerCharacter->ConsumeTargettingButtonPresses();
+
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddRaw(this, &FCameraRecorder::OnPreActorTick);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddRaw(this, &FCameraRecorder::OnPostActorTick);
+
+	UE_LOG(LogCameraRecorder, Log, TEXT("Recording %d targets to %s"), Targets.Num(), *Path);
+	return true;
+}
+
+void FCameraRecorder::Stop()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	const int32 NumFrames = Writer.GetNumFrames();
+	Writer.Close();
+
+	UE_LOG(LogCameraRecorder, Log, TEXT("Recorded %d frames to %s (%lld bytes, %.1f bytes per frame)"),
+		NumFrames, *Path, Writer.GetNumBytes(), NumFrames > 0 ? double(Writer.GetNumBytes()) / NumFrames : 0.0);
+}
+
+void FCameraRecorder::OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != World.Get())
+		return;
+
+	// Targets as the actors will find them this frame, replayed at the same point.
+	Frame.DeltaTime = DeltaSeconds;
+	Frame.TargetLocations.SetNumUninitialized(Targets.Num(), false);
+	for (int32 Index = 0; Index < Targets.Num(); ++Index)
+	{
+		const AActor* Target = Targets[Index].Get();
+		Frame.TargetLocations[Index] = Target ? Target->GetActorLocation() : FVector::ZeroVector;
+	}
+}
+
+void FCameraRecorder::OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != World.Get())
+		return;
+
+	AMaxence_SandboxCharacter* PlayerCharacter = Character.Get();
+	if (PlayerCharacter == nullptr)
+	{
+		Stop();
+		Current.Reset();
+		return;
+	}
+
+	float* const Axes[] = { &Frame.MoveForward, &Frame.MoveRight, &Frame.CameraMoveRight, &Frame.CameraMoveRightLocked, &Frame.CameraMoveForward };
+	for (int32 Axis = 0; Axis < int32(ARRAY_COUNT(RecordedAxes)); ++Axis)
+	{
+		*Axes[Axis] = PlayerCharacter->InputComponent ? PlayerCharacter->InputComponent->GetAxisValue(RecordedAxes[Axis]) : 0.f;
+	}
+
+	UDynamicCameraComponent* Camera = PlayerCharacter->GetCameraBoom();
+	const int32* TargetIndex = TargetIndices.Find(Camera->GetCurrentTarget());
+
+	Frame.TargetingPresses = PlayerCharacter->ConsumeTargettingButtonPresses();
+	Frame.CameraState = uint8(Camera->GetState());
+	Frame.TargetIndex = TargetIndex ? *TargetIndex : INDEX_NONE;
+	Frame.ControlRotation = PlayerCharacter->GetControlRotation();
+	Frame.OwnerLocation = PlayerCharacter->GetActorLocation();
+
+	Writer.Write(Frame);
+}
+
+void FCameraReplay::Run(const TArray<FString>& Args, UWorld* InWorld)
+{
+	if (Current.IsValid())
+	{
+		UE_LOG(LogCameraRecorder, Warning, TEXT("A replay is already running."));
+		return;
+	}
+
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	FString File;
+	if (!FParse::Value(*Command, TEXT("File="), File))
+	{
+		UE_LOG(LogCameraRecorder, Warning, TEXT("DynamicCamera.Replay File=<file> [Quit]"));
+		return;
+	}
+
+	TUniquePtr<FCameraReplay> Replay = MakeUnique<FCameraReplay>();
+	Replay->bQuit = Args.Contains(TEXT("Quit"));
+	if (Replay->Start(InWorld, File))
+	{
+		Current = MoveTemp(Replay);
+	}
+}
+
+bool FCameraReplay::Start(UWorld* InWorld, const FString& File)
+{
+	AMaxence_SandboxCharacter* PlayerCharacter = Cast<AMaxence_SandboxCharacter>(UGameplayStatics::GetPlayerCharacter(InWorld, 0));
+	if (PlayerCharacter == nullptr || !Reader.Open(GetRecordingPath(File)))
+	{
+		UE_LOG(LogCameraRecorder, Warning, TEXT("DynamicCamera.Replay needs a player character and a readable recording."));
+		return false;
+	}
+
+	// Targets by name, the recording indices map to this array.
+	TMap<FString, AActor*> ActorsByName;
+	for (TActorIterator<AActor> It(InWorld); It; ++It)
+	{
+		ActorsByName.Add(It->GetName(), *It);
+	}
+
+	int32 Missing = 0;
+	for (const FString& TargetName : Reader.GetTargetNames())
+	{
+		AActor* const* Target = ActorsByName.Find(TargetName);
+		Missing += Target == nullptr;
+		Targets.Add(Target ? *Target : nullptr);
+	}
+
+	if (Missing > 0)
+	{
+		UE_LOG(LogCameraRecorder, Warning, TEXT("%d of the %d recorded targets are missing from this world."), Missing, Targets.Num());
+	}
+
+	World = InWorld;
+	Character = PlayerCharacter;
+	Name = FPaths::GetBaseFilename(File);
+
+	// The recording is the only input.
+	if (APlayerController* Controller = Cast<APlayerController>(PlayerCharacter->GetController()))
+	{
+		PlayerCharacter->DisableInput(Controller);
+	}
+
+	bWasUsingFixedTimeStep = FApp::UseFixedTimeStep();
+	PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+
+	Csv = TEXT("Frame,DeltaTimeMs,CameraTickMs,GameThreadMs,CameraState,TargetIndex,Diverged\n");
+
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddRaw(this, &FCameraReplay::OnBeginFrame);
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddRaw(this, &FCameraReplay::OnPreActorTick);
+	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddRaw(this, &FCameraReplay::OnPostActorTick);
+
+	UE_LOG(LogCameraRecorder, Log, TEXT("Replaying %s with %d targets"), *File, Targets.Num());
+	return true;
+}
+
+void FCameraReplay::OnBeginFrame()
+{
+	bHasFrame = Character.IsValid() && Reader.Read(Frame);
+	if (!bHasFrame)
+	{
+		Finish();
+		return;
+	}
+
+	// The engine picks the frame time up right after this.
+	FApp::SetFixedDeltaTime(Frame.DeltaTime);
+	FrameStartCycles = FPlatformTime::Cycles64();
+}
+
+void FCameraReplay::OnPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != World.Get() || !bHasFrame)
+		return;
+
+	AMaxence_SandboxCharacter* PlayerCharacter = Character.Get();
+
+	// Start from the recorded pose, the inputs drive it afterwards.
+	if (Reader.GetFrameIndex() == 1)
+	{
+		PlayerCharacter->SetActorLocation(Frame.OwnerLocation, false, nullptr, ETeleportType::TeleportPhysics);
+		if (AController* Controller = PlayerCharacter->GetController())
+		{
+			Controller->SetControlRotation(Frame.ControlRotation);
+		}
+	}
+
+	for (int32 Index = 0; Index < Targets.Num(); ++Index)
+	{
+		if (AActor* Target = Targets[Index].Get())
+		{
+			Target->SetActorLocation(Frame.TargetLocations[Index], false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+
+	PlayerCharacter->MoveForward(Frame.MoveForward);
+	PlayerCharacter->MoveRight(Frame.MoveRight);
+	PlayerCharacter->CameraMoveRight(Frame.CameraMoveRight);
+	PlayerCharacter->CameraMoveRightLocked(Frame.CameraMoveRightLocked);
+	PlayerCharacter->CameraMoveForward(Frame.CameraMoveForward);
+	for (uint8 Press = 0; Press < Frame.TargetingPresses; ++Press)
+	{
+		PlayerCharacter->PressedTargettingButton();
+	}
+}
+
+void FCameraReplay::OnPostActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaSeconds)
+{
+	if (InWorld != World.Get() || !bHasFrame)
+		return;
+
+	AMaxence_SandboxCharacter* PlayerCharacter = Character.Get();
+	UDynamicCameraComponent* Camera = PlayerCharacter->GetCameraBoom();
+
+	const AActor* CurrentTarget = Camera->GetCurrentTarget();
+	const int32 TargetIndex = CurrentTarget ? Targets.IndexOfByKey(CurrentTarget) : INDEX_NONE;
+	const bool bDiverged = uint8(Camera->GetState()) != Frame.CameraState
+		|| TargetIndex != Frame.TargetIndex
+		|| !PlayerCharacter->GetControlRotation().Equals(Frame.ControlRotation, 1.f);
+
+	if (bDiverged && Divergences++ == 0)
+	{
+		UE_LOG(LogCameraRecorder, Warning, TEXT("Replay diverged from the recording at frame %d"), Reader.GetFrameIndex());
+	}
+
+	const double CameraMs = FPlatformTime::ToMilliseconds(Camera->GetLastTickCycles());
+	const double GameThreadMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles);
+	CameraTimings.Add(CameraMs);
+
+	Csv += FString::Printf(TEXT("%d,%.3f,%.4f,%.3f,%d,%d,%d\n"),
+		Reader.GetFrameIndex(), Frame.DeltaTime * 1000.f, CameraMs, GameThreadMs, uint8(Camera->GetState()), TargetIndex, bDiverged ? 1 : 0);
+}
+
+void FCameraReplay::Finish()
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+
+	FApp::SetUseFixedTimeStep(bWasUsingFixedTimeStep);
+	FApp::SetFixedDeltaTime(PreviousFixedDeltaTime);
+
+	if (AMaxence_SandboxCharacter* PlayerCharacter = Character.Get())
+	{
+		if (APlayerController* Controller = Cast<APlayerController>(PlayerCharacter->GetController()))
+		{
+			PlayerCharacter->EnableInput(Controller);
+		}
+	}
+
+	if (CameraTimings.Num() > 0)
+	{
+		CameraTimings.Sort();
+		UE_LOG(LogCameraRecorder, Log, TEXT("Replayed %d frames: camera tick p50 %.4fms p99 %.4fms max %.4fms, %d diverged frames"),
+			CameraTimings.Num(), FProfilingReport::Percentile(CameraTimings, 0.5), FProfilingReport::Percentile(CameraTimings, 0.99), CameraTimings.Last(), Divergences);
+
+		FProfilingReport::WriteCsv(Csv, TEXT("CameraReplay"), Name);
+	}
+
+	const bool bShouldQuit = bQuit;
+	Reader.Close();
+	Current.Reset();
+
+	if (bShouldQuit)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,446 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CameraRecording.h"
+
+#include <Async/MappedFileHandle.h>
+#include <HAL/FileManager.h>
+#include <HAL/PlatformFilemanager.h>
+#include <Misc/FileHelper.h>
+#include <Misc/Paths.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogCameraRecording, Log, All);
+
+namespace
+{
+	/** Frames are written to the file by chunks of this size. */
+	constexpr int32 FlushSize = 64 * 1024;
+
+	constexpr int32 NumAxes = 5;
+	constexpr float AxisScale = MAX_int16;
+
+	enum EFrameMask : uint8
+	{
+		FM_Axes = (1 << NumAxes) - 1,
+		FM_TargetingPresses = 1 << 5,
+		FM_CameraState = 1 << 6,
+		FM_Pose = 1 << 7
+	};
+
+	uint32 ZigZag(int32 Value)
+	{
+		return (uint32(Value) << 1) ^ uint32(Value >> 31);
+	}
+
+	int32 UnZigZag(uint32 Value)
+	{
+		return int32(Value >> 1) ^ -int32(Value & 1);
+	}
+
+	void WriteVarInt(TArray<uint8>& Buffer, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Buffer.Add(uint8((Value & 0x7f) | 0x80));
+			Value >>= 7;
+		}
+		Buffer.Add(uint8(Value));
+	}
+
+	void WriteSigned(TArray<uint8>& Buffer, int32 Value)
+	{
+		WriteVarInt(Buffer, ZigZag(Value));
+	}
+
+	template<typename T>
+	void WriteRaw(TArray<uint8>& Buffer, T Value)
+	{
+		Buffer.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+	}
+
+	bool ReadVarInt(const uint8*& Cursor, const uint8* End, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (int32 Shift = 0; Shift < 35; Shift += 7)
+		{
+			if (Cursor >= End)
+				return false;
+
+			const uint8 Byte = *Cursor++;
+			OutValue |= uint32(Byte & 0x7f) << Shift;
+			if ((Byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	bool ReadSigned(const uint8*& Cursor, const uint8* End, int32& OutValue)
+	{
+		uint32 Value;
+		if (!ReadVarInt(Cursor, End, Value))
+			return false;
+
+		OutValue = UnZigZag(Value);
+		return true;
+	}
+
+	template<typename T>
+	bool ReadRaw(const uint8*& Cursor, const uint8* End, T& OutValue)
+	{
+		if (End - Cursor < int64(sizeof(T)))
+			return false;
+
+		FMemory::Memcpy(&OutValue, Cursor, sizeof(T));
+		Cursor += sizeof(T);
+		return true;
+	}
+
+	int16 QuantizeAxis(float Value)
+	{
+		return int16(FMath::RoundToInt(FMath::Clamp(Value, -1.f, 1.f) * AxisScale));
+	}
+
+	FIntVector QuantizeLocation(const FVector& Location)
+	{
+		return FIntVector(FMath::RoundToInt(Location.X), FMath::RoundToInt(Location.Y), FMath::RoundToInt(Location.Z));
+	}
+
+	void WriteLocationDelta(TArray<uint8>& Buffer, const FIntVector& Location, const FIntVector& Previous)
+	{
+		WriteSigned(Buffer, Location.X - Previous.X);
+		WriteSigned(Buffer, Location.Y - Previous.Y);
+		WriteSigned(Buffer, Location.Z - Previous.Z);
+	}
+
+	bool ReadLocationDelta(const uint8*& Cursor, const uint8* End, FIntVector& InOutLocation)
+	{
+		int32 X, Y, Z;
+		if (!ReadSigned(Cursor, End, X) || !ReadSigned(Cursor, End, Y) || !ReadSigned(Cursor, End, Z))
+			return false;
+
+		InOutLocation += FIntVector(X, Y, Z);
+		return true;
+	}
+}
+
+FString CameraRecording::GetDirectory()
+{
+	return FPaths::ProjectSavedDir() / TEXT("Recordings") / TEXT("Camera");
+}
+
+FCameraRecordingWriter::~FCameraRecordingWriter()
+{
+	Close();
+}
+
+bool FCameraRecordingWriter::Open(const FString& Path, const TArray<FString>& TargetNames)
+{
+	Close();
+
+	File.Reset(IFileManager::Get().CreateFileWriter(*Path));
+	if (!File.IsValid())
+	{
+		UE_LOG(LogCameraRecording, Warning, TEXT("Cannot create %s"), *Path);
+		return false;
+	}
+
+	Previous = FQuantizedFrame();
+	Previous.TargetLocations.SetNumZeroed(TargetNames.Num());
+	NumFrames = 0;
+	NumBytes = 0;
+
+	Buffer.Reset(FlushSize);
+	WriteRaw(Buffer, CameraRecording::Magic);
+	WriteRaw(Buffer, CameraRecording::Version);
+	WriteVarInt(Buffer, TargetNames.Num());
+	for (const FString& Name : TargetNames)
+	{
+		const FTCHARToUTF8 Utf8(*Name);
+		WriteVarInt(Buffer, Utf8.Length());
+		Buffer.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+	}
+
+	return true;
+}
+
+void FCameraRecordingWriter::Write(const FCameraRecordingFrame& Frame)
+{
+	check(File.IsValid());
+
+	const int32 DeltaTimeMicroseconds = FMath::RoundToInt(Frame.DeltaTime * 1.0e6f);
+	WriteSigned(Buffer, DeltaTimeMicroseconds - Previous.DeltaTimeMicroseconds);
+	Previous.DeltaTimeMicroseconds = DeltaTimeMicroseconds;
+
+	const int16 Axes[NumAxes] = {
+		QuantizeAxis(Frame.MoveForward),
+		QuantizeAxis(Frame.MoveRight),
+		QuantizeAxis(Frame.CameraMoveRight),
+		QuantizeAxis(Frame.CameraMoveRightLocked),
+		QuantizeAxis(Frame.CameraMoveForward)
+	};
+	const uint16 Rotation[3] = {
+		FRotator::CompressAxisToShort(Frame.ControlRotation.Pitch),
+		FRotator::CompressAxisToShort(Frame.ControlRotation.Yaw),
+		FRotator::CompressAxisToShort(Frame.ControlRotation.Roll)
+	};
+	const FIntVector Location = QuantizeLocation(Frame.OwnerLocation);
+
+	uint8 Mask = 0;
+	for (int32 Axis = 0; Axis < NumAxes; ++Axis)
+	{
+		Mask |= Axes[Axis] != Previous.Axes[Axis] ? 1 << Axis : 0;
+	}
+	Mask |= Frame.TargetingPresses != 0 ? FM_TargetingPresses : 0;
+	Mask |= Frame.CameraState != Previous.CameraState || Frame.TargetIndex != Previous.TargetIndex ? FM_CameraState : 0;
+	Mask |= FMemory::Memcmp(Rotation, Previous.Rotation, sizeof(Rotation)) != 0 || Location != Previous.Location ? FM_Pose : 0;
+	Buffer.Add(Mask);
+
+	for (int32 Axis = 0; Axis < NumAxes; ++Axis)
+	{
+		if (Mask & (1 << Axis))
+		{
+			WriteRaw(Buffer, Axes[Axis]);
+			Previous.Axes[Axis] = Axes[Axis];
+		}
+	}
+
+	if (Mask & FM_TargetingPresses)
+	{
+		Buffer.Add(Frame.TargetingPresses);
+	}
+
+	if (Mask & FM_CameraState)
+	{
+		Buffer.Add(Frame.CameraState);
+		WriteVarInt(Buffer, uint32(Frame.TargetIndex + 1));
+		Previous.CameraState = Frame.CameraState;
+		Previous.TargetIndex = Frame.TargetIndex;
+	}
+
+	if (Mask & FM_Pose)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			// Wrapping 16 bits difference, a turn across 0 stays a small delta.
+			WriteSigned(Buffer, int16(Rotation[Axis] - Previous.Rotation[Axis]));
+			Previous.Rotation[Axis] = Rotation[Axis];
+		}
+		WriteLocationDelta(Buffer, Location, Previous.Location);
+		Previous.Location = Location;
+	}
+
+	// Moved targets only, as index gaps from the previous moved one.
+	const int32 NumTargets = FMath::Min(Frame.TargetLocations.Num(), Previous.TargetLocations.Num());
+	TArray<int32, TInlineAllocator<64>> Moved;
+	for (int32 Index = 0; Index < NumTargets; ++Index)
+	{
+		if (QuantizeLocation(Frame.TargetLocations[Index]) != Previous.TargetLocations[Index])
+		{
+			Moved.Add(Index);
+		}
+	}
+
+	WriteVarInt(Buffer, Moved.Num());
+	int32 PreviousIndex = -1;
+	for (int32 Index : Moved)
+	{
+		const FIntVector TargetLocation = QuantizeLocation(Frame.TargetLocations[Index]);
+		WriteVarInt(Buffer, Index - PreviousIndex - 1);
+		WriteLocationDelta(Buffer, TargetLocation, Previous.TargetLocations[Index]);
+		Previous.TargetLocations[Index] = TargetLocation;
+		PreviousIndex = Index;
+	}
+
+	++NumFrames;
+
+	if (Buffer.Num() >= FlushSize)
+	{
+		Flush();
+	}
+}
+
+void FCameraRecordingWriter::Close()
+{
+	if (!File.IsValid())
+		return;
+
+	Flush();
+	File->Close();
+	File.Reset();
+}
+
+void FCameraRecordingWriter::Flush()
+{
+	File->Serialize(Buffer.GetData(), Buffer.Num());
+	NumBytes += Buffer.Num();
+	Buffer.Reset(FlushSize);
+}
+
+FCameraRecordingReader::~FCameraRecordingReader()
+{
+	Close();
+}
+
+bool FCameraRecordingReader::Open(const FString& Path)
+{
+	Close();
+
+	MappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path);
+	if (MappedFile)
+	{
+		MappedRegion = MappedFile->MapRegion(0, MappedFile->GetFileSize());
+	}
+
+	if (MappedRegion)
+	{
+		Cursor = MappedRegion->GetMappedPtr();
+		End = Cursor + MappedRegion->GetMappedSize();
+	}
+	else if (FFileHelper::LoadFileToArray(LoadedFile, *Path))
+	{
+		Cursor = LoadedFile.GetData();
+		End = Cursor + LoadedFile.Num();
+	}
+	else
+	{
+		UE_LOG(LogCameraRecording, Warning, TEXT("Cannot open %s"), *Path);
+		Close();
+		return false;
+	}
+
+	uint32 FileMagic = 0;
+	uint16 FileVersion = 0;
+	uint32 NumTargets = 0;
+	if (!ReadRaw(Cursor, End, FileMagic) || FileMagic != CameraRecording::Magic
+		|| !ReadRaw(Cursor, End, FileVersion) || FileVersion != CameraRecording::Version
+		|| !ReadVarInt(Cursor, End, NumTargets))
+	{
+		UE_LOG(LogCameraRecording, Warning, TEXT("%s is not a camera recording of version %d"), *Path, CameraRecording::Version);
+		Close();
+		return false;
+	}
+
+	for (uint32 Index = 0; Index < NumTargets; ++Index)
+	{
+		uint32 Length = 0;
+		if (!ReadVarInt(Cursor, End, Length) || End - Cursor < int64(Length))
+		{
+			Close();
+			return false;
+		}
+
+		const FUTF8ToTCHAR Name(reinterpret_cast<const ANSICHAR*>(Cursor), Length);
+		TargetNames.Add(FString(Name.Length(), Name.Get()));
+		Cursor += Length;
+	}
+
+	TargetLocations.SetNumZeroed(TargetNames.Num());
+	return true;
+}
+
+void FCameraRecordingReader::Close()
+{
+	delete MappedRegion;
+	MappedRegion = nullptr;
+	delete MappedFile;
+	MappedFile = nullptr;
+
+	LoadedFile.Empty();
+	Cursor = End = nullptr;
+
+	TargetNames.Reset();
+	TargetLocations.Reset();
+	DeltaTimeMicroseconds = 0;
+	FMemory::Memzero(Axes);
+	CameraState = 0;
+	TargetIndex = INDEX_NONE;
+	FMemory::Memzero(Rotation);
+	Location = FIntVector::ZeroValue;
+	FrameIndex = 0;
+}
+
+bool FCameraRecordingReader::Read(FCameraRecordingFrame& OutFrame)
+{
+	if (Cursor == nullptr || Cursor >= End)
+		return false;
+
+	int32 DeltaTimeDelta;
+	uint8 Mask;
+	if (!ReadSigned(Cursor, End, DeltaTimeDelta) || !ReadRaw(Cursor, End, Mask))
+		return false;
+
+	DeltaTimeMicroseconds += DeltaTimeDelta;
+
+	for (int32 Axis = 0; Axis < NumAxes; ++Axis)
+	{
+		if ((Mask & (1 << Axis)) && !ReadRaw(Cursor, End, Axes[Axis]))
+			return false;
+	}
+
+	uint8 TargetingPresses = 0;
+	if ((Mask & FM_TargetingPresses) && !ReadRaw(Cursor, End, TargetingPresses))
+		return false;
+
+	if (Mask & FM_CameraState)
+	{
+		uint32 EncodedTargetIndex;
+		if (!ReadRaw(Cursor, End, CameraState) || !ReadVarInt(Cursor, End, EncodedTargetIndex))
+			return false;
+
+		TargetIndex = int32(EncodedTargetIndex) - 1;
+	}
+
+	if (Mask & FM_Pose)
+	{
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			int32 RotationDelta;
+			if (!ReadSigned(Cursor, End, RotationDelta))
+				return false;
+
+			Rotation[Axis] = uint16(Rotation[Axis] + RotationDelta);
+		}
+		if (!ReadLocationDelta(Cursor, End, Location))
+			return false;
+	}
+
+	uint32 NumMoved;
+	if (!ReadVarInt(Cursor, End, NumMoved))
+		return false;
+
+	int32 Index = -1;
+	for (uint32 Moved = 0; Moved < NumMoved; ++Moved)
+	{
+		uint32 Gap;
+		if (!ReadVarInt(Cursor, End, Gap))
+			return false;
+
+		Index += Gap + 1;
+		if (!TargetLocations.IsValidIndex(Index) || !ReadLocationDelta(Cursor, End, TargetLocations[Index]))
+			return false;
+	}
+
+	OutFrame.DeltaTime = DeltaTimeMicroseconds * 1.0e-6f;
+	OutFrame.MoveForward = Axes[0] / AxisScale;
+	OutFrame.MoveRight = Axes[1] / AxisScale;
+	OutFrame.CameraMoveRight = Axes[2] / AxisScale;
+	OutFrame.CameraMoveRightLocked = Axes[3] / AxisScale;
+	OutFrame.CameraMoveForward = Axes[4] / AxisScale;
+	OutFrame.TargetingPresses = TargetingPresses;
+	OutFrame.CameraState = CameraState;
+	OutFrame.TargetIndex = TargetIndex;
+	OutFrame.ControlRotation = FRotator(
+		FRotator::DecompressAxisFromShort(Rotation[0]),
+		FRotator::DecompressAxisFromShort(Rotation[1]),
+		FRotator::DecompressAxisFromShort(Rotation[2]));
+	OutFrame.OwnerLocation = FVector(Location);
+
+	OutFrame.TargetLocations.SetNumUninitialized(TargetLocations.Num(), false);
+	for (int32 Target = 0; Target < TargetLocations.Num(); ++Target)
+	{
+		OutFrame.TargetLocations[Target] = FVector(TargetLocations[Target]);
+	}
+
+	++FrameIndex;
+	return true;
+}
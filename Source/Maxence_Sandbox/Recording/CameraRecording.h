@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FArchive;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** One frame of a camera recording: what the player did, where the targets were and what the camera ended up doing. */
+struct MAXENCE_SANDBOX_API FCameraRecordingFrame
+{
+	float DeltaTime = 0.f;
+
+	/** Bound axis values, in [-1, 1]. */
+	float MoveForward = 0.f;
+	float MoveRight = 0.f;
+	float CameraMoveRight = 0.f;
+	float CameraMoveRightLocked = 0.f;
+	float CameraMoveForward = 0.f;
+
+	/** PressedTargettingButton calls during the frame. */
+	uint8 TargetingPresses = 0;
+
+	/** Camera state and index of the current target in the recording targets, INDEX_NONE without target. */
+	uint8 CameraState = 0;
+	int32 TargetIndex = INDEX_NONE;
+
+	FRotator ControlRotation = FRotator::ZeroRotator;
+	FVector OwnerLocation = FVector::ZeroVector;
+
+	/** Locations of the recording targets, by index. */
+	TArray<FVector> TargetLocations;
+};
+
+/**
+ * Camera recording file format, streamed frame by frame:
+ *   header: magic, version, target count, target names (varint length + UTF-8)
+ *   frame:  varint zigzag delta of the delta time in microseconds
+ *           change mask, then only the changed fields:
+ *             axes as int16, targeting presses as uint8, camera state as uint8 + varint target index,
+ *             varint zigzag deltas of the control rotation (16 bits per axis) and the owner location (cm)
+ *           varint count of the moved targets, then per target its varint index gap and location deltas (cm).
+ * Every field is delta encoded against the previous quantized frame: an idle frame, or one with a stick held
+ * still, is 3 bytes.
+ */
+namespace CameraRecording
+{
+	constexpr uint32 Magic = 0x43524543; // CREC
+	constexpr uint16 Version = 1;
+
+	/** Directory of the recordings, Saved/Recordings/Camera. */
+	MAXENCE_SANDBOX_API FString GetDirectory();
+}
+
+/** Streams frames to a recording file. */
+class MAXENCE_SANDBOX_API FCameraRecordingWriter
+{
+public:
+	~FCameraRecordingWriter();
+
+	/// Creates the file and writes the header.
+	/// <param name="TargetNames">Names the replay finds the targets by, their index is the one of the frames.</param>
+	bool Open(const FString& Path, const TArray<FString>& TargetNames);
+
+	void Write(const FCameraRecordingFrame& Frame);
+
+	/// Flushes the pending frames and closes the file.
+	void Close();
+
+	bool IsOpen() const { return File.IsValid(); }
+	int32 GetNumFrames() const { return NumFrames; }
+	int64 GetNumBytes() const { return NumBytes; }
+
+private:
+	void Flush();
+
+	TUniquePtr<FArchive> File;
+	TArray<uint8> Buffer;
+
+	/// Quantized previous frame, the deltas are taken against it.
+	struct FQuantizedFrame
+	{
+		int32 DeltaTimeMicroseconds = 0;
+		int16 Axes[5] = {};
+		uint8 CameraState = 0;
+		int32 TargetIndex = INDEX_NONE;
+		uint16 Rotation[3] = {};
+		FIntVector Location = FIntVector::ZeroValue;
+		TArray<FIntVector> TargetLocations;
+	};
+
+	FQuantizedFrame Previous;
+	int32 NumFrames = 0;
+	int64 NumBytes = 0;
+};
+
+/** Reads a recording file through a memory mapping, frame by frame. */
+class MAXENCE_SANDBOX_API FCameraRecordingReader
+{
+public:
+	~FCameraRecordingReader();
+
+	/// Maps the file and reads the header.
+	bool Open(const FString& Path);
+
+	void Close();
+
+	const TArray<FString>& GetTargetNames() const { return TargetNames; }
+
+	/// Decodes the next frame.
+	/// <returns>false at the end of the recording or on a truncated frame.</returns>
+	bool Read(FCameraRecordingFrame& OutFrame);
+
+	int32 GetFrameIndex() const { return FrameIndex; }
+
+private:
+	IMappedFileHandle* MappedFile = nullptr;
+	IMappedFileRegion* MappedRegion = nullptr;
+
+	/// File content on platforms without memory mapped files.
+	TArray<uint8> LoadedFile;
+
+	const uint8* Cursor = nullptr;
+	const uint8* End = nullptr;
+
+	TArray<FString> TargetNames;
+
+	/// Accumulated quantized values, the frames only hold deltas.
+	int32 DeltaTimeMicroseconds = 0;
+	int16 Axes[5] = {};
+	uint8 CameraState = 0;
+	int32 TargetIndex = INDEX_NONE;
+	uint16 Rotation[3] = {};
+	FIntVector Location = FIntVector::ZeroValue;
+	TArray<FIntVector> TargetLocations;
+
+	int32 FrameIndex = 0;
+};
@@ -0,0 +1,298 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxStreamingSubsystem.h"
+
+#include <Engine/Engine.h>
+#include <Engine/GameInstance.h>
+#include <Engine/LevelStreaming.h>
+#include <Engine/LevelStreamingDynamic.h>
+#include <GameFramework/Pawn.h>
+#include <GameFramework/PlayerController.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/PackageName.h>
+#include <ProfilingDebugging/CsvProfiler.h>
+#include <UObject/Package.h>
+
+#include <SandboxSubsystems.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogSandboxStreaming, Log, All);
+
+/** Sandbox area streaming, displayed with "stat SandboxStreaming". */
+DECLARE_STATS_GROUP(TEXT("SandboxStreaming"), STATGROUP_SandboxStreaming, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT(TEXT("Streaming update"), STAT_SandboxStreamingUpdate, STATGROUP_SandboxStreaming);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Resident cells"), STAT_SandboxStreamingResidentCells, STATGROUP_SandboxStreaming);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Requested cells"), STAT_SandboxStreamingRequestedCells, STATGROUP_SandboxStreaming);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Late loads"), STAT_SandboxStreamingLateLoads, STATGROUP_SandboxStreaming);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Last load latency (ms)"), STAT_SandboxStreamingLoadMs, STATGROUP_SandboxStreaming);
+
+/** Resident cells and load latency, captured with "csvprofile start". */
+CSV_DEFINE_CATEGORY(Streaming, true);
+
+USandboxStreamingSubsystem* USandboxStreamingSubsystem::Get(const UObject* WorldContextObject)
+{
+	return GetGameInstanceSubsystem<USandboxStreamingSubsystem>(WorldContextObject);
+}
+
+void USandboxStreamingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldInitializedActorsHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &USandboxStreamingSubsystem::OnWorldInitializedActors);
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &USandboxStreamingSubsystem::OnWorldCleanup);
+}
+
+void USandboxStreamingSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(WorldInitializedActorsHandle);
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+
+	States.Empty();
+	StreamingWorld.Reset();
+
+	Super::Deinitialize();
+}
+
+void USandboxStreamingSubsystem::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	UWorld* World = Params.World;
+	if (World == nullptr || !World->IsGameWorld() || World->GetGameInstance() != GetGameInstance() || Cells.Num() == 0)
+		return;
+
+	const FString MapName = FPackageName::GetShortName(UWorld::RemovePIEPrefix(World->GetOutermost()->GetName()));
+	if (!PersistentMap.IsEmpty() && MapName != PersistentMap)
+		return;
+
+	StreamingWorld = World;
+	TimeSinceUpdate = UpdateInterval;
+
+	States.Reset();
+	States.SetNum(Cells.Num());
+
+	// Cells laid out in the persistent map are driven as they are, the others are instanced on their first load.
+	for (ULevelStreaming* StreamingLevel : World->GetStreamingLevels())
+	{
+		if (StreamingLevel == nullptr)
+			continue;
+
+		const FString PackageName = UWorld::RemovePIEPrefix(StreamingLevel->GetWorldAssetPackageName());
+		for (int32 Cell = 0; Cell < Cells.Num(); ++Cell)
+		{
+			if (Cells[Cell].Level.GetLongPackageName() == PackageName)
+			{
+				FCellState& State = States[Cell];
+				State.StreamingLevel = StreamingLevel;
+				State.bRequested = StreamingLevel->ShouldBeLoaded();
+				State.bResident = StreamingLevel->IsLevelVisible();
+
+				if (State.bRequested)
+				{
+					INC_DWORD_STAT(STAT_SandboxStreamingRequestedCells);
+				}
+			}
+		}
+	}
+}
+
+void USandboxStreamingSubsystem::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	// The streaming levels go with their world.
+	if (World != StreamingWorld.Get())
+		return;
+
+	States.Reset();
+	StreamingWorld.Reset();
+	SET_DWORD_STAT(STAT_SandboxStreamingResidentCells, 0);
+	SET_DWORD_STAT(STAT_SandboxStreamingRequestedCells, 0);
+}
+
+void USandboxStreamingSubsystem::Tick(float DeltaTime)
+{
+	// Every frame, for the load latencies.
+	UpdateResidency();
+
+	TimeSinceUpdate += DeltaTime;
+	if (TimeSinceUpdate < UpdateInterval)
+		return;
+
+	Update(StreamingWorld.Get(), TimeSinceUpdate);
+	TimeSinceUpdate = 0.f;
+}
+
+bool USandboxStreamingSubsystem::IsTickable() const
+{
+	return StreamingWorld.IsValid() && States.Num() > 0;
+}
+
+ETickableTickType USandboxStreamingSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId USandboxStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USandboxStreamingSubsystem, STATGROUP_Tickables);
+}
+
+void USandboxStreamingSubsystem::Update(UWorld* World, float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SandboxStreamingUpdate);
+
+	// Where each player is and where its velocity takes it.
+	TArray<TPair<FVector, FVector>, TInlineAllocator<4>> Players;
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APawn* Pawn = It->IsValid() ? (*It)->GetPawn() : nullptr;
+		if (Pawn == nullptr)
+			continue;
+
+		const FVector Location = Pawn->GetActorLocation();
+		Players.Emplace(Location, Location + Pawn->GetVelocity() * PredictionTime);
+	}
+
+	// Between two pawns, e.g. while respawning, the cells hold.
+	if (Players.Num() == 0)
+		return;
+
+	const float LoadDistanceSquared = FMath::Square(LoadDistance);
+	const float UnloadDistanceSquared = FMath::Square(FMath::Max(UnloadDistance, LoadDistance));
+
+	for (int32 Cell = 0; Cell < Cells.Num(); ++Cell)
+	{
+		const FBox& Bounds = Cells[Cell].Bounds;
+		FCellState& State = States[Cell];
+
+		float DistanceSquared = MAX_FLT;
+		bool bInside = false;
+		for (const TPair<FVector, FVector>& Player : Players)
+		{
+			DistanceSquared = FMath::Min3(DistanceSquared, Bounds.ComputeSquaredDistanceToPoint(Player.Key), Bounds.ComputeSquaredDistanceToPoint(Player.Value));
+			bInside |= Bounds.IsInsideOrOn(Player.Key);
+		}
+
+		if (!State.bRequested)
+		{
+			if (DistanceSquared <= LoadDistanceSquared)
+			{
+				Request(World, Cell, true);
+			}
+		}
+		else if (DistanceSquared > UnloadDistanceSquared)
+		{
+			State.OutOfRangeTime += DeltaTime;
+			if (State.OutOfRangeTime >= UnloadDelay)
+			{
+				Request(World, Cell, false);
+			}
+		}
+		else
+		{
+			State.OutOfRangeTime = 0.f;
+		}
+
+		// A player reached the cell before its content.
+		State.bEnteredBeforeResident |= bInside && State.bRequested && !State.bResident;
+	}
+}
+
+void USandboxStreamingSubsystem::Request(UWorld* World, int32 Cell, bool bLoad)
+{
+	FCellState& State = States[Cell];
+	State.bRequested = bLoad;
+	State.OutOfRangeTime = 0.f;
+	State.bEnteredBeforeResident = false;
+
+	ULevelStreaming* StreamingLevel = State.StreamingLevel.Get();
+
+	if (!bLoad)
+	{
+		if (StreamingLevel)
+		{
+			StreamingLevel->SetShouldBeVisible(false);
+			StreamingLevel->SetShouldBeLoaded(false);
+		}
+
+		++Metrics.Unloads;
+		DEC_DWORD_STAT(STAT_SandboxStreamingRequestedCells);
+		UE_LOG(LogSandboxStreaming, Log, TEXT("Streaming out %s"), *Cells[Cell].Level.GetAssetName());
+		return;
+	}
+
+	State.RequestTime = FPlatformTime::Seconds();
+	INC_DWORD_STAT(STAT_SandboxStreamingRequestedCells);
+	UE_LOG(LogSandboxStreaming, Log, TEXT("Streaming in %s"), *Cells[Cell].Level.GetAssetName());
+
+	if (StreamingLevel)
+	{
+		StreamingLevel->SetShouldBeLoaded(true);
+		StreamingLevel->SetShouldBeVisible(true);
+		return;
+	}
+
+	bool bSuccess = false;
+	StreamingLevel = ULevelStreamingDynamic::LoadLevelInstanceBySoftObjectPtr(World, Cells[Cell].Level, FVector::ZeroVector, FRotator::ZeroRotator, bSuccess);
+	if (!bSuccess)
+	{
+		// Stays requested: the missing level is not retried on every update.
+		UE_LOG(LogSandboxStreaming, Warning, TEXT("Cannot stream the sandbox cell %s"), *Cells[Cell].Level.ToString());
+		return;
+	}
+
+	State.StreamingLevel = StreamingLevel;
+}
+
+void USandboxStreamingSubsystem::UpdateResidency()
+{
+	int32 NumResident = 0;
+	for (int32 Cell = 0; Cell < States.Num(); ++Cell)
+	{
+		FCellState& State = States[Cell];
+		const ULevelStreaming* StreamingLevel = State.StreamingLevel.Get();
+		const bool bResident = StreamingLevel && StreamingLevel->IsLevelVisible();
+		NumResident += bResident;
+
+		if (bResident == State.bResident)
+			continue;
+
+		State.bResident = bResident;
+		if (!bResident || !State.bRequested)
+			continue;
+
+		const double LoadSeconds = FPlatformTime::Seconds() - State.RequestTime;
+		++Metrics.Loads;
+		Metrics.LoadSeconds += LoadSeconds;
+		Metrics.MaxLoadSeconds = FMath::Max(Metrics.MaxLoadSeconds, LoadSeconds);
+		SET_FLOAT_STAT(STAT_SandboxStreamingLoadMs, float(LoadSeconds * 1000.0));
+		CSV_CUSTOM_STAT(Streaming, LoadMs, float(LoadSeconds * 1000.0), ECsvCustomStatOp::Set);
+
+		if (State.bEnteredBeforeResident)
+		{
+			++Metrics.LateLoads;
+			INC_DWORD_STAT(STAT_SandboxStreamingLateLoads);
+			UE_LOG(LogSandboxStreaming, Warning, TEXT("%s streamed in %.0fms after its request, after a player entered it"), *Cells[Cell].Level.GetAssetName(), LoadSeconds * 1000.0);
+		}
+		else
+		{
+			UE_LOG(LogSandboxStreaming, Log, TEXT("%s streamed in %.0fms after its request"), *Cells[Cell].Level.GetAssetName(), LoadSeconds * 1000.0);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_SandboxStreamingResidentCells, NumResident);
+	CSV_CUSTOM_STAT(Streaming, ResidentCells, NumResident, ECsvCustomStatOp::Set);
+}
+
+bool USandboxStreamingSubsystem::IsCellResident(int32 Cell) const
+{
+	return States.IsValidIndex(Cell) && States[Cell].bResident;
+}
+
+int32 USandboxStreamingSubsystem::GetNumResidentCells() const
+{
+	int32 NumResident = 0;
+	for (const FCellState& State : States)
+	{
+		NumResident += State.bResident;
+	}
+	return NumResident;
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/World.h"
+#include "Tickable.h"
+#include "SandboxStreamingSubsystem.generated.h"
+
+class ULevelStreaming;
+
+/** Sandbox area streamed in and out around the players. */
+USTRUCT()
+struct MAXENCE_SANDBOX_API FSandboxStreamingCell
+{
+	GENERATED_BODY()
+
+	/** Sub-level of the area: a streaming level of the persistent map, or instanced on first load when it is not one. */
+	UPROPERTY(config)
+		TSoftObjectPtr<UWorld> Level;
+
+	/** World bounds of the area content, distances are measured to this box. */
+	UPROPERTY(config)
+		FBox Bounds = FBox(ForceInit);
+};
+
+/**
+ * Proximity streaming of the sandbox areas: every UpdateInterval, each cell is requested when a player pawn, or where
+ * its velocity takes it within PredictionTime, gets within LoadDistance of the cell bounds, and released once they all
+ * stayed beyond UnloadDistance for UnloadDelay. The gap between the two distances and the delay are the hysteresis
+ * that keeps a player walking along a cell border from streaming it in and out.
+ *
+ * Levels load asynchronously through the world streaming. The actors of an unloaded cell get EndPlay, which takes
+ * their targets out of the targeting index and out of the cameras that held them.
+ *
+ * The server streams around every player, clients around their local players. Resident cells and load latency are in
+ * "stat SandboxStreaming" and the Streaming CSV stats, Streaming.PathReport walks a path and reports memory and hitches.
+ */
+UCLASS(config = Game)
+class MAXENCE_SANDBOX_API USandboxStreamingSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the sandbox streaming subsystem of the world context, if any. */
+	static USandboxStreamingSubsystem* Get(const UObject* WorldContextObject);
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+
+	// FTickableGameObject
+	void Tick(float DeltaTime) override;
+	bool IsTickable() const override;
+	ETickableTickType GetTickableTickType() const override;
+	TStatId GetStatId() const override;
+
+	const TArray<FSandboxStreamingCell>& GetCells() const { return Cells; }
+
+	/// Whether the level of Cell is loaded and visible.
+	bool IsCellResident(int32 Cell) const;
+
+	int32 GetNumResidentCells() const;
+
+	/** Cumulated streaming activity since the last ResetMetrics. */
+	struct FMetrics
+	{
+		int32 Loads = 0;
+		int32 Unloads = 0;
+		/// Loads that became visible after a player entered the cell bounds.
+		int32 LateLoads = 0;
+		/// Request to visible, over all loads.
+		double LoadSeconds = 0.0;
+		double MaxLoadSeconds = 0.0;
+	};
+
+	const FMetrics& GetMetrics() const { return Metrics; }
+
+	void ResetMetrics() { Metrics = FMetrics(); }
+
+protected:
+	/** Streamed areas of the sandbox map. */
+	UPROPERTY(config)
+		TArray<FSandboxStreamingCell> Cells;
+
+	/** Persistent map the cells belong to, without extension. Cells stream in any map when empty. */
+	UPROPERTY(config)
+		FString PersistentMap;
+
+	/** Distance to the cell bounds under which a cell is requested. */
+	UPROPERTY(config)
+		float LoadDistance = 4000.f;
+
+	/** Distance to the cell bounds over which a cell is released, above LoadDistance. */
+	UPROPERTY(config)
+		float UnloadDistance = 6000.f;
+
+	/** Seconds of player velocity looked ahead, so cells ahead load before the player is near. */
+	UPROPERTY(config)
+		float PredictionTime = 2.f;
+
+	/** Seconds a cell stays beyond UnloadDistance before it is released. */
+	UPROPERTY(config)
+		float UnloadDelay = 5.f;
+
+	/** Seconds between two streaming updates. */
+	UPROPERTY(config)
+		float UpdateInterval = 0.25f;
+
+private:
+	struct FCellState
+	{
+		TWeakObjectPtr<ULevelStreaming> StreamingLevel;
+		bool bRequested = false;
+		bool bResident = false;
+		/// A player entered the cell bounds before the cell became resident.
+		bool bEnteredBeforeResident = false;
+		float OutOfRangeTime = 0.f;
+		double RequestTime = 0.0;
+	};
+
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+
+	void Update(UWorld* World, float DeltaTime);
+
+	/// Streams the level of Cell in or out.
+	void Request(UWorld* World, int32 Cell, bool bLoad);
+
+	/// Tracks the cells whose level became visible or went away.
+	void UpdateResidency();
+
+	/// Cell states, parallel to Cells, for StreamingWorld.
+	TArray<FCellState> States;
+
+	/// World the cells stream in.
+	TWeakObjectPtr<UWorld> StreamingWorld;
+
+	float TimeSinceUpdate = 0.f;
+
+	FMetrics Metrics;
+
+	FDelegateHandle WorldInitializedActorsHandle;
+	FDelegateHandle WorldCleanupHandle;
+};
@@ -0,0 +1,282 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include <Containers/Ticker.h>
+#include <Engine/World.h>
+#include <GameFramework/Pawn.h>
+#include <GameFramework/PawnMovementComponent.h>
+#include <HAL/IConsoleManager.h>
+#include <HAL/PlatformMemory.h>
+#include <HAL/PlatformMisc.h>
+#include <HAL/PlatformTime.h>
+#include <Kismet/GameplayStatics.h>
+#include <Misc/CoreDelegates.h>
+
+#include <Profiling/ProfilingReport.h>
+#include <Streaming/SandboxStreamingSubsystem.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogStreamingPath, Log, All);
+
+/**
+ * Walks the first player along a path through the sandbox and reports what the area streaming costs. Runnable headless:
+ *   UE4Editor Maxence_Sandbox -game -nullrhi -unattended -ExecCmds="Streaming.PathReport Speed=1200 Quit=1"
+ * The path goes from the player through the centers of the streaming cells, in config order, and back to the start,
+ * at the player height; Points=X:Y:Z;X:Y:Z replaces the cells. The pawn is moved directly, its movement component
+ * stopped but its velocity set, so the streaming sees the walk as a player running it.
+ *
+ * Every frame records the game thread frame time, the resident memory and the resident cells. At the end, logs the
+ * peak memory, the frames over Hitch milliseconds and the streaming metrics, and writes the frames to
+ * Saved/Profiling/StreamingPath. Quit=1 exits once written.
+ */
+class FStreamingPathReport
+{
+public:
+	static void Run(const TArray<FString>& Args, UWorld* World);
+
+	~FStreamingPathReport();
+
+private:
+	struct FSample
+	{
+		double FrameMs;
+		uint64 UsedPhysical;
+		int32 ResidentCells;
+		FVector Location;
+	};
+
+	bool Tick(float DeltaTime);
+
+	void OnBeginFrame();
+	void OnEndFrame();
+
+	void Report();
+
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<APawn> Pawn;
+	TWeakObjectPtr<UPawnMovementComponent> Movement;
+
+	TArray<FVector> Path;
+	int32 NextPoint = 1;
+	float Speed = 600.f;
+	float HitchMs = 33.3f;
+	bool bQuit = false;
+
+	uint64 FrameStartCycles = 0;
+	uint64 StartUsedPhysical = 0;
+	TArray<FSample> Samples;
+
+	FDelegateHandle TickerHandle;
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+
+	static TUniquePtr<FStreamingPathReport> Current;
+};
+
+TUniquePtr<FStreamingPathReport> FStreamingPathReport::Current;
+
+static FAutoConsoleCommandWithWorldAndArgs GStreamingPathReportCommand(
+	TEXT("Streaming.PathReport"),
+	TEXT("Walks the first player through the sandbox streaming cells and reports resident memory and hitches to Saved/Profiling/StreamingPath.\n")
+	TEXT("Speed=<units per second> Hitch=<ms> Points=<X:Y:Z;X:Y:Z...> Quit=<1 to exit when done>. Without arguments while running, stops."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FStreamingPathReport::Run));
+
+void FStreamingPathReport::Run(const TArray<FString>& Args, UWorld* InWorld)
+{
+	if (Current.IsValid())
+	{
+		Current->Report();
+		Current.Reset();
+		if (Args.Num() == 0)
+			return;
+	}
+
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	TUniquePtr<FStreamingPathReport> NewRun = MakeUnique<FStreamingPathReport>();
+	FParse::Value(*Command, TEXT("Speed="), NewRun->Speed);
+	FParse::Value(*Command, TEXT("Hitch="), NewRun->HitchMs);
+	FParse::Bool(*Command, TEXT("Quit="), NewRun->bQuit);
+	NewRun->Speed = FMath::Max(NewRun->Speed, 1.f);
+
+	APawn* PlayerPawn = UGameplayStatics::GetPlayerPawn(InWorld, 0);
+	if (PlayerPawn == nullptr)
+	{
+		UE_LOG(LogStreamingPath, Error, TEXT("Streaming.PathReport: no player pawn to walk."));
+		return;
+	}
+
+	const FVector Start = PlayerPawn->GetActorLocation();
+	NewRun->Path.Add(Start);
+
+	FString Points;
+	if (FParse::Value(*Command, TEXT("Points="), Points))
+	{
+		TArray<FString> Coordinates;
+		Points.ParseIntoArray(Coordinates, TEXT(";"));
+		for (const FString& Point : Coordinates)
+		{
+			TArray<FString> Components;
+			if (Point.ParseIntoArray(Components, TEXT(":")) == 3)
+			{
+				NewRun->Path.Emplace(FCString::Atof(*Components[0]), FCString::Atof(*Components[1]), FCString::Atof(*Components[2]));
+			}
+		}
+	}
+	else if (const USandboxStreamingSubsystem* Streaming = USandboxStreamingSubsystem::Get(InWorld))
+	{
+		for (const FSandboxStreamingCell& Cell : Streaming->GetCells())
+		{
+			const FVector Center = Cell.Bounds.GetCenter();
+			NewRun->Path.Emplace(Center.X, Center.Y, Start.Z);
+		}
+		NewRun->Path.Add(Start);
+	}
+
+	if (NewRun->Path.Num() < 2)
+	{
+		UE_LOG(LogStreamingPath, Error, TEXT("Streaming.PathReport: no path, no streaming cell configured and no Points."));
+		return;
+	}
+
+	if (USandboxStreamingSubsystem* Streaming = USandboxStreamingSubsystem::Get(InWorld))
+	{
+		Streaming->ResetMetrics();
+	}
+
+	NewRun->World = InWorld;
+	NewRun->Pawn = PlayerPawn;
+	NewRun->Movement = PlayerPawn->GetMovementComponent();
+	if (NewRun->Movement.IsValid())
+	{
+		NewRun->Movement->SetComponentTickEnabled(false);
+	}
+
+	NewRun->StartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	NewRun->TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(NewRun.Get(), &FStreamingPathReport::Tick));
+	NewRun->BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddRaw(NewRun.Get(), &FStreamingPathReport::OnBeginFrame);
+	NewRun->EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(NewRun.Get(), &FStreamingPathReport::OnEndFrame);
+
+	UE_LOG(LogStreamingPath, Log, TEXT("Streaming.PathReport: walking %d points at %.0f units/s"), NewRun->Path.Num(), NewRun->Speed);
+	Current = MoveTemp(NewRun);
+}
+
+FStreamingPathReport::~FStreamingPathReport()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	if (Movement.IsValid())
+	{
+		Movement->Velocity = FVector::ZeroVector;
+		Movement->SetComponentTickEnabled(true);
+	}
+}
+
+bool FStreamingPathReport::Tick(float DeltaTime)
+{
+	APawn* WalkedPawn = Pawn.Get();
+	if (!World.IsValid() || WalkedPawn == nullptr)
+	{
+		UE_LOG(LogStreamingPath, Error, TEXT("Streaming.PathReport: the player went away, walk aborted."));
+		Current.Reset();
+		return false;
+	}
+
+	const FVector Location = WalkedPawn->GetActorLocation();
+	const FVector ToPoint = Path[NextPoint] - Location;
+	const FVector Direction = ToPoint.GetSafeNormal();
+	const float Step = Speed * DeltaTime;
+
+	if (ToPoint.SizeSquared() <= FMath::Square(Step))
+	{
+		WalkedPawn->SetActorLocation(Path[NextPoint], false, nullptr, ETeleportType::TeleportPhysics);
+		if (++NextPoint == Path.Num())
+		{
+			const bool bQuitWhenDone = bQuit;
+			Report();
+			Current.Reset();
+
+			if (bQuitWhenDone)
+			{
+				FPlatformMisc::RequestExit(false);
+			}
+			return false;
+		}
+	}
+	else
+	{
+		WalkedPawn->SetActorLocation(Location + Direction * Step, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	if (Movement.IsValid())
+	{
+		Movement->Velocity = Direction * Speed;
+	}
+	return true;
+}
+
+void FStreamingPathReport::OnBeginFrame()
+{
+	FrameStartCycles = FPlatformTime::Cycles64();
+}
+
+void FStreamingPathReport::OnEndFrame()
+{
+	if (FrameStartCycles == 0 || !Pawn.IsValid())
+		return;
+
+	const USandboxStreamingSubsystem* Streaming = USandboxStreamingSubsystem::Get(World.Get());
+
+	FSample& Sample = Samples.AddDefaulted_GetRef();
+	Sample.FrameMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles);
+	Sample.UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	Sample.ResidentCells = Streaming ? Streaming->GetNumResidentCells() : 0;
+	Sample.Location = Pawn->GetActorLocation();
+}
+
+void FStreamingPathReport::Report()
+{
+	if (Samples.Num() == 0)
+		return;
+
+	constexpr double MB = 1024.0 * 1024.0;
+
+	FString Csv = TEXT("Frame,FrameMs,UsedPhysicalMB,ResidentCells,X,Y,Z\n");
+	TArray<double> FrameTimings;
+	FrameTimings.Reserve(Samples.Num());
+
+	uint64 PeakUsedPhysical = StartUsedPhysical;
+	int32 Hitches = 0;
+	for (int32 Frame = 0; Frame < Samples.Num(); ++Frame)
+	{
+		const FSample& Sample = Samples[Frame];
+		Csv += FString::Printf(TEXT("%d,%.3f,%.1f,%d,%.0f,%.0f,%.0f\n"),
+			Frame, Sample.FrameMs, Sample.UsedPhysical / MB, Sample.ResidentCells, Sample.Location.X, Sample.Location.Y, Sample.Location.Z);
+
+		FrameTimings.Add(Sample.FrameMs);
+		PeakUsedPhysical = FMath::Max(PeakUsedPhysical, Sample.UsedPhysical);
+		Hitches += Sample.FrameMs > HitchMs;
+	}
+
+	FrameTimings.Sort();
+	const double P99 = FProfilingReport::Percentile(FrameTimings, 0.99);
+
+	UE_LOG(LogStreamingPath, Log, TEXT("%d frames: p99 %.2fms, worst %.2fms, %d hitches over %.1fms"), Samples.Num(), P99, FrameTimings.Last(), Hitches, HitchMs);
+	UE_LOG(LogStreamingPath, Log, TEXT("Resident memory: %.1fMB at start, %.1fMB peak, %.1fMB at end"),
+		StartUsedPhysical / MB, PeakUsedPhysical / MB, Samples.Last().UsedPhysical / MB);
+
+	if (const USandboxStreamingSubsystem* Streaming = USandboxStreamingSubsystem::Get(World.Get()))
+	{
+		const USandboxStreamingSubsystem::FMetrics& Metrics = Streaming->GetMetrics();
+		UE_LOG(LogStreamingPath, Log, TEXT("Streaming: %d loads (mean %.0fms, max %.0fms), %d late, %d unloads"),
+			Metrics.Loads, Metrics.Loads > 0 ? Metrics.LoadSeconds * 1000.0 / Metrics.Loads : 0.0, Metrics.MaxLoadSeconds * 1000.0, Metrics.LateLoads, Metrics.Unloads);
+	}
+
+	FProfilingReport::WriteCsv(Csv, TEXT("StreamingPath"), TEXT("StreamingPath"));
+}
+
+#endif // !UE_BUILD_SHIPPING
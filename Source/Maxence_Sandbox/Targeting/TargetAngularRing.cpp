@@ -0,0 +1,192 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetAngularRing.h"
+#include "TargetingStats.h"
+
+#include <GameFramework/Actor.h>
+#include <Async/ParallelFor.h>
+#include <HAL/IConsoleManager.h>
+
+DECLARE_CYCLE_STAT(TEXT("Angular ring update"), STAT_TargetingAngularRingUpdate, STATGROUP_Targeting);
+
+static TAutoConsoleVariable<int32> CVarAngularRingRadixThreshold(
+	TEXT("Targeting.AngularRing.RadixThreshold"),
+	256,
+	TEXT("Candidate count from which the angular ring computes its keys in parallel and radix sorts them\n")
+	TEXT("instead of repairing the previous order with an insertion sort."),
+	ECVF_Default);
+
+float FTargetAngularRing::PseudoAngle(const FVector& Direction)
+{
+	const float X = Direction.X;
+	const float Y = Direction.Y;
+	const float Sum = FMath::Abs(X) + FMath::Abs(Y);
+
+	if (Sum <= SMALL_NUMBER)
+		return 0.f;
+
+	// Diamond angle: position along the perimeter of the unit diamond, one unit per quadrant.
+	if (Y >= 0.f)
+		return X >= 0.f ? Y / Sum : 1.f - X / Sum;
+
+	return X < 0.f ? 2.f - Y / Sum : 3.f + X / Sum;
+}
+
+void FTargetAngularRing::Update(const FVector& Center, const TArray<AActor*>& Candidates)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TargetingAngularRingUpdate);
+	CSV_SCOPED_TIMING_STAT(DynamicCamera, SortTime);
+
+	// Sync membership, keeping the previous order of the remaining candidates.
+	TBitArray<> Seen(false, Entries.Num());
+	const int32 PreviousNum = Entries.Num();
+
+	for (AActor* Candidate : Candidates)
+	{
+		if (const int32* Index = Indices.Find(Candidate))
+		{
+			Seen[*Index] = true;
+		}
+		else
+		{
+			Entries.Add(FEntry{ Candidate, 0.f });
+		}
+	}
+
+	bool bChanged = Entries.Num() != PreviousNum;
+
+	int32 WriteIndex = 0;
+	for (int32 ReadIndex = 0; ReadIndex < Entries.Num(); ++ReadIndex)
+	{
+		if (ReadIndex < PreviousNum && !Seen[ReadIndex])
+		{
+			bChanged = true;
+			continue;
+		}
+		Entries[WriteIndex++] = Entries[ReadIndex];
+	}
+	Entries.SetNum(WriteIndex, false);
+
+	const bool bLargeRing = Entries.Num() >= CVarAngularRingRadixThreshold.GetValueOnGameThread();
+
+	auto ComputeKey = [this, &Center](int32 Index)
+	{
+		FEntry& Entry = Entries[Index];
+		Entry.Key = PseudoAngle(Entry.Actor->GetActorLocation() - Center);
+	};
+
+	if (bLargeRing)
+	{
+		ParallelFor(Entries.Num(), ComputeKey);
+		RadixSort();
+		bChanged = true;
+	}
+	else
+	{
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			ComputeKey(Index);
+		}
+		bChanged |= InsertionSort();
+	}
+
+	if (bChanged)
+	{
+		RebuildIndices();
+	}
+}
+
+int32 FTargetAngularRing::IndexOf(const AActor* Target) const
+{
+	const int32* Index = Indices.Find(Target);
+	return Index ? *Index : INDEX_NONE;
+}
+
+AActor* FTargetAngularRing::GetNeighbour(int32 Index, int32 Offset) const
+{
+	const int32 Count = Entries.Num();
+	if (Count == 0)
+		return nullptr;
+
+	const int32 Wrapped = ((Index + Offset) % Count + Count) % Count;
+	return Entries[Wrapped].Actor;
+}
+
+void FTargetAngularRing::Reset()
+{
+	Entries.Reset();
+	Scratch.Reset();
+	Indices.Reset();
+}
+
+bool FTargetAngularRing::InsertionSort()
+{
+	bool bMoved = false;
+
+	for (int32 Index = 1; Index < Entries.Num(); ++Index)
+	{
+		const FEntry Entry = Entries[Index];
+
+		int32 Hole = Index;
+		while (Hole > 0 && Entries[Hole - 1].Key > Entry.Key)
+		{
+			Entries[Hole] = Entries[Hole - 1];
+			--Hole;
+		}
+
+		if (Hole != Index)
+		{
+			Entries[Hole] = Entry;
+			bMoved = true;
+		}
+	}
+
+	return bMoved;
+}
+
+void FTargetAngularRing::RadixSort()
+{
+	// Keys are positive floats: their bit patterns sort like unsigned integers.
+	const int32 Count = Entries.Num();
+	Scratch.SetNumUninitialized(Count, false);
+
+	FEntry* Source = Entries.GetData();
+	FEntry* Destination = Scratch.GetData();
+
+	for (int32 Shift = 0; Shift < 32; Shift += 8)
+	{
+		int32 Histogram[257] = { 0 };
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			++Histogram[((*reinterpret_cast<const uint32*>(&Source[Index].Key) >> Shift) & 0xFF) + 1];
+		}
+
+		for (int32 Bucket = 1; Bucket < 257; ++Bucket)
+		{
+			Histogram[Bucket] += Histogram[Bucket - 1];
+		}
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			Destination[Histogram[(*reinterpret_cast<const uint32*>(&Source[Index].Key) >> Shift) & 0xFF]++] = Source[Index];
+		}
+
+		Swap(Source, Destination);
+	}
+
+	// Even number of passes: the sorted entries are back in Entries.
+	check(Source == Entries.GetData());
+}
+
+void FTargetAngularRing::RebuildIndices()
+{
+	Indices.Reset();
+	Indices.Reserve(Entries.Num());
+
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		Indices.Add(Entries[Index].Actor, Index);
+	}
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+/**
+ * Targeting candidates ordered by azimuth around the camera, used to navigate left and right between targets.
+ * Candidates barely move between two frames, so the order is repaired with an insertion sort rather than re-sorted,
+ * and is keyed by a pseudo-angle computed once per candidate per frame instead of acos.
+ * Above Targeting.AngularRing.RadixThreshold candidates, keys are computed in parallel and sorted with a radix sort.
+ */
+class MAXENCE_SANDBOX_API FTargetAngularRing
+{
+public:
+	/// Monotonic in the azimuth (yaw) of Direction, in [0, 4). Orders like atan2 without the transcendental.
+	static float PseudoAngle(const FVector& Direction);
+
+	/// Syncs the ring with Candidates and repairs the azimuth order around Center.
+	void Update(const FVector& Center, const TArray<AActor*>& Candidates);
+
+	int32 Num() const { return Entries.Num(); }
+
+	/// Index of Target in the ring, INDEX_NONE if it is not a candidate. O(1).
+	int32 IndexOf(const AActor* Target) const;
+
+	/// Candidate Offset steps away from Index, wrapping around the ring. Positive offsets go to the right.
+	AActor* GetNeighbour(int32 Index, int32 Offset) const;
+
+	void Reset();
+
+private:
+	struct FEntry
+	{
+		AActor* Actor;
+		float Key;
+	};
+
+	/// Returns true if any entry moved.
+	bool InsertionSort();
+	void RadixSort();
+	void RebuildIndices();
+
+	TArray<FEntry> Entries;
+	TArray<FEntry> Scratch;
+	TMap<const AActor*, int32> Indices;
+};
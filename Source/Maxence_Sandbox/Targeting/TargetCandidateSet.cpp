@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetCandidateSet.h"
+
+bool FTargetCandidateSet::Add(AActor* Actor)
+{
+	RebuildIndices();
+
+	if (const int32* Index = Indices.Find(Actor))
+	{
+		++OverlapCounts[*Index];
+		return false;
+	}
+
+	Indices.Add(Actor, Actors.Add(Actor));
+	OverlapCounts.Add(1);
+	return true;
+}
+
+bool FTargetCandidateSet::Remove(const AActor* Actor)
+{
+	RebuildIndices();
+
+	const int32* Index = Indices.Find(Actor);
+	if (Index == nullptr)
+		return false;
+
+	if (--OverlapCounts[*Index] > 0)
+		return false;
+
+	return RemoveAll(Actor);
+}
+
+bool FTargetCandidateSet::RemoveAll(const AActor* Actor)
+{
+	RebuildIndices();
+
+	int32 Index;
+	if (!Indices.RemoveAndCopyValue(Actor, Index))
+		return false;
+
+	Actors.RemoveAtSwap(Index, 1, false);
+	OverlapCounts.RemoveAtSwap(Index, 1, false);
+
+	if (Index < Actors.Num())
+	{
+		Indices.FindChecked(Actors[Index]) = Index;
+	}
+	return true;
+}
+
+bool FTargetCandidateSet::Contains(const AActor* Actor) const
+{
+	RebuildIndices();
+
+	return Indices.Contains(Actor);
+}
+
+void FTargetCandidateSet::OnGathered()
+{
+	bIndicesDirty = true;
+}
+
+void FTargetCandidateSet::Reset()
+{
+	Actors.Reset();
+	OverlapCounts.Reset();
+	Indices.Reset();
+	bIndicesDirty = false;
+}
+
+void FTargetCandidateSet::RebuildIndices() const
+{
+	if (!bIndicesDirty)
+		return;
+
+	bIndicesDirty = false;
+
+	Indices.Reset();
+	Indices.Reserve(Actors.Num());
+	for (int32 Index = 0; Index < Actors.Num(); ++Index)
+	{
+		Indices.Add(Actors[Index], Index);
+	}
+
+	OverlapCounts.Init(1, Actors.Num());
+}
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+/**
+ * Set of targeting candidates over a dense actor array owned by the camera (ObjectsInRange), so iteration and the
+ * Blueprint view stay a plain array. An index map makes add, remove and lookup O(1): removing swaps the last
+ * candidate into the hole.
+ *
+ * Range sphere overlaps fire per component: each candidate counts its overlapping components and only leaves
+ * the set once the last one left, instead of when the first collider of a multi-collider actor goes out.
+ * Bulk gathers from the targeting index write the array directly and call OnGathered: the index map is only
+ * rebuilt when a lookup needs it.
+ */
+class MAXENCE_SANDBOX_API FTargetCandidateSet
+{
+public:
+	explicit FTargetCandidateSet(TArray<AActor*>& InActors)
+		: Actors(InActors)
+	{
+	}
+
+	/// Adds one overlap of Actor. O(1).
+	/// <returns>true if Actor was not a candidate yet.</returns>
+	bool Add(AActor* Actor);
+
+	/// Removes one overlap of Actor, and Actor once it has none left. O(1).
+	/// <returns>true if Actor left the set.</returns>
+	bool Remove(const AActor* Actor);
+
+	/// Removes Actor whatever its overlap count. O(1).
+	bool RemoveAll(const AActor* Actor);
+
+	/// O(1), after the index map is rebuilt when the array was gathered since the last lookup.
+	bool Contains(const AActor* Actor) const;
+
+	/// The array was rewritten by a gather: every candidate counts as one overlap.
+	void OnGathered();
+
+	void Reset();
+
+	int32 Num() const { return Actors.Num(); }
+
+private:
+	void RebuildIndices() const;
+
+	/// Dense candidates, owned by the camera.
+	TArray<AActor*>& Actors;
+
+	/// Overlapping components per candidate, parallel to Actors.
+	mutable TArray<uint16> OverlapCounts;
+
+	/// Index of each candidate in Actors.
+	mutable TMap<const AActor*, int32> Indices;
+
+	/// Whether Indices and OverlapCounts lag behind a gather.
+	mutable bool bIndicesDirty = false;
+};
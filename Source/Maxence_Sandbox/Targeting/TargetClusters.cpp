@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetClusters.h"
+#include "TargetingStats.h"
+
+#include <GameFramework/Actor.h>
+#include <HAL/IConsoleManager.h>
+
+DECLARE_CYCLE_STAT(TEXT("Clusters update"), STAT_TargetingClustersUpdate, STATGROUP_Targeting);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Clusters"), STAT_TargetingClusters, STATGROUP_Targeting);
+
+static TAutoConsoleVariable<int32> CVarTargetingClustersMinCandidates(
+	TEXT("Targeting.Clusters.MinCandidates"),
+	64,
+	TEXT("Candidate count from which lock and navigation go through spatial clusters. 0 disables the clusters."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarTargetingClustersSize(
+	TEXT("Targeting.Clusters.Size"),
+	800.f,
+	TEXT("Side of a targeting cluster cell, in world units."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTargetingClustersRefine(
+	TEXT("Targeting.Clusters.Refine"),
+	2,
+	TEXT("Clusters whose members are scored after the representatives pass."),
+	ECVF_Scalability);
+
+bool FTargetClusters::ShouldCluster(int32 NumCandidates)
+{
+	const int32 MinCandidates = CVarTargetingClustersMinCandidates.GetValueOnGameThread();
+	return MinCandidates > 0 && NumCandidates >= MinCandidates;
+}
+
+int32 FTargetClusters::GetNumRefined()
+{
+	return FMath::Max(1, CVarTargetingClustersRefine.GetValueOnGameThread());
+}
+
+float FTargetClusters::GetSize()
+{
+	return FMath::Max(CVarTargetingClustersSize.GetValueOnGameThread(), 1.f);
+}
+
+void FTargetClusters::Update(const TArray<AActor*>& Candidates)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TargetingClustersUpdate);
+
+	const float NewCellSize = GetSize();
+	if (NewCellSize != CellSize)
+	{
+		Reset();
+		CellSize = NewCellSize;
+	}
+
+	++UpdateCount;
+
+	for (AActor* Candidate : Candidates)
+	{
+		const FVector Location = Candidate->GetActorLocation();
+
+		FMember* Member = Members.Find(Candidate);
+		if (Member == nullptr)
+		{
+			Member = &Members.Add(Candidate);
+			AddMember(Candidate, Location, *Member);
+		}
+		else if (GetCell(Location) != Clusters[Member->Cluster].Cell)
+		{
+			RemoveMember(Candidate, *Member);
+			AddMember(Candidate, Location, *Member);
+		}
+		else
+		{
+			Clusters[Member->Cluster].LocationSum += Location - Member->Location;
+			Member->Location = Location;
+		}
+
+		Member->LastUpdate = UpdateCount;
+	}
+
+	// Drop the candidates that left.
+	if (Members.Num() > Candidates.Num())
+	{
+		for (auto It = Members.CreateIterator(); It; ++It)
+		{
+			if (It.Value().LastUpdate != UpdateCount)
+			{
+				RemoveMember(It.Key(), It.Value());
+				It.RemoveCurrent();
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TargetingClusters, Num());
+}
+
+int32 FTargetClusters::FindCluster(const AActor* Target) const
+{
+	const FMember* Member = Members.Find(Target);
+	return Member ? Member->Cluster : INDEX_NONE;
+}
+
+FVector FTargetClusters::GetCentroid(int32 Cluster) const
+{
+	const FCluster& Data = Clusters[Cluster];
+	return Data.LocationSum / float(FMath::Max(Data.Members.Num(), 1));
+}
+
+AActor* FTargetClusters::GetRepresentative(int32 Cluster) const
+{
+	const FCluster& Data = Clusters[Cluster];
+	if (Data.bRepresentativeDirty)
+	{
+		Data.bRepresentativeDirty = false;
+
+		const FVector Centroid = GetCentroid(Cluster);
+		float BestDistanceSquared = MAX_FLT;
+		for (AActor* Actor : Data.Members)
+		{
+			const float DistanceSquared = FVector::DistSquared(Members.FindChecked(Actor).Location, Centroid);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				Data.Representative = Actor;
+			}
+		}
+	}
+
+	return Data.Representative;
+}
+
+void FTargetClusters::Reset()
+{
+	Clusters.Reset();
+	FreeClusters.Reset();
+	CellClusters.Reset();
+	Members.Reset();
+}
+
+FIntPoint FTargetClusters::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void FTargetClusters::AddMember(AActor* Actor, const FVector& Location, FMember& Member)
+{
+	const FIntPoint Cell = GetCell(Location);
+
+	int32 Cluster;
+	if (const int32* Existing = CellClusters.Find(Cell))
+	{
+		Cluster = *Existing;
+	}
+	else
+	{
+		Cluster = FreeClusters.Num() > 0 ? FreeClusters.Pop(false) : Clusters.AddDefaulted();
+		Clusters[Cluster].Cell = Cell;
+		CellClusters.Add(Cell, Cluster);
+	}
+
+	FCluster& Data = Clusters[Cluster];
+	Data.Members.Add(Actor);
+	Data.LocationSum += Location;
+	Data.bRepresentativeDirty = true;
+
+	Member.Cluster = Cluster;
+	Member.Location = Location;
+}
+
+void FTargetClusters::RemoveMember(const AActor* Actor, const FMember& Member)
+{
+	FCluster& Data = Clusters[Member.Cluster];
+	Data.Members.RemoveSingleSwap(const_cast<AActor*>(Actor), false);
+	Data.LocationSum -= Member.Location;
+	Data.bRepresentativeDirty = true;
+
+	if (Data.Members.Num() == 0)
+	{
+		CellClusters.Remove(Data.Cell);
+		Data.LocationSum = FVector::ZeroVector;
+		Data.Representative = nullptr;
+		Data.bRepresentativeDirty = false;
+		FreeClusters.Add(Member.Cluster);
+	}
+}
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+
+/**
+ * Targeting candidates grouped in spatial clusters: cells of Targeting.Clusters.Size on the ground plane.
+ * With hordes in range, lock and navigation first pick among the cluster representatives, then refine among the
+ * members of the few clusters picked, so an input touches O(clusters + cluster size) candidates instead of all.
+ *
+ * Clusters are maintained incrementally: each update only moves the candidates that changed cell, adds the new ones
+ * and drops the ones that left, without sorting. Cluster slots are recycled.
+ */
+class MAXENCE_SANDBOX_API FTargetClusters
+{
+public:
+	/// Whether NumCandidates is enough to go through clusters (Targeting.Clusters.MinCandidates).
+	static bool ShouldCluster(int32 NumCandidates);
+
+	/// Clusters refined after the representatives pass (Targeting.Clusters.Refine).
+	static int32 GetNumRefined();
+
+	/// Side of a cluster cell (Targeting.Clusters.Size).
+	static float GetSize();
+
+	/// Syncs the clusters with Candidates.
+	void Update(const TArray<AActor*>& Candidates);
+
+	/// Cluster of Target, INDEX_NONE if it is not a candidate.
+	int32 FindCluster(const AActor* Target) const;
+
+	/// Calls Visitor(ClusterIndex) on every cluster.
+	template<typename VisitorType>
+	void ForEachCluster(VisitorType&& Visitor) const
+	{
+		for (int32 Index = 0; Index < Clusters.Num(); ++Index)
+		{
+			if (Clusters[Index].Members.Num() > 0)
+			{
+				Visitor(Index);
+			}
+		}
+	}
+
+	const TArray<AActor*>& GetMembers(int32 Cluster) const { return Clusters[Cluster].Members; }
+
+	/// Mean location of the members.
+	FVector GetCentroid(int32 Cluster) const;
+
+	/// Member closest to the centroid when the membership last changed.
+	AActor* GetRepresentative(int32 Cluster) const;
+
+	int32 Num() const { return Clusters.Num() - FreeClusters.Num(); }
+
+	void Reset();
+
+private:
+	struct FCluster
+	{
+		FIntPoint Cell;
+		TArray<AActor*> Members;
+		FVector LocationSum = FVector::ZeroVector;
+		mutable AActor* Representative = nullptr;
+		mutable bool bRepresentativeDirty = false;
+	};
+
+	struct FMember
+	{
+		int32 Cluster;
+		FVector Location;
+		uint32 LastUpdate;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	void AddMember(AActor* Actor, const FVector& Location, FMember& Member);
+	void RemoveMember(const AActor* Actor, const FMember& Member);
+
+	TArray<FCluster> Clusters;
+	TArray<int32> FreeClusters;
+	TMap<FIntPoint, int32> CellClusters;
+	TMap<const AActor*, FMember> Members;
+
+	float CellSize = 0.f;
+	uint32 UpdateCount = 0;
+};
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Reference to a registered target in 32 bits: the index of its slot in the targeting subsystem handle table and
+ * the generation of that slot. Unregistering a target bumps the generation of its slot, so the handles still held
+ * anywhere resolve to nullptr instead of a dangling actor, without the garbage collector walking them.
+ */
+struct FTargetHandle
+{
+	static constexpr uint32 IndexBits = 20;
+	static constexpr uint32 IndexMask = (1u << IndexBits) - 1;
+	static constexpr uint32 MaxGeneration = (1u << (32 - IndexBits)) - 1;
+
+	FTargetHandle() = default;
+
+	FTargetHandle(uint32 Index, uint32 Generation)
+		: Value((Generation << IndexBits) | (Index & IndexMask))
+	{
+	}
+
+	uint32 GetIndex() const { return Value & IndexMask; }
+
+	uint32 GetGeneration() const { return Value >> IndexBits; }
+
+	/// Generations start at 1: the null handle never resolves.
+	bool IsNull() const { return Value == 0; }
+
+	void Reset() { Value = 0; }
+
+	bool operator==(const FTargetHandle& Other) const { return Value == Other.Value; }
+	bool operator!=(const FTargetHandle& Other) const { return Value != Other.Value; }
+
+	friend uint32 GetTypeHash(const FTargetHandle& Handle) { return Handle.Value; }
+
+private:
+	uint32 Value = 0;
+};
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetLockReplication.h"
+
+#include <GameFramework/Actor.h>
+#include <UObject/CoreNet.h>
+
+void FReplicatedLockState::SetAim(const FRotator& Aim)
+{
+	AimYaw = FRotator::CompressAxisToShort(Aim.Yaw);
+	AimPitch = FRotator::CompressAxisToShort(Aim.Pitch);
+}
+
+FRotator FReplicatedLockState::GetAim() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(AimPitch), FRotator::DecompressAxisFromShort(AimYaw), 0.f);
+}
+
+bool FReplicatedLockState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	bOutSuccess = true;
+
+	uint8 bLocked = Target != nullptr;
+	Ar.SerializeBits(&bLocked, 1);
+
+	if (!bLocked)
+	{
+		Target = nullptr;
+		return true;
+	}
+
+	UObject* Object = Target;
+	bOutSuccess = Map->SerializeObject(Ar, AActor::StaticClass(), Object);
+	if (Ar.IsLoading())
+	{
+		Target = Cast<AActor>(Object);
+	}
+
+	Ar << AimYaw;
+	Ar << AimPitch;
+
+	return true;
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TargetLockReplication.generated.h"
+
+class AActor;
+class UPackageMap;
+
+/**
+ * Lock-on state of a camera as sent over the network.
+ * The target goes as its NetGUID and the aim as the control yaw and pitch of the lock, quantized to 16 bits each:
+ * an unlocked state is 1 bit, a locked one the NetGUID plus 33 bits. The aim is only set when the lock changes,
+ * the other machines follow the live aim from the target itself.
+ */
+USTRUCT(BlueprintType)
+struct MAXENCE_SANDBOX_API FReplicatedLockState
+{
+	GENERATED_BODY()
+
+	/** Locked target, nullptr when unlocked. */
+	UPROPERTY(BlueprintReadOnly, Category = "Lock")
+		AActor* Target = nullptr;
+
+	UPROPERTY()
+		uint16 AimYaw = 0;
+
+	UPROPERTY()
+		uint16 AimPitch = 0;
+
+	void SetAim(const FRotator& Aim);
+	FRotator GetAim() const;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FReplicatedLockState& Other) const
+	{
+		return Target == Other.Target && AimYaw == Other.AimYaw && AimPitch == Other.AimPitch;
+	}
+
+	bool operator!=(const FReplicatedLockState& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FReplicatedLockState> : public TStructOpsTypeTraitsBase2<FReplicatedLockState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
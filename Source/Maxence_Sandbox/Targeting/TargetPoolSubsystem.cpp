@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetPoolSubsystem.h"
+#include "TargetingStats.h"
+#include "TargetingSubsystem.h"
+#include "Characters/Interfaces/Targetable.h"
+#include "Characters/Components/TargetableComponent.h"
+#include "SandboxSubsystems.h"
+
+#include <Engine/Engine.h>
+#include <Engine/GameInstance.h>
+#include <GameFramework/Actor.h>
+#include <HAL/PlatformTime.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogTargetPool, Log, All);
+
+DECLARE_CYCLE_STAT(TEXT("Pool spawn"), STAT_TargetPoolSpawn, STATGROUP_Targeting);
+DECLARE_CYCLE_STAT(TEXT("Pool acquire"), STAT_TargetPoolAcquire, STATGROUP_Targeting);
+DECLARE_CYCLE_STAT(TEXT("Pool release"), STAT_TargetPoolRelease, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pool spawns"), STAT_TargetPoolSpawns, STATGROUP_Targeting);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled targets"), STAT_TargetPoolPooled, STATGROUP_Targeting);
+
+UTargetPoolSubsystem* UTargetPoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	return GetGameInstanceSubsystem<UTargetPoolSubsystem>(WorldContextObject);
+}
+
+void UTargetPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	WorldInitializedActorsHandle = FWorldDelegates::OnWorldInitializedActors.AddUObject(this, &UTargetPoolSubsystem::OnWorldInitializedActors);
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &UTargetPoolSubsystem::OnWorldCleanup);
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UTargetPoolSubsystem::OnLevelRemovedFromWorld);
+}
+
+void UTargetPoolSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldInitializedActors.Remove(WorldInitializedActorsHandle);
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+
+	FreeActors.Empty();
+	PooledActors.Empty();
+	PoolWorld.Reset();
+	SET_DWORD_STAT(STAT_TargetPoolPooled, 0);
+
+	Super::Deinitialize();
+}
+
+void UTargetPoolSubsystem::OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params)
+{
+	UWorld* World = Params.World;
+	if (World == nullptr || !World->IsGameWorld() || World->GetGameInstance() != GetGameInstance())
+		return;
+
+	// Clients get their enemies from the server.
+	if (World->GetNetMode() == NM_Client)
+		return;
+
+	PoolWorld = World;
+
+	const double StartTime = FPlatformTime::Seconds();
+	int32 Count = 0;
+
+	for (const FTargetPoolSettings& Settings : Pools)
+	{
+		UClass* Class = Settings.ActorClass.LoadSynchronous();
+		if (Class == nullptr)
+		{
+			UE_LOG(LogTargetPool, Warning, TEXT("Cannot load the pooled class %s"), *Settings.ActorClass.ToString());
+			continue;
+		}
+
+		FreeActors.FindOrAdd(Class).MaxPooled = Settings.MaxPooled;
+		Prewarm(Class, Settings.Prewarm);
+		Count += Settings.Prewarm;
+	}
+
+	if (Count > 0)
+	{
+		UE_LOG(LogTargetPool, Log, TEXT("Pre-warmed %d targets in %.1fms"), Count, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+}
+
+void UTargetPoolSubsystem::OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources)
+{
+	// The pooled actors go with their world.
+	if (World != PoolWorld.Get())
+		return;
+
+	for (TPair<UClass*, FTargetPool>& Pair : FreeActors)
+	{
+		Pair.Value.Free.Reset();
+	}
+	PooledActors.Reset();
+	PoolWorld.Reset();
+	SET_DWORD_STAT(STAT_TargetPoolPooled, 0);
+}
+
+void UTargetPoolSubsystem::OnLevelRemovedFromWorld(ULevel* Level, UWorld* World)
+{
+	// Targets released in a streamed level go with it. A null level is the whole world, see OnWorldCleanup.
+	if (Level == nullptr || World != PoolWorld.Get())
+		return;
+
+	for (TPair<UClass*, FTargetPool>& Pair : FreeActors)
+	{
+		Pair.Value.Free.RemoveAllSwap([this, Level](AActor* Actor)
+		{
+			if (Actor == nullptr || Actor->GetLevel() != Level)
+				return false;
+
+			PooledActors.Remove(Actor);
+			DEC_DWORD_STAT(STAT_TargetPoolPooled);
+			return true;
+		});
+	}
+}
+
+void UTargetPoolSubsystem::Prewarm(UClass* Class, int32 Count)
+{
+	if (!PoolWorld.IsValid())
+	{
+		PoolWorld = GetGameInstance()->GetWorld();
+	}
+
+	UWorld* World = PoolWorld.Get();
+	if (World == nullptr || Class == nullptr)
+		return;
+
+	FTargetPool& Pool = FreeActors.FindOrAdd(Class);
+	Pool.Free.Reserve(Count);
+
+	const FTransform Parking(ParkingLocation);
+	while (Pool.Free.Num() < Count)
+	{
+		AActor* Actor = Spawn(Class, Parking);
+		if (Actor == nullptr)
+			break;
+
+		Deactivate(Actor);
+		Pool.Free.Add(Actor);
+		PooledActors.Add(Actor);
+		INC_DWORD_STAT(STAT_TargetPoolPooled);
+	}
+}
+
+void UTargetPoolSubsystem::Empty()
+{
+	for (TPair<UClass*, FTargetPool>& Pair : FreeActors)
+	{
+		for (AActor* Actor : Pair.Value.Free)
+		{
+			if (IsValid(Actor))
+			{
+				Actor->Destroy();
+				++Metrics.Destroyed;
+			}
+		}
+		Pair.Value.Free.Reset();
+	}
+
+	PooledActors.Reset();
+	SET_DWORD_STAT(STAT_TargetPoolPooled, 0);
+}
+
+AActor* UTargetPoolSubsystem::AcquireTarget(TSubclassOf<AActor> Class, const FTransform& Transform)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetPoolAcquire);
+
+	if (Class == nullptr)
+		return nullptr;
+
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World != PoolWorld.Get())
+	{
+		// First use in a world without pre-warmed pools.
+		PoolWorld = World;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	AActor* Actor = nullptr;
+	if (FTargetPool* Pool = FreeActors.Find(Class))
+	{
+		// Pooled actors may have been destroyed by gameplay code meanwhile.
+		while (Actor == nullptr && Pool->Free.Num() > 0)
+		{
+			AActor* Candidate = Pool->Free.Pop(false);
+			PooledActors.Remove(Candidate);
+			DEC_DWORD_STAT(STAT_TargetPoolPooled);
+
+			if (IsValid(Candidate))
+			{
+				Actor = Candidate;
+			}
+		}
+	}
+
+	if (Actor == nullptr)
+	{
+		Actor = Spawn(Class, Transform);
+		if (Actor == nullptr)
+			return nullptr;
+
+		// A fresh actor registered itself at BeginPlay: only the pool reset is left.
+		if (ITargetable* Targetable = Cast<ITargetable>(Actor))
+		{
+			Targetable->OnAcquiredFromPool();
+		}
+	}
+	else
+	{
+		Activate(Actor, Transform);
+	}
+
+	++Metrics.Acquired;
+	Metrics.AcquireSeconds += FPlatformTime::Seconds() - StartTime;
+	return Actor;
+}
+
+void UTargetPoolSubsystem::ReleaseTarget(AActor* Actor)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetPoolRelease);
+
+	if (!IsValid(Actor) || PooledActors.Contains(Actor))
+		return;
+
+	FTargetPool& Pool = FreeActors.FindOrAdd(Actor->GetClass());
+	if ((Pool.MaxPooled > 0 && Pool.Free.Num() >= Pool.MaxPooled) || Actor->GetWorld() != PoolWorld.Get())
+	{
+		Actor->Destroy();
+		++Metrics.Destroyed;
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	Deactivate(Actor);
+	Pool.Free.Add(Actor);
+	PooledActors.Add(Actor);
+	INC_DWORD_STAT(STAT_TargetPoolPooled);
+
+	++Metrics.Released;
+	Metrics.ReleaseSeconds += FPlatformTime::Seconds() - StartTime;
+}
+
+int32 UTargetPoolSubsystem::GetNumPooled(UClass* Class) const
+{
+	const FTargetPool* Pool = FreeActors.Find(Class);
+	return Pool ? Pool->Free.Num() : 0;
+}
+
+bool UTargetPoolSubsystem::IsPooled(const AActor* Actor) const
+{
+	return PooledActors.Contains(Actor);
+}
+
+AActor* UTargetPoolSubsystem::Spawn(UClass* Class, const FTransform& Transform)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetPoolSpawn);
+
+	UWorld* World = PoolWorld.Get();
+	if (World == nullptr)
+		return nullptr;
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AActor* Actor = World->SpawnActor<AActor>(Class, Transform, SpawnParameters);
+
+	++Metrics.Spawned;
+	Metrics.SpawnSeconds += FPlatformTime::Seconds() - StartTime;
+	INC_DWORD_STAT(STAT_TargetPoolSpawns);
+
+	return Actor;
+}
+
+void UTargetPoolSubsystem::Deactivate(AActor* Actor)
+{
+	// Out of the targeting index first: cameras locked on it retarget or unlock through OnTargetRemoved.
+	if (UTargetableComponent* Targetable = Actor->FindComponentByClass<UTargetableComponent>())
+	{
+		Targetable->SetRegistered(false);
+	}
+	else if (UTargetingSubsystem* TargetingSubsystem = UTargetingSubsystem::Get(Actor))
+	{
+		TargetingSubsystem->UnregisterTarget(Actor);
+	}
+
+	if (ITargetable* Targetable = Cast<ITargetable>(Actor))
+	{
+		Targetable->OnReleasedToPool();
+	}
+
+	Actor->SetActorHiddenInGame(true);
+	Actor->SetActorEnableCollision(false);
+	Actor->SetActorTickEnabled(false);
+
+	TInlineComponentArray<UActorComponent*> Components(Actor);
+	for (UActorComponent* Component : Components)
+	{
+		Component->SetComponentTickEnabled(false);
+	}
+
+	Actor->SetActorLocation(ParkingLocation, false, nullptr, ETeleportType::ResetPhysics);
+}
+
+void UTargetPoolSubsystem::Activate(AActor* Actor, const FTransform& Transform)
+{
+	Actor->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+
+	TInlineComponentArray<UActorComponent*> Components(Actor);
+	for (UActorComponent* Component : Components)
+	{
+		Component->SetComponentTickEnabled(Component->PrimaryComponentTick.bStartWithTickEnabled);
+	}
+
+	Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+	Actor->SetActorEnableCollision(true);
+	Actor->SetActorHiddenInGame(false);
+
+	if (ITargetable* Targetable = Cast<ITargetable>(Actor))
+	{
+		Targetable->OnAcquiredFromPool();
+	}
+
+	// Straight into the targeting index, at its new location.
+	if (UTargetableComponent* Targetable = Actor->FindComponentByClass<UTargetableComponent>())
+	{
+		Targetable->SetRegistered(true);
+	}
+	else if (UTargetingSubsystem* TargetingSubsystem = UTargetingSubsystem::Get(Actor))
+	{
+		if (Actor->GetClass()->ImplementsInterface(UTargetable::StaticClass()))
+		{
+			TargetingSubsystem->RegisterTarget(Actor);
+		}
+	}
+}
@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Engine/World.h"
+#include "TargetPoolSubsystem.generated.h"
+
+class UTargetingSubsystem;
+
+/** Pool of a targetable class, pre-warmed when a game world loads. */
+USTRUCT()
+struct MAXENCE_SANDBOX_API FTargetPoolSettings
+{
+	GENERATED_BODY()
+
+	/** Pooled class, implementing ITargetable or carrying a UTargetableComponent. */
+	UPROPERTY(config)
+		TSoftClassPtr<AActor> ActorClass;
+
+	/** Instances spawned when a game world loads. */
+	UPROPERTY(config)
+		int32 Prewarm = 0;
+
+	/** Instances kept in the pool at most, released actors beyond it are destroyed. 0 keeps them all. */
+	UPROPERTY(config)
+		int32 MaxPooled = 0;
+};
+
+/** Free instances of a pooled class. */
+USTRUCT()
+struct FTargetPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+		TArray<AActor*> Free;
+
+	int32 MaxPooled = 0;
+};
+
+/**
+ * Pools of pre-spawned targetable actors, so enemies come and go without spawn, destroy and garbage collection churn.
+ * Pooled actors are hidden, without collision nor tick, parked away from the level and out of the targeting index.
+ * Acquiring one moves it in place, resets it through ITargetable::OnAcquiredFromPool and registers it in the targeting
+ * index directly: cameras see it on their next gather, without waiting for the range sphere overlap events.
+ *
+ * Spawn, acquire and release cost are in "stat Targeting", Targeting.Benchmark.Pool compares the churn and the
+ * garbage collection time of spawning and of pooling.
+ */
+UCLASS(config = Game)
+class MAXENCE_SANDBOX_API UTargetPoolSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the target pool subsystem of the world context, if any. */
+	static UTargetPoolSubsystem* Get(const UObject* WorldContextObject);
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+
+	/** Takes an actor of Class out of its pool and places it at Transform. Spawns one when the pool is empty. */
+	UFUNCTION(BlueprintCallable, Category = "Targeting|Pool", meta = (DeterminesOutputType = "Class"))
+		AActor* AcquireTarget(TSubclassOf<AActor> Class, const FTransform& Transform);
+
+	/** Puts Actor back in the pool of its class, or destroys it when the pool is full. */
+	UFUNCTION(BlueprintCallable, Category = "Targeting|Pool")
+		void ReleaseTarget(AActor* Actor);
+
+	/// Spawns instances of Class in the current world until Count of them are pooled.
+	void Prewarm(UClass* Class, int32 Count);
+
+	/// Destroys the pooled instances of every class.
+	void Empty();
+
+	/// Free instances of Class.
+	int32 GetNumPooled(UClass* Class) const;
+
+	/// Whether Actor is waiting in a pool.
+	bool IsPooled(const AActor* Actor) const;
+
+	/** Cumulated cost of the pool since the last ResetMetrics. */
+	struct FMetrics
+	{
+		int32 Spawned = 0;
+		double SpawnSeconds = 0.0;
+		int32 Acquired = 0;
+		double AcquireSeconds = 0.0;
+		int32 Released = 0;
+		double ReleaseSeconds = 0.0;
+		int32 Destroyed = 0;
+	};
+
+	const FMetrics& GetMetrics() const { return Metrics; }
+
+	void ResetMetrics() { Metrics = FMetrics(); }
+
+protected:
+	/** Pooled classes. */
+	UPROPERTY(config)
+		TArray<FTargetPoolSettings> Pools;
+
+	/** Where pooled actors wait, away from the level and its cameras. */
+	UPROPERTY(config)
+		FVector ParkingLocation = FVector(0.f, 0.f, -100000.f);
+
+private:
+	void OnWorldInitializedActors(const UWorld::FActorsInitializedParams& Params);
+	void OnWorldCleanup(UWorld* World, bool bSessionEnded, bool bCleanupResources);
+	void OnLevelRemovedFromWorld(ULevel* Level, UWorld* World);
+
+	AActor* Spawn(UClass* Class, const FTransform& Transform);
+
+	/// Hides Actor, stops it and removes it from targeting.
+	void Deactivate(AActor* Actor);
+
+	/// Places Actor, wakes it up and registers it in targeting.
+	void Activate(AActor* Actor, const FTransform& Transform);
+
+	UPROPERTY(Transient)
+		TMap<UClass*, FTargetPool> FreeActors;
+
+	/// Actors currently in a pool.
+	TSet<const AActor*> PooledActors;
+
+	/// World the pooled actors live in.
+	TWeakObjectPtr<UWorld> PoolWorld;
+
+	FMetrics Metrics;
+
+	FDelegateHandle WorldInitializedActorsHandle;
+	FDelegateHandle WorldCleanupHandle;
+	FDelegateHandle LevelRemovedHandle;
+};
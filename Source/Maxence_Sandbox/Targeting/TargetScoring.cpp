@@ -0,0 +1,180 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetScoring.h"
+#include "TargetingStats.h"
+
+DECLARE_CYCLE_STAT(TEXT("Score candidates"), STAT_TargetingScore, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Scored candidates"), STAT_TargetingScoredCandidates, STATGROUP_Targeting);
+
+namespace
+{
+	/** Caps "never locked" so the recency term stays finite. */
+	constexpr float MaxTimeSinceLocked = 1.0e6f;
+
+	constexpr int32 ScoringWidth = 4;
+}
+
+void FTargetScoringKernel::Reset(int32 ExpectedNum)
+{
+	const int32 Slack = Align(ExpectedNum, ScoringWidth);
+
+	NumCandidates = 0;
+	X.Reset(Slack);
+	Y.Reset(Slack);
+	Z.Reset(Slack);
+	Priorities.Reset(Slack);
+	TimesSinceLocked.Reset(Slack);
+	Eligible.Reset(Slack);
+}
+
+int32 FTargetScoringKernel::Add(const FVector& Location, float Priority, float TimeSinceLocked, bool bEligible)
+{
+	// Drop the padding of a previous Score call.
+	if (X.Num() > NumCandidates)
+	{
+		X.SetNum(NumCandidates, false);
+		Y.SetNum(NumCandidates, false);
+		Z.SetNum(NumCandidates, false);
+		Priorities.SetNum(NumCandidates, false);
+		TimesSinceLocked.SetNum(NumCandidates, false);
+		Eligible.SetNum(NumCandidates, false);
+	}
+
+	X.Add(Location.X);
+	Y.Add(Location.Y);
+	Z.Add(Location.Z);
+	Priorities.Add(Priority);
+	TimesSinceLocked.Add(FMath::Min(TimeSinceLocked, MaxTimeSinceLocked));
+	Eligible.Add(bEligible ? 1.f : 0.f);
+
+	return NumCandidates++;
+}
+
+void FTargetScoringKernel::Score(const FVector& Origin, const FVector& Eye, const FVector& Forward, float MaxDistance, const FTargetScoringWeights& Weights)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetingScore);
+	INC_DWORD_STAT_BY(STAT_TargetingScoredCandidates, NumCandidates);
+
+	// Pad to the vector width with ineligible candidates.
+	const int32 NumPadded = Align(NumCandidates, ScoringWidth);
+	const int32 NumPadding = NumPadded - X.Num();
+	if (NumPadding > 0)
+	{
+		X.AddZeroed(NumPadding);
+		Y.AddZeroed(NumPadding);
+		Z.AddZeroed(NumPadding);
+		Priorities.AddZeroed(NumPadding);
+		TimesSinceLocked.AddZeroed(NumPadding);
+		Eligible.AddZeroed(NumPadding);
+	}
+
+	Scores.SetNumUninitialized(NumPadded, false);
+	Distances.SetNumUninitialized(NumPadded, false);
+
+	const VectorRegister OriginX = VectorSetFloat1(Origin.X);
+	const VectorRegister OriginY = VectorSetFloat1(Origin.Y);
+	const VectorRegister OriginZ = VectorSetFloat1(Origin.Z);
+	const VectorRegister EyeX = VectorSetFloat1(Eye.X);
+	const VectorRegister EyeY = VectorSetFloat1(Eye.Y);
+	const VectorRegister EyeZ = VectorSetFloat1(Eye.Z);
+	const VectorRegister ForwardX = VectorSetFloat1(Forward.X);
+	const VectorRegister ForwardY = VectorSetFloat1(Forward.Y);
+	const VectorRegister ForwardZ = VectorSetFloat1(Forward.Z);
+
+	const VectorRegister DistanceWeight = VectorSetFloat1(-Weights.Distance / FMath::Max(MaxDistance, 1.f));
+	const VectorRegister AngleWeight = VectorSetFloat1(Weights.Angle);
+	const VectorRegister PriorityWeight = VectorSetFloat1(Weights.Priority);
+	const VectorRegister RecencyWeight = VectorSetFloat1(Weights.Recency);
+	const VectorRegister InvRecencyTime = VectorSetFloat1(1.f / FMath::Max(Weights.RecencyTime, 0.01f));
+
+	const VectorRegister MaxDistanceVector = VectorSetFloat1(MaxDistance);
+	const VectorRegister Tiny = VectorSetFloat1(SMALL_NUMBER);
+	const VectorRegister Lowest = VectorSetFloat1(-MAX_FLT);
+	const VectorRegister One = VectorOne();
+	const VectorRegister Zero = VectorZero();
+
+	for (int32 Index = 0; Index < NumPadded; Index += ScoringWidth)
+	{
+		const VectorRegister PX = VectorLoadAligned(&X[Index]);
+		const VectorRegister PY = VectorLoadAligned(&Y[Index]);
+		const VectorRegister PZ = VectorLoadAligned(&Z[Index]);
+
+		// Distance from the origin, sqrt as x * rsqrt(x).
+		const VectorRegister DX = VectorSubtract(PX, OriginX);
+		const VectorRegister DY = VectorSubtract(PY, OriginY);
+		const VectorRegister DZ = VectorSubtract(PZ, OriginZ);
+		const VectorRegister DistanceSquared = VectorMultiplyAdd(DX, DX, VectorMultiplyAdd(DY, DY, VectorMultiply(DZ, DZ)));
+		const VectorRegister Distance = VectorMultiply(DistanceSquared, VectorReciprocalSqrtAccurate(VectorMax(DistanceSquared, Tiny)));
+
+		// Cosine between the camera forward and the eye to target direction.
+		const VectorRegister EX = VectorSubtract(PX, EyeX);
+		const VectorRegister EY = VectorSubtract(PY, EyeY);
+		const VectorRegister EZ = VectorSubtract(PZ, EyeZ);
+		const VectorRegister EyeDistanceSquared = VectorMultiplyAdd(EX, EX, VectorMultiplyAdd(EY, EY, VectorMultiply(EZ, EZ)));
+		const VectorRegister Dot = VectorMultiplyAdd(EX, ForwardX, VectorMultiplyAdd(EY, ForwardY, VectorMultiply(EZ, ForwardZ)));
+		const VectorRegister Cosine = VectorMultiply(Dot, VectorReciprocalSqrtAccurate(VectorMax(EyeDistanceSquared, Tiny)));
+
+		const VectorRegister RecencyAlpha = VectorMin(VectorMultiply(VectorLoadAligned(&TimesSinceLocked[Index]), InvRecencyTime), One);
+
+		VectorRegister Score = VectorMultiply(Distance, DistanceWeight);
+		Score = VectorMultiplyAdd(Cosine, AngleWeight, Score);
+		Score = VectorMultiplyAdd(VectorLoadAligned(&Priorities[Index]), PriorityWeight, Score);
+		Score = VectorMultiplyAdd(RecencyAlpha, RecencyWeight, Score);
+
+		// Lane mask instead of a branch per candidate.
+		const VectorRegister Keep = VectorBitwiseAnd(
+			VectorCompareGT(VectorLoadAligned(&Eligible[Index]), Zero),
+			VectorCompareGE(MaxDistanceVector, Distance));
+
+		VectorStoreAligned(VectorSelect(Keep, Score, Lowest), &Scores[Index]);
+		VectorStoreAligned(Distance, &Distances[Index]);
+	}
+}
+
+void FTargetScoringKernel::SelectBest(int32 K, TArray<int32>& OutIndices) const
+{
+	OutIndices.Reset(K);
+	if (K <= 0)
+		return;
+
+	// K is small: keep the best ones sorted and insert, O(n * K) without sorting every candidate.
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		const float CandidateScore = Scores[Index];
+		if (CandidateScore <= -MAX_FLT)
+			continue;
+
+		if (OutIndices.Num() == K && CandidateScore <= Scores[OutIndices.Last()])
+			continue;
+
+		int32 Position = OutIndices.Num();
+		while (Position > 0 && Scores[OutIndices[Position - 1]] < CandidateScore)
+		{
+			--Position;
+		}
+
+		OutIndices.Insert(Index, Position);
+		if (OutIndices.Num() > K)
+		{
+			OutIndices.Pop(false);
+		}
+	}
+}
+
+int32 FTargetScoringKernel::SelectBest() const
+{
+	int32 BestIndex = INDEX_NONE;
+	float BestScore = -MAX_FLT;
+
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		if (Scores[Index] > BestScore)
+		{
+			BestScore = Scores[Index];
+			BestIndex = Index;
+		}
+	}
+
+	return BestIndex;
+}
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TargetScoring.generated.h"
+
+/** Weights of the target selection score. The defaults pick the closest target. */
+USTRUCT(BlueprintType)
+struct MAXENCE_SANDBOX_API FTargetScoringWeights
+{
+	GENERATED_BODY()
+
+	/** Penalty per selection range of distance from the owner. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scoring")
+		float Distance = 1.f;
+
+	/** Bonus per unit of cosine between the camera forward and the target direction. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scoring")
+		float Angle = 0.f;
+
+	/** Bonus per unit of target priority. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scoring")
+		float Priority = 0.f;
+
+	/** Bonus of a target not locked for RecencyTime seconds or more, scaled down for more recent locks. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scoring")
+		float Recency = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Scoring", meta = (ClampMin = "0.01"))
+		float RecencyTime = 5.f;
+};
+
+/**
+ * Scores targeting candidates in one vectorized pass. Candidates are gathered in structure of arrays padded
+ * to the vector width, and the pass computes, four candidates at a time:
+ *   - Distance * distance from the origin / max distance (as a penalty)
+ *   + Angle * cos(camera forward, target direction)
+ *   + Priority * priority
+ *   + Recency * min(time since last lock / RecencyTime, 1)
+ * Ineligible candidates and candidates beyond the max distance score -MAX_FLT.
+ */
+class MAXENCE_SANDBOX_API FTargetScoringKernel
+{
+public:
+	void Reset(int32 ExpectedNum = 0);
+
+	/// Adds a candidate, returns its index.
+	int32 Add(const FVector& Location, float Priority, float TimeSinceLocked, bool bEligible);
+
+	int32 Num() const { return NumCandidates; }
+
+	/// Scores every candidate.
+	/// <param name="Origin">Distance origin, usually the camera owner.</param>
+	/// <param name="Eye">Camera location the angle is measured from.</param>
+	void Score(const FVector& Origin, const FVector& Eye, const FVector& Forward, float MaxDistance, const FTargetScoringWeights& Weights);
+
+	/// Indices of the (at most) K best scored eligible candidates, best first.
+	void SelectBest(int32 K, TArray<int32>& OutIndices) const;
+
+	/// Best scored eligible candidate, INDEX_NONE if none.
+	int32 SelectBest() const;
+
+	float GetScore(int32 Index) const { return Scores[Index]; }
+	float GetDistance(int32 Index) const { return Distances[Index]; }
+
+private:
+	int32 NumCandidates = 0;
+
+	TArray<float, TAlignedHeapAllocator<16>> X;
+	TArray<float, TAlignedHeapAllocator<16>> Y;
+	TArray<float, TAlignedHeapAllocator<16>> Z;
+	TArray<float, TAlignedHeapAllocator<16>> Priorities;
+	TArray<float, TAlignedHeapAllocator<16>> TimesSinceLocked;
+	TArray<float, TAlignedHeapAllocator<16>> Eligible;
+
+	TArray<float, TAlignedHeapAllocator<16>> Scores;
+	TArray<float, TAlignedHeapAllocator<16>> Distances;
+};
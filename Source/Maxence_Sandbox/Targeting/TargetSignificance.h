@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TargetSignificance.generated.h"
+
+/** Update rates applied to a target while its significance score is at least MinScore. */
+USTRUCT()
+struct MAXENCE_SANDBOX_API FTargetSignificanceLevel
+{
+	GENERATED_BODY()
+
+	/** Lowest score of the level. Levels are sorted from the highest MinScore down. */
+	UPROPERTY(config)
+		float MinScore = 0.f;
+
+	/** Actor tick interval in seconds, 0 ticks every frame. */
+	UPROPERTY(config)
+		float TickInterval = 0.f;
+
+	/** Character movement tick interval in seconds. */
+	UPROPERTY(config)
+		float MovementTickInterval = 0.f;
+
+	/** Skeletal mesh (animation) tick interval in seconds. */
+	UPROPERTY(config)
+		float AnimTickInterval = 0.f;
+
+	/** Forced skeletal mesh LOD: 0 lets the renderer choose, N forces LOD N-1. */
+	UPROPERTY(config)
+		int32 ForcedLOD = 0;
+};
+
+/** Significance inputs of a target, gathered from the registered cameras and local player views. */
+struct FTargetSignificanceInputs
+{
+	/// Distance to the closest view.
+	float Distance = MAX_FLT;
+
+	bool bInView = false;
+	bool bInRange = false;
+	bool bCurrentTarget = false;
+};
+
+/** Significance score weights. */
+USTRUCT()
+struct MAXENCE_SANDBOX_API FTargetSignificanceWeights
+{
+	GENERATED_BODY()
+
+	/** Distance over which the distance term falls from DistanceWeight to 0. */
+	UPROPERTY(config)
+		float MaxDistance = 10000.f;
+
+	UPROPERTY(config)
+		float DistanceWeight = 1.f;
+
+	UPROPERTY(config)
+		float InViewWeight = 1.f;
+
+	UPROPERTY(config)
+		float InRangeWeight = 1.f;
+
+	UPROPERTY(config)
+		float CurrentTargetWeight = 10.f;
+
+	float Score(const FTargetSignificanceInputs& Inputs) const
+	{
+		const float DistanceAlpha = 1.f - FMath::Min(Inputs.Distance / FMath::Max(MaxDistance, 1.f), 1.f);
+
+		return DistanceAlpha * DistanceWeight
+			+ (Inputs.bInView ? InViewWeight : 0.f)
+			+ (Inputs.bInRange ? InRangeWeight : 0.f)
+			+ (Inputs.bCurrentTarget ? CurrentTargetWeight : 0.f);
+	}
+};
@@ -0,0 +1,255 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetVisibilityBakeCommandlet.h"
+#include "TargetVisibilityTable.h"
+
+#include <Async/ParallelFor.h>
+#include <Components/PrimitiveComponent.h>
+#include <Engine/World.h>
+#include <EngineUtils.h>
+#include <HAL/PlatformTime.h>
+#include <UObject/Package.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogTargetVisibilityBake, Log, All);
+
+UTargetVisibilityBakeCommandlet::UTargetVisibilityBakeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UTargetVisibilityBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> Values;
+	ParseCommandLine(*Params, Tokens, Switches, Values);
+
+	const FString MapName = Values.FindRef(TEXT("Map"));
+	if (MapName.IsEmpty())
+	{
+		UE_LOG(LogTargetVisibilityBake, Error, TEXT("-run=TargetVisibilityBake -Map=<package> [-CellSize=500] [-Samples=5] [-MaxOpenCells=16384]"));
+		return 1;
+	}
+
+	FSettings Settings;
+	if (const FString* CellSize = Values.Find(TEXT("CellSize")))
+	{
+		Settings.CellSize = FMath::Max(FCString::Atof(**CellSize), 50.f);
+	}
+	if (const FString* Samples = Values.Find(TEXT("Samples")))
+	{
+		Settings.Samples = FMath::Clamp(FCString::Atoi(**Samples), 1, 5);
+	}
+	if (const FString* MaxOpenCells = Values.Find(TEXT("MaxOpenCells")))
+	{
+		Settings.MaxOpenCells = FMath::Max(FCString::Atoi(**MaxOpenCells), 1);
+	}
+
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (World == nullptr)
+	{
+		UE_LOG(LogTargetVisibilityBake, Error, TEXT("Cannot load the map %s"), *MapName);
+		return 1;
+	}
+
+	// Collision only: no rendering, navigation, AI or physics simulation.
+	World->WorldType = EWorldType::Editor;
+	World->AddToRoot();
+	if (!World->bIsWorldInitialized)
+	{
+		UWorld::InitializationValues InitializationValues;
+		InitializationValues.RequiresHitProxies(false);
+		InitializationValues.ShouldSimulatePhysics(false);
+		InitializationValues.EnableTraceCollision(true);
+		InitializationValues.CreateNavigation(false);
+		InitializationValues.CreateAISystem(false);
+		InitializationValues.AllowAudioPlayback(false);
+		World->InitWorld(InitializationValues);
+	}
+	World->UpdateWorldComponents(true, false);
+
+	const bool bBaked = Bake(World, Package->GetName(), Settings);
+
+	World->CleanupWorld();
+	World->RemoveFromRoot();
+
+	return bBaked ? 0 : 1;
+#else
+	return 1;
+#endif
+}
+
+bool UTargetVisibilityBakeCommandlet::Bake(UWorld* World, const FString& MapName, const FSettings& Settings)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Static geometry bounds.
+	FBox Bounds(ForceInit);
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(*It);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (Primitive->Mobility == EComponentMobility::Static && Primitive->IsCollisionEnabled())
+			{
+				Bounds += Primitive->Bounds.GetBox();
+			}
+		}
+	}
+
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogTargetVisibilityBake, Error, TEXT("%s has no static collision"), *MapName);
+		return false;
+	}
+
+	const float CellSize = Settings.CellSize;
+	const FVector Size = Bounds.GetSize();
+	const FIntVector Dimensions(
+		FMath::Max(FMath::CeilToInt(Size.X / CellSize), 1),
+		FMath::Max(FMath::CeilToInt(Size.Y / CellSize), 1),
+		FMath::Max(FMath::CeilToInt(Size.Z / CellSize), 1));
+	const int64 NumCells = int64(Dimensions.X) * Dimensions.Y * Dimensions.Z;
+
+	if (NumCells > MAX_int32 / 4)
+	{
+		UE_LOG(LogTargetVisibilityBake, Error, TEXT("%s: %lld cells of %.0f, raise CellSize"), *MapName, NumCells, CellSize);
+		return false;
+	}
+
+	auto GetCellCenter = [&](int32 X, int32 Y, int32 Z)
+	{
+		return Bounds.Min + FVector(X + 0.5f, Y + 0.5f, Z + 0.5f) * CellSize;
+	};
+
+	// Cells whose center is embedded in simple collision are never looked from nor at.
+	const FCollisionObjectQueryParams StaticObjects(ECC_WorldStatic);
+	const FCollisionQueryParams OverlapParams(SCENE_QUERY_STAT(TargetVisibilityBakeOverlap), false);
+	const FCollisionShape CenterShape = FCollisionShape::MakeSphere(CellSize * 0.05f);
+
+	TArray<int32> CellIndices;
+	CellIndices.SetNumUninitialized(NumCells);
+	TArray<FVector> OpenCenters;
+	for (int32 Z = 0; Z < Dimensions.Z; ++Z)
+	{
+		for (int32 Y = 0; Y < Dimensions.Y; ++Y)
+		{
+			for (int32 X = 0; X < Dimensions.X; ++X)
+			{
+				const FVector Center = GetCellCenter(X, Y, Z);
+				const bool bEmbedded = World->OverlapAnyTestByObjectType(Center, FQuat::Identity, StaticObjects, CenterShape, OverlapParams);
+
+				CellIndices[(Z * Dimensions.Y + Y) * Dimensions.X + X] = bEmbedded ? INDEX_NONE : OpenCenters.Add(Center);
+			}
+		}
+	}
+
+	const int32 NumOpenCells = OpenCenters.Num();
+	if (NumOpenCells > Settings.MaxOpenCells)
+	{
+		UE_LOG(LogTargetVisibilityBake, Error, TEXT("%s: %d open cells of %.0f over MaxOpenCells %d, raise CellSize"), *MapName, NumOpenCells, CellSize, Settings.MaxOpenCells);
+		return false;
+	}
+
+	UE_LOG(LogTargetVisibilityBake, Log, TEXT("%s: %dx%dx%d cells of %.0f, %d open"), *MapName, Dimensions.X, Dimensions.Y, Dimensions.Z, CellSize, NumOpenCells);
+
+	// Center to center first, then spread points of each cell, so ambiguous pairs are found early.
+	const float Quarter = CellSize * 0.25f;
+	const FVector SampleOffsets[] = {
+		FVector::ZeroVector,
+		FVector(Quarter, Quarter, Quarter),
+		FVector(-Quarter, -Quarter, Quarter),
+		FVector(Quarter, -Quarter, -Quarter),
+		FVector(-Quarter, Quarter, -Quarter)
+	};
+
+	const FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(TargetVisibilityBake), true);
+
+	auto BakePair = [&](int32 First, int32 Second)
+	{
+		if (First == Second)
+			return FTargetVisibilityTable::EState::Ambiguous;
+
+		int32 NumBlocked = 0;
+		for (int32 Sample = 0; Sample < Settings.Samples; ++Sample)
+		{
+			const FVector Start = OpenCenters[First] + SampleOffsets[Sample];
+			const FVector End = OpenCenters[Second] - SampleOffsets[Sample];
+			NumBlocked += World->LineTraceTestByObjectType(Start, End, StaticObjects, TraceParams) ? 1 : 0;
+
+			if (NumBlocked != 0 && NumBlocked != Sample + 1)
+				return FTargetVisibilityTable::EState::Ambiguous;
+		}
+
+		return NumBlocked == 0 ? FTargetVisibilityTable::EState::Visible : FTargetVisibilityTable::EState::Occluded;
+	};
+
+	// 16 pairs per word: a word is only written by the task baking it.
+	const int64 NumPairs = FTargetVisibilityTable::GetPairIndex(0, NumOpenCells);
+	const int64 NumWords = (NumPairs + 15) / 16;
+	TArray<uint32> Words;
+	Words.SetNumZeroed(NumWords);
+
+	FThreadSafeCounter BakedWords;
+	ParallelFor(int32(NumWords), [&](int32 Word)
+	{
+		const int64 FirstPair = int64(Word) * 16;
+
+		// Second cell of the first pair of the word, pairs then follow the triangle rows.
+		int32 Second = int32((FMath::Sqrt(8.0 * FirstPair + 1.0) - 1.0) * 0.5);
+		while (FTargetVisibilityTable::GetPairIndex(0, Second + 1) <= FirstPair)
+			++Second;
+		while (FTargetVisibilityTable::GetPairIndex(0, Second) > FirstPair)
+			--Second;
+		int32 First = int32(FirstPair - FTargetVisibilityTable::GetPairIndex(0, Second));
+
+		uint32 Bits = 0;
+		for (int64 Pair = FirstPair; Pair < FMath::Min(FirstPair + 16, NumPairs); ++Pair)
+		{
+			Bits |= uint32(BakePair(First, Second)) << ((Pair & 15) * 2);
+
+			if (++First > Second)
+			{
+				First = 0;
+				++Second;
+			}
+		}
+		Words[Word] = Bits;
+
+		const int32 Done = BakedWords.Increment();
+		if (Done % FMath::Max<int32>(NumWords / 20, 1) == 0)
+		{
+			UE_LOG(LogTargetVisibilityBake, Display, TEXT("%d%%"), int32(int64(Done) * 100 / NumWords));
+		}
+	});
+
+	// Words are little endian: pair p is at byte p / 4, bits (p % 4) * 2, as the table reads them.
+	TArray<uint8> Pairs;
+	Pairs.SetNumUninitialized(FTargetVisibilityTable::GetPairBytes(NumOpenCells));
+	FMemory::Memcpy(Pairs.GetData(), Words.GetData(), Pairs.Num());
+
+	int64 Counts[3] = {};
+	for (int64 Pair = 0; Pair < NumPairs; ++Pair)
+	{
+		++Counts[(Pairs[Pair >> 2] >> ((Pair & 3) * 2)) & 3];
+	}
+
+	const FString Path = FTargetVisibilityTable::GetPath(MapName);
+	if (!FTargetVisibilityTable::Save(Path, Bounds.Min, CellSize, Dimensions, CellIndices, NumOpenCells, Pairs))
+	{
+		UE_LOG(LogTargetVisibilityBake, Error, TEXT("Cannot write %s"), *Path);
+		return false;
+	}
+
+	UE_LOG(LogTargetVisibilityBake, Log, TEXT("Baked %s in %.1fs: %lld pairs, %.1f%% visible, %.1f%% occluded, %.1f%% ambiguous, %lld KB"),
+		*Path, FPlatformTime::Seconds() - StartTime, NumPairs,
+		100.0 * Counts[1] / FMath::Max<int64>(NumPairs, 1), 100.0 * Counts[2] / FMath::Max<int64>(NumPairs, 1), 100.0 * Counts[0] / FMath::Max<int64>(NumPairs, 1),
+		(sizeof(int32) * NumCells + Pairs.Num()) / 1024);
+	return true;
+}
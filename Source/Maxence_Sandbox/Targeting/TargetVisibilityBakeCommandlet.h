@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TargetVisibilityBakeCommandlet.generated.h"
+
+class UWorld;
+
+/**
+ * Bakes the cell to cell visibility table of a map, see FTargetVisibilityTable:
+ *   UE4Editor-Cmd Maxence_Sandbox -run=TargetVisibilityBake -Map=/Game/Maps/Arena [-CellSize=500] [-Samples=5] [-MaxOpenCells=16384]
+ * Only static geometry is considered. The table grows with the square of the open cells: raise CellSize for larger maps.
+ */
+UCLASS()
+class UTargetVisibilityBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTargetVisibilityBakeCommandlet();
+
+	int32 Main(const FString& Params) override;
+
+private:
+	struct FSettings
+	{
+		float CellSize = 500.f;
+
+		/// Sample rays per cell pair, from the centers then from spread points of the two cells.
+		int32 Samples = 5;
+
+		int32 MaxOpenCells = 16384;
+	};
+
+	static bool Bake(UWorld* World, const FString& MapName, const FSettings& Settings);
+};
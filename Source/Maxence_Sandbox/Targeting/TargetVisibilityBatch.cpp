@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetVisibilityBatch.h"
+#include "TargetingStats.h"
+#include "TargetingSubsystem.h"
+#include "TargetVisibilityTable.h"
+
+#include <Engine/World.h>
+#include <GameFramework/Actor.h>
+#include <HAL/IConsoleManager.h>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Visibility batch size"), STAT_TargetingVisibilityBatchSize, STATGROUP_Targeting);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Visibility batch latency (ms)"), STAT_TargetingVisibilityBatchLatency, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility table rejects"), STAT_TargetingVisibilityTableRejects, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility table accepts"), STAT_TargetingVisibilityTableAccepts, STATGROUP_Targeting);
+
+static TAutoConsoleVariable<int32> CVarTargetingAsyncVisibility(
+	TEXT("Targeting.AsyncVisibility"),
+	1,
+	TEXT("1: lock-on visibility traces are issued as one async batch and consumed next frame (default).\n")
+	TEXT("0: one synchronous trace per candidate."),
+	ECVF_Default);
+
+bool FTargetVisibilityBatch::IsEnabled()
+{
+	return CVarTargetingAsyncVisibility.GetValueOnGameThread() != 0;
+}
+
+bool FTargetVisibilityBatch::IsVisibleHit(bool bBlockingHit, const FHitResult& Hit, const AActor* Target)
+{
+	return !bBlockingHit || Hit.Actor.Get() == Target;
+}
+
+bool FTargetVisibilityBatch::QueryTable(const FTargetVisibilityTable* Table, const FVector& Start, const FVector& End, bool& OutVisible)
+{
+	if (Table == nullptr)
+		return false;
+
+	switch (Table->Query(Start, End))
+	{
+	case FTargetVisibilityTable::EState::Occluded:
+		INC_DWORD_STAT(STAT_TargetingVisibilityTableRejects);
+		OutVisible = false;
+		return true;
+
+	case FTargetVisibilityTable::EState::Visible:
+		if (FTargetVisibilityTable::GetUsage() != FTargetVisibilityTable::EUsage::RejectOccludedAcceptVisible)
+			return false;
+
+		INC_DWORD_STAT(STAT_TargetingVisibilityTableAccepts);
+		OutVisible = true;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+void FTargetVisibilityBatch::Issue(UWorld* World, const FVector& InStart, const TArray<AActor*>& InCandidates)
+{
+	Cancel();
+
+	static const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TargetVisibilityBatch));
+
+	Start = InStart;
+	Candidates.Reserve(InCandidates.Num());
+	Ends.Reserve(InCandidates.Num());
+	Handles.Reserve(InCandidates.Num());
+	TableResults.Reserve(InCandidates.Num());
+
+	UTargetingSubsystem* TargetingSubsystem = UTargetingSubsystem::Get(World);
+	const FTargetVisibilityTable* Table = TargetingSubsystem ? TargetingSubsystem->GetVisibilityTable() : nullptr;
+
+	int32 NumTraces = 0;
+	for (AActor* Candidate : InCandidates)
+	{
+		if (!IsValid(Candidate))
+			continue;
+
+		const FVector End = Candidate->GetActorLocation();
+
+		Candidates.Add(Candidate);
+		Ends.Add(End);
+
+		// Decided candidates keep their slot and are reported with the traced ones.
+		bool bVisible;
+		if (QueryTable(Table, Start, End, bVisible))
+		{
+			Handles.Add(FTraceHandle());
+			TableResults.Add(uint8(bVisible ? FTargetVisibilityTable::EState::Visible : FTargetVisibilityTable::EState::Occluded));
+			continue;
+		}
+
+		Handles.Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, ECollisionChannel::ECC_Visibility, QueryParams));
+		TableResults.Add(uint8(FTargetVisibilityTable::EState::Ambiguous));
+		++NumTraces;
+	}
+
+	IssueFrame = GFrameCounter;
+	IssueTime = FPlatformTime::Seconds();
+
+	INC_DWORD_STAT_BY(STAT_TargetingVisibilityTraces, NumTraces);
+	CSV_CUSTOM_STAT(DynamicCamera, TracesIssued, NumTraces, ECsvCustomStatOp::Accumulate);
+	SET_DWORD_STAT(STAT_TargetingVisibilityBatchSize, NumTraces);
+}
+
+bool FTargetVisibilityBatch::IsReady() const
+{
+	return IsPending() && GFrameCounter > IssueFrame;
+}
+
+void FTargetVisibilityBatch::Resolve(UWorld* World, TFunctionRef<void(AActor* Candidate, bool bVisible, const FVector& Start, const FVector& End)> OnResult)
+{
+	FTraceDatum Datum;
+
+	for (int32 TraceIndex = 0; TraceIndex < Handles.Num(); ++TraceIndex)
+	{
+		AActor* Candidate = Candidates[TraceIndex].Get();
+
+		if (Candidate == nullptr)
+			continue;
+
+		if (TableResults[TraceIndex] != uint8(FTargetVisibilityTable::EState::Ambiguous))
+		{
+			OnResult(Candidate, TableResults[TraceIndex] == uint8(FTargetVisibilityTable::EState::Visible), Start, Ends[TraceIndex]);
+			continue;
+		}
+
+		if (!World->QueryTraceData(Handles[TraceIndex], Datum))
+			continue;
+
+		const bool bBlockingHit = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit;
+		OnResult(Candidate, IsVisibleHit(bBlockingHit, bBlockingHit ? Datum.OutHits[0] : FHitResult(), Candidate), Start, Ends[TraceIndex]);
+	}
+
+	SET_FLOAT_STAT(STAT_TargetingVisibilityBatchLatency, (FPlatformTime::Seconds() - IssueTime) * 1000.0);
+
+	Cancel();
+}
+
+void FTargetVisibilityBatch::Cancel()
+{
+	Candidates.Reset();
+	Ends.Reset();
+	Handles.Reset();
+	TableResults.Reset();
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "WorldCollision.h"
+
+class UWorld;
+class AActor;
+class FTargetVisibilityTable;
+
+/**
+ * Line of sight test of a whole candidate list, issued at once through the async trace system.
+ * The physics scene resolves the traces in parallel with the rest of the frame they are issued in,
+ * and their results are consumed from the next frame on.
+ */
+class MAXENCE_SANDBOX_API FTargetVisibilityBatch
+{
+public:
+	/// Whether targeting should batch its visibility traces (Targeting.AsyncVisibility).
+	static bool IsEnabled();
+
+	/// Whether a hit from a visibility trace toward Target means Target is visible.
+	static bool IsVisibleHit(bool bBlockingHit, const FHitResult& Hit, const AActor* Target);
+
+	/// Visibility from Start to End according to a baked table, within Targeting.VisibilityTable.
+	/// <returns>false if a trace is needed, OutVisible is the answer otherwise.</returns>
+	static bool QueryTable(const FTargetVisibilityTable* Table, const FVector& Start, const FVector& End, bool& OutVisible);
+
+	/// Issues one visibility trace per candidate, from Start to the candidate location, except for the candidates
+	/// the baked visibility table decides. Replaces any pending batch.
+	void Issue(UWorld* World, const FVector& InStart, const TArray<AActor*>& InCandidates);
+
+	/// Whether a batch has been issued and not resolved yet.
+	bool IsPending() const { return Handles.Num() > 0; }
+
+	/// Whether the pending batch can be resolved: the frame it was issued in is over.
+	bool IsReady() const;
+
+	/// Reports the result of every landed trace and ends the batch.
+	/// Results only live for one frame: traces resolved late are dropped and not reported.
+	void Resolve(UWorld* World, TFunctionRef<void(AActor* Candidate, bool bVisible, const FVector& Start, const FVector& End)> OnResult);
+
+	/// Drops the pending batch.
+	void Cancel();
+
+private:
+	TArray<TWeakObjectPtr<AActor>> Candidates;
+	TArray<FVector> Ends;
+	TArray<FTraceHandle> Handles;
+
+	/// Result decided by the baked visibility table, Ambiguous when traced.
+	TArray<uint8> TableResults;
+
+	FVector Start = FVector::ZeroVector;
+
+	uint64 IssueFrame = 0;
+	double IssueTime = 0.0;
+};
@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetVisibilityCache.h"
+#include "TargetingStats.h"
+#include "TargetingBudget.h"
+
+#include <Engine/World.h>
+#include <GameFramework/Actor.h>
+#include <HAL/IConsoleManager.h>
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Visibility cache entries"), STAT_TargetingVisibilityCacheEntries, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Visibility cache stale entries"), STAT_TargetingVisibilityCacheStale, STATGROUP_Targeting);
+
+static TAutoConsoleVariable<int32> CVarVisibilityTracesPerFrame(
+	TEXT("Targeting.VisibilityCache.TracesPerFrame"),
+	8,
+	TEXT("Maximum number of visibility cache entries re-traced per frame."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarVisibilityMaxAge(
+	TEXT("Targeting.VisibilityCache.MaxAge"),
+	0.25f,
+	TEXT("Age in seconds after which a visibility cache entry is re-traced."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarVisibilityMoveThreshold(
+	TEXT("Targeting.VisibilityCache.MoveThreshold"),
+	50.f,
+	TEXT("Distance the eye or the target has to move before a visibility cache entry is re-traced."),
+	ECVF_Default);
+
+void FTargetVisibilityCache::Update(UWorld* World, const FVector& Eye, const TArray<AActor*>& Candidates)
+{
+	if (RefreshBatch.IsReady())
+	{
+		RefreshBatch.Resolve(World, [this](AActor* Candidate, bool bVisible, const FVector& Start, const FVector& End)
+		{
+			Store(Candidate, bVisible, Start, End);
+		});
+	}
+
+	const bool bRefreshInFlight = RefreshBatch.IsPending();
+	const uint64 Frame = GFrameCounter;
+	const double Now = World->GetTimeSeconds();
+	const float MaxAge = CVarVisibilityMaxAge.GetValueOnGameThread();
+	const float MoveThresholdSquared = FMath::Square(CVarVisibilityMoveThreshold.GetValueOnGameThread());
+
+	struct FStaleEntry
+	{
+		AActor* Target;
+		double TraceTime;
+	};
+	TArray<FStaleEntry, TInlineAllocator<64>> StaleEntries;
+
+	for (AActor* Candidate : Candidates)
+	{
+		FEntry& Entry = Entries.FindOrAdd(Candidate);
+		Entry.LastSeenFrame = Frame;
+
+		if (!bRefreshInFlight)
+		{
+			Entry.bInFlight = false;
+		}
+
+		if (Entry.bInFlight)
+			continue;
+
+		const bool bStale = !Entry.bKnown
+			|| Now - Entry.TraceTime > MaxAge
+			|| FVector::DistSquared(Entry.Eye, Eye) > MoveThresholdSquared
+			|| FVector::DistSquared(Entry.TargetLocation, Candidate->GetActorLocation()) > MoveThresholdSquared;
+
+		if (bStale)
+		{
+			// Never traced entries go first.
+			StaleEntries.Add(FStaleEntry{ Candidate, Entry.bKnown ? Entry.TraceTime : -1.0 });
+		}
+	}
+
+	// Forget targets that left the candidates.
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		if (It.Value().LastSeenFrame != Frame)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_TargetingVisibilityCacheStale, StaleEntries.Num());
+	SET_DWORD_STAT(STAT_TargetingVisibilityCacheEntries, Entries.Num());
+
+	// One refresh batch in flight at a time keeps the budget per frame.
+	if (bRefreshInFlight || StaleEntries.Num() == 0)
+		return;
+
+	const int32 Budget = FTargetingBudget::GetTracesPerFrame(FMath::Max(0, CVarVisibilityTracesPerFrame.GetValueOnGameThread()));
+	if (StaleEntries.Num() > Budget)
+	{
+		StaleEntries.Sort([](const FStaleEntry& Lhs, const FStaleEntry& Rhs) { return Lhs.TraceTime < Rhs.TraceTime; });
+		StaleEntries.SetNum(Budget, false);
+	}
+
+	TArray<AActor*> Targets;
+	Targets.Reserve(StaleEntries.Num());
+	for (const FStaleEntry& StaleEntry : StaleEntries)
+	{
+		Targets.Add(StaleEntry.Target);
+		Entries.FindChecked(StaleEntry.Target).bInFlight = true;
+	}
+
+	RefreshBatch.Issue(World, Eye, Targets);
+}
+
+void FTargetVisibilityCache::Store(const AActor* Target, bool bVisible, const FVector& Eye, const FVector& TargetLocation)
+{
+	FEntry& Entry = Entries.FindOrAdd(Target);
+	Entry.Eye = Eye;
+	Entry.TargetLocation = TargetLocation;
+	Entry.TraceTime = Target->GetWorld()->GetTimeSeconds();
+	Entry.LastSeenFrame = GFrameCounter;
+	Entry.bVisible = bVisible;
+	Entry.bKnown = true;
+}
+
+bool FTargetVisibilityCache::IsKnown(const AActor* Target) const
+{
+	const FEntry* Entry = Entries.Find(Target);
+	return Entry != nullptr && Entry->bKnown;
+}
+
+bool FTargetVisibilityCache::IsVisible(const AActor* Target) const
+{
+	const FEntry* Entry = Entries.Find(Target);
+	return Entry != nullptr && Entry->bVisible;
+}
+
+void FTargetVisibilityCache::GetUnknown(const TArray<AActor*>& Candidates, TArray<AActor*>& OutUnknown) const
+{
+	for (AActor* Candidate : Candidates)
+	{
+		if (!IsKnown(Candidate))
+		{
+			OutUnknown.Add(Candidate);
+		}
+	}
+}
+
+void FTargetVisibilityCache::Reset()
+{
+	RefreshBatch.Cancel();
+	Entries.Reset();
+}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "TargetVisibilityBatch.h"
+
+class UWorld;
+class AActor;
+
+/**
+ * Last known line of sight of every targeting candidate.
+ * Visibility barely changes from one frame to the next, so entries are only re-traced once they are older
+ * than Targeting.VisibilityCache.MaxAge or once the eye or the target moved past Targeting.VisibilityCache.MoveThreshold,
+ * stalest first and at most Targeting.VisibilityCache.TracesPerFrame per frame.
+ */
+class MAXENCE_SANDBOX_API FTargetVisibilityCache
+{
+public:
+	/// Lands the previous refresh batch, forgets targets that are not candidates anymore
+	/// and issues a refresh batch for the stalest entries, within the per frame budget.
+	void Update(UWorld* World, const FVector& Eye, const TArray<AActor*>& Candidates);
+
+	/// Stores a trace result.
+	void Store(const AActor* Target, bool bVisible, const FVector& Eye, const FVector& TargetLocation);
+
+	/// Whether Target has been traced at least once, even if the result is stale.
+	bool IsKnown(const AActor* Target) const;
+
+	/// Last known visibility of Target. Unknown targets are not visible.
+	bool IsVisible(const AActor* Target) const;
+
+	/// Adds the candidates that have never been traced to OutUnknown.
+	void GetUnknown(const TArray<AActor*>& Candidates, TArray<AActor*>& OutUnknown) const;
+
+	void Reset();
+
+private:
+	struct FEntry
+	{
+		FVector Eye = FVector::ZeroVector;
+		FVector TargetLocation = FVector::ZeroVector;
+		double TraceTime = 0.0;
+		uint64 LastSeenFrame = 0;
+		bool bVisible = false;
+		bool bKnown = false;
+		bool bInFlight = false;
+	};
+
+	TMap<TObjectKey<AActor>, FEntry> Entries;
+
+	/// Budgeted refresh traces issued by the previous Update.
+	FTargetVisibilityBatch RefreshBatch;
+};
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetVisibilityTable.h"
+
+#include <Async/MappedFileHandle.h>
+#include <HAL/FileManager.h>
+#include <HAL/IConsoleManager.h>
+#include <HAL/PlatformFilemanager.h>
+#include <Misc/FileHelper.h>
+#include <Misc/PackageName.h>
+#include <Misc/Paths.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogTargetVisibilityTable, Log, All);
+
+static TAutoConsoleVariable<int32> CVarVisibilityTable(
+	TEXT("Targeting.VisibilityTable"),
+	2,
+	TEXT("Use of the baked cell to cell visibility table of the level, when there is one:\n")
+	TEXT("0: off, every visibility test traces.\n")
+	TEXT("1: candidates in occluded cells are rejected without a trace.\n")
+	TEXT("2: candidates in visible cells are accepted without a trace too, only ambiguous cells trace (default)."),
+	ECVF_Scalability);
+
+constexpr uint32 FTargetVisibilityTable::Magic;
+constexpr uint32 FTargetVisibilityTable::Version;
+
+FTargetVisibilityTable::EUsage FTargetVisibilityTable::GetUsage()
+{
+	return EUsage(FMath::Clamp(CVarVisibilityTable.GetValueOnGameThread(), 0, 2));
+}
+
+FString FTargetVisibilityTable::GetPath(const FString& MapPackageName)
+{
+	return FPaths::ProjectContentDir() / TEXT("VisibilityTables") / FPackageName::GetShortName(MapPackageName) + TEXT(".vistable");
+}
+
+FTargetVisibilityTable::~FTargetVisibilityTable()
+{
+	Unload();
+}
+
+bool FTargetVisibilityTable::Load(const FString& Path)
+{
+	Unload();
+
+	const uint8* Data = nullptr;
+	int64 Size = 0;
+
+	MappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Path);
+	if (MappedFile)
+	{
+		MappedRegion = MappedFile->MapRegion(0, MappedFile->GetFileSize());
+	}
+
+	if (MappedRegion)
+	{
+		Data = MappedRegion->GetMappedPtr();
+		Size = MappedRegion->GetMappedSize();
+	}
+	else if (FPaths::FileExists(Path) && FFileHelper::LoadFileToArray(LoadedFile, *Path))
+	{
+		Data = LoadedFile.GetData();
+		Size = LoadedFile.Num();
+	}
+	else
+	{
+		Unload();
+		return false;
+	}
+
+	if (Size < int64(sizeof(FHeader)))
+	{
+		Unload();
+		return false;
+	}
+
+	FMemory::Memcpy(&Header, Data, sizeof(FHeader));
+
+	const int64 NumCells = int64(Header.Dimensions.X) * Header.Dimensions.Y * Header.Dimensions.Z;
+	const int64 ExpectedSize = sizeof(FHeader) + NumCells * sizeof(int32) + GetPairBytes(Header.NumOpenCells);
+	if (Header.Magic != Magic || Header.Version != Version || Header.CellSize <= 0.f || Size < ExpectedSize)
+	{
+		UE_LOG(LogTargetVisibilityTable, Warning, TEXT("%s is not a visibility table of version %d"), *Path, Version);
+		Unload();
+		return false;
+	}
+
+	InvCellSize = 1.f / Header.CellSize;
+	Cells = reinterpret_cast<const int32*>(Data + sizeof(FHeader));
+	Pairs = Data + sizeof(FHeader) + NumCells * sizeof(int32);
+
+	UE_LOG(LogTargetVisibilityTable, Log, TEXT("Mapped %s: %d open cells of %.0f, %lld KB"), *Path, Header.NumOpenCells, Header.CellSize, Size / 1024);
+	return true;
+}
+
+void FTargetVisibilityTable::Unload()
+{
+	Cells = nullptr;
+	Pairs = nullptr;
+
+	delete MappedRegion;
+	MappedRegion = nullptr;
+	delete MappedFile;
+	MappedFile = nullptr;
+
+	LoadedFile.Empty();
+}
+
+int32 FTargetVisibilityTable::GetOpenCell(const FVector& Location) const
+{
+	const FVector Local = (Location - Header.Origin) * InvCellSize;
+	const int32 X = FMath::FloorToInt(Local.X);
+	const int32 Y = FMath::FloorToInt(Local.Y);
+	const int32 Z = FMath::FloorToInt(Local.Z);
+
+	if (X < 0 || Y < 0 || Z < 0 || X >= Header.Dimensions.X || Y >= Header.Dimensions.Y || Z >= Header.Dimensions.Z)
+		return INDEX_NONE;
+
+	return Cells[(Z * Header.Dimensions.Y + Y) * Header.Dimensions.X + X];
+}
+
+FTargetVisibilityTable::EState FTargetVisibilityTable::Query(const FVector& From, const FVector& To) const
+{
+	if (Cells == nullptr)
+		return EState::Ambiguous;
+
+	const int32 FromCell = GetOpenCell(From);
+	const int32 ToCell = GetOpenCell(To);
+	if (FromCell == INDEX_NONE || ToCell == INDEX_NONE)
+		return EState::Ambiguous;
+
+	const int64 Pair = GetPairIndex(FromCell, ToCell);
+	return EState((Pairs[Pair >> 2] >> ((Pair & 3) * 2)) & 3);
+}
+
+bool FTargetVisibilityTable::Save(const FString& Path, const FVector& Origin, float CellSize, const FIntVector& Dimensions, const TArray<int32>& CellIndices, int32 NumOpenCells, const TArray<uint8>& InPairs)
+{
+	TUniquePtr<FArchive> File(IFileManager::Get().CreateFileWriter(*Path));
+	if (!File.IsValid())
+		return false;
+
+	FHeader FileHeader;
+	FileHeader.Magic = Magic;
+	FileHeader.Version = Version;
+	FileHeader.Origin = Origin;
+	FileHeader.CellSize = CellSize;
+	FileHeader.Dimensions = Dimensions;
+	FileHeader.NumOpenCells = NumOpenCells;
+
+	File->Serialize(&FileHeader, sizeof(FileHeader));
+	File->Serialize(const_cast<int32*>(CellIndices.GetData()), CellIndices.Num() * sizeof(int32));
+	File->Serialize(const_cast<uint8*>(InPairs.GetData()), InPairs.Num());
+
+	return File->Close();
+}
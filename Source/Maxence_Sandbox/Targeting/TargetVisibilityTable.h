@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+ * Baked cell to cell potential visibility of a level static geometry.
+ * The level is voxelized in cubic cells, cells embedded in geometry are dropped, and every pair of open cells
+ * stores 2 bits: visible (every sample ray between the two cells is clear), occluded (every one is blocked)
+ * or ambiguous. The pairs are symmetric, only the lower triangle is stored.
+ *
+ * File layout, little endian, mapped as is:
+ *   header (40 bytes): magic, version, origin, cell size, cell counts, open cell count
+ *   int32 per grid cell: index of the open cell, INDEX_NONE when embedded
+ *   2 bits per open cell pair (i <= j), at pair j * (j + 1) / 2 + i
+ *
+ * Baked by UTargetVisibilityBakeCommandlet into Content/VisibilityTables/<Map>.vistable, staged as a loose file.
+ */
+class MAXENCE_SANDBOX_API FTargetVisibilityTable
+{
+public:
+	enum class EState : uint8
+	{
+		Ambiguous = 0,
+		Visible = 1,
+		Occluded = 2
+	};
+
+	/// Use of the baked tables by the visibility tests (Targeting.VisibilityTable).
+	enum class EUsage : uint8
+	{
+		Off,
+		RejectOccluded,
+		RejectOccludedAcceptVisible
+	};
+
+	static EUsage GetUsage();
+
+	/// Baked table file of a map, from its package name.
+	static FString GetPath(const FString& MapPackageName);
+
+	~FTargetVisibilityTable();
+
+	/// Maps the baked table file.
+	bool Load(const FString& Path);
+
+	void Unload();
+
+	bool IsLoaded() const { return Cells != nullptr; }
+
+	/// Baked visibility between the cells of From and To. Ambiguous outside of the grid and in embedded cells.
+	EState Query(const FVector& From, const FVector& To) const;
+
+	/// Writes a bake to Path.
+	/// <param name="CellIndices">Open cell index of every grid cell, X fastest.</param>
+	/// <param name="Pairs">2 bits per open cell pair, as laid out in the file.</param>
+	static bool Save(const FString& Path, const FVector& Origin, float CellSize, const FIntVector& Dimensions, const TArray<int32>& CellIndices, int32 NumOpenCells, const TArray<uint8>& Pairs);
+
+	static int64 GetPairIndex(int32 First, int32 Second)
+	{
+		const int64 Low = FMath::Min(First, Second);
+		const int64 High = FMath::Max(First, Second);
+		return High * (High + 1) / 2 + Low;
+	}
+
+	static int64 GetPairBytes(int32 NumOpenCells)
+	{
+		return (GetPairIndex(0, NumOpenCells) + 3) / 4;
+	}
+
+private:
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		FVector Origin;
+		float CellSize;
+		FIntVector Dimensions;
+		int32 NumOpenCells;
+	};
+
+	static_assert(sizeof(FHeader) == 40, "The visibility table header is mapped from the file as is.");
+
+	static constexpr uint32 Magic = 0x53495654; // TVIS
+	static constexpr uint32 Version = 1;
+
+	int32 GetOpenCell(const FVector& Location) const;
+
+	IMappedFileHandle* MappedFile = nullptr;
+	IMappedFileRegion* MappedRegion = nullptr;
+
+	/// File content on platforms without memory mapped files.
+	TArray<uint8> LoadedFile;
+
+	FHeader Header;
+	float InvCellSize = 0.f;
+	const int32* Cells = nullptr;
+	const uint8* Pairs = nullptr;
+};
@@ -0,0 +1,809 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include <Containers/Ticker.h>
+#include <Engine/World.h>
+#include <GameFramework/Character.h>
+#include <HAL/IConsoleManager.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/CoreDelegates.h>
+#include <Kismet/GameplayStatics.h>
+
+#include <Characters/AICharacter.h>
+#include <Camera/CameraComponent.h>
+#include <Characters/Components/DynamicCameraComponent.h>
+#include <Profiling/ProfilingReport.h>
+#include <Targeting/TargetScoring.h>
+#include <Targeting/TargetCandidateSet.h>
+#include <Targeting/TargetPoolSubsystem.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogTargetingBenchmark, Log, All);
+
+/**
+ * Lock-on scalability benchmark, runnable headless:
+ *   UE4Editor Maxence_Sandbox -game -nullrhi -unattended -ExecCmds="Targeting.Benchmark Max=100000, quit"
+ * Spawns growing target counts in generated layouts around the first player, times the targeting entry points
+ * of its camera and writes the percentiles to Saved/Profiling/TargetingBenchmark.
+ *
+ * Targeting.Benchmark.Tick compares whole game frames with the targets ticking themselves and with the targets
+ * only updated by the targeting batched tick, over real frames: run it without "quit" in ExecCmds.
+ *
+ * Targeting.Benchmark.Pool compares spawning and destroying targets with acquiring and releasing them from the
+ * target pool: churn cost per round and the garbage collection that follows.
+ *
+ * Targeting.Benchmark.CandidateSet replays the same overlap churn against the former AddUnique / Contains /
+ * RemoveSingle candidate array and against FTargetCandidateSet, for growing candidate counts.
+ */
+class FTargetingBenchmark
+{
+public:
+	static void Run(const TArray<FString>& Args, UWorld* World);
+
+	static void RunTick(const TArray<FString>& Args, UWorld* World);
+
+	static void RunPool(const TArray<FString>& Args, UWorld* World);
+
+	static void RunCandidateSet(const TArray<FString>& Args, UWorld* World);
+
+	class FTickRun;
+
+private:
+	enum class ELayout : uint8
+	{
+		Ring,
+		Grid,
+		Disk
+	};
+
+	struct FSettings
+	{
+		int32 MinTargets = 10;
+		int32 MaxTargets = 100000;
+		int32 Samples = 32;
+		TArray<ELayout> Layouts;
+		UClass* TargetClass = nullptr;
+	};
+
+	static const TCHAR* GetLayoutName(ELayout Layout);
+
+	static void GenerateLayout(ELayout Layout, int32 Count, const FVector& Center, float Radius, TArray<FVector>& OutLocations);
+
+	/// Times Samples calls of Body, Setup is called untimed before each of them.
+	template<typename SetupType, typename BodyType>
+	static void Measure(FString& Csv, const TCHAR* Function, ELayout Layout, int32 Count, int32 Samples, SetupType&& Setup, BodyType&& Body);
+
+	static void RunCount(FString& Csv, const FSettings& Settings, ELayout Layout, int32 Count, UWorld* World, UDynamicCameraComponent* Camera);
+
+	static UClass* ParseTargetClass(const FString& Command);
+
+	static void WriteCsv(const FString& Csv, const TCHAR* Name);
+};
+
+/**
+ * Multi-frame run of Targeting.Benchmark.Tick, driven by the core ticker.
+ * Each mode spawns the targets, lets Warmup frames pass, then records the game thread time of Frames frames.
+ */
+class FTargetingBenchmark::FTickRun
+{
+public:
+	enum class EMode : uint8
+	{
+		/// Targets register an empty actor tick on top of the batched tick, as before the batched tick existed.
+		ActorTick,
+		/// Targets are only updated by the targeting batched tick.
+		Batched,
+		Done
+	};
+
+	FTickRun(UWorld* InWorld, UClass* InTargetClass, int32 InCount, int32 InWarmup, int32 InFrames);
+	~FTickRun();
+
+private:
+	bool TickRun(float DeltaTime);
+
+	void OnBeginFrame();
+	void OnEndFrame();
+
+	void SpawnTargets();
+	void DestroyTargets();
+
+	void Report(const TCHAR* Mode, TArray<double>& Timings);
+
+	TWeakObjectPtr<UWorld> World;
+	UClass* TargetClass;
+	int32 Count;
+	int32 Warmup;
+	int32 Frames;
+
+	EMode Mode = EMode::ActorTick;
+	int32 Frame = 0;
+	uint64 FrameStartCycles = 0;
+
+	TArray<TWeakObjectPtr<AActor>> Targets;
+	TArray<double> FrameTimings;
+	FString Csv;
+
+	FDelegateHandle TickerHandle;
+	FDelegateHandle BeginFrameHandle;
+	FDelegateHandle EndFrameHandle;
+};
+
+/** The single tick run in progress, if any. */
+static TUniquePtr<FTargetingBenchmark::FTickRun> GTargetingTickRun;
+
+static FAutoConsoleCommandWithWorldAndArgs GTargetingBenchmarkCommand(
+	TEXT("Targeting.Benchmark"),
+	TEXT("Times lock-on targeting against growing target counts and writes a CSV to Saved/Profiling/TargetingBenchmark.\n")
+	TEXT("Min=<targets> Max=<targets> Samples=<calls per measure> Layout=<Ring|Grid|Disk|All> Class=<Dummy|AI>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FTargetingBenchmark::Run));
+
+static FAutoConsoleCommandWithWorldAndArgs GTargetingTickBenchmarkCommand(
+	TEXT("Targeting.Benchmark.Tick"),
+	TEXT("Compares game frame times with per-target actor ticks and with the targeting batched tick only.\n")
+	TEXT("Count=<targets> Warmup=<frames> Frames=<measured frames> Class=<Dummy|AI>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FTargetingBenchmark::RunTick));
+
+static FAutoConsoleCommandWithWorldAndArgs GTargetingPoolBenchmarkCommand(
+	TEXT("Targeting.Benchmark.Pool"),
+	TEXT("Compares spawn and destroy churn with target pool acquire and release churn, and the garbage collection after each.\n")
+	TEXT("Count=<targets per round> Rounds=<rounds> Class=<Dummy|AI>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FTargetingBenchmark::RunPool));
+
+static FAutoConsoleCommandWithWorldAndArgs GTargetingCandidateSetBenchmarkCommand(
+	TEXT("Targeting.Benchmark.CandidateSet"),
+	TEXT("Times overlap enter / leave / lookup churn on the linear candidate array and on the candidate set.\n")
+	TEXT("Min=<candidates> Max=<candidates> Ops=<churn operations per count>"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FTargetingBenchmark::RunCandidateSet));
+
+const TCHAR* FTargetingBenchmark::GetLayoutName(ELayout Layout)
+{
+	switch (Layout)
+	{
+	case ELayout::Ring:
+		return TEXT("Ring");
+	case ELayout::Grid:
+		return TEXT("Grid");
+	default:
+		return TEXT("Disk");
+	}
+}
+
+void FTargetingBenchmark::GenerateLayout(ELayout Layout, int32 Count, const FVector& Center, float Radius, TArray<FVector>& OutLocations)
+{
+	OutLocations.Reset(Count);
+
+	switch (Layout)
+	{
+	case ELayout::Ring:
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const float Angle = 2.f * PI * Index / Count;
+			OutLocations.Add(Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * Radius * 0.5f);
+		}
+		break;
+
+	case ELayout::Grid:
+	{
+		const int32 Side = FMath::CeilToInt(FMath::Sqrt(float(Count)));
+		const float Spacing = 1.4f * Radius / FMath::Max(Side, 1);
+		const FVector Origin = Center - FVector(Spacing * (Side - 1) * 0.5f, Spacing * (Side - 1) * 0.5f, 0.f);
+
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			OutLocations.Add(Origin + FVector((Index % Side) * Spacing, (Index / Side) * Spacing, 0.f));
+		}
+		break;
+	}
+
+	default:
+	{
+		// Deterministic from one run to the next so results can be compared between releases.
+		FRandomStream Stream(1337);
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const float Angle = Stream.FRandRange(0.f, 2.f * PI);
+			const float Distance = Radius * FMath::Sqrt(Stream.FRand());
+			OutLocations.Add(Center + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * Distance);
+		}
+		break;
+	}
+	}
+}
+
+template<typename SetupType, typename BodyType>
+void FTargetingBenchmark::Measure(FString& Csv, const TCHAR* Function, ELayout Layout, int32 Count, int32 Samples, SetupType&& Setup, BodyType&& Body)
+{
+	TArray<double> Timings;
+	Timings.Reserve(Samples);
+
+	for (int32 Sample = 0; Sample < Samples; ++Sample)
+	{
+		Setup();
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Body();
+		Timings.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0);
+	}
+
+	Timings.Sort();
+
+	double Total = 0.0;
+	for (double Timing : Timings)
+	{
+		Total += Timing;
+	}
+
+	const double P50 = FProfilingReport::Percentile(Timings, 0.5);
+	const double P99 = FProfilingReport::Percentile(Timings, 0.99);
+
+	Csv += FString::Printf(TEXT("%s,%s,%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f\n"),
+		Function, GetLayoutName(Layout), Count, Samples,
+		Total / Timings.Num(), P50, FProfilingReport::Percentile(Timings, 0.9), P99, Timings.Last());
+
+	UE_LOG(LogTargetingBenchmark, Log, TEXT("%-20s %-5s %7d targets: p50 %.2fus p99 %.2fus"), Function, GetLayoutName(Layout), Count, P50, P99);
+}
+
+void FTargetingBenchmark::RunCount(FString& Csv, const FSettings& Settings, ELayout Layout, int32 Count, UWorld* World, UDynamicCameraComponent* Camera)
+{
+	TArray<FVector> Locations;
+	GenerateLayout(Layout, Count, Camera->GetOwner()->GetActorLocation(), Camera->MinimumRangeToSelect * 0.9f, Locations);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<AActor*> Targets;
+	Targets.Reserve(Count);
+	for (const FVector& Location : Locations)
+	{
+		Targets.Add(World->SpawnActor<AActor>(Settings.TargetClass, Location, FRotator::ZeroRotator, SpawnParameters));
+	}
+
+	// Let the overlap sphere (Targeting.UseSpatialIndex 0) see the new targets.
+	Camera->CameraRangeSphere->UpdateOverlaps();
+
+	const int32 Samples = Settings.Samples;
+	const float DeltaTime = 1.f / 60.f;
+
+	auto Unlock = [Camera]()
+	{
+		if (Camera->TargetLocked)
+		{
+			Camera->SetModeFree(CameraStates::LOCKED);
+		}
+	};
+	auto Lock = [Camera]()
+	{
+		if (!Camera->TargetLocked)
+		{
+			Camera->SetModeLocked(CameraStates::FREE);
+		}
+	};
+
+	Measure(Csv, TEXT("SetModeLocked"), Layout, Count, Samples, Unlock, [Camera]() { Camera->SetModeLocked(CameraStates::FREE); });
+
+	Measure(Csv, TEXT("TargetClosestAngle"), Layout, Count, Samples, Lock, [Camera]() { Camera->TargetClosestAngle(); });
+
+	// Gather, score and select over the camera candidates, then the scoring pass alone over the same positions.
+	Measure(Csv, TEXT("SelectBestCandidate"), Layout, Count, Samples, Lock,
+		[Camera]() { Camera->SelectBestCandidate(Camera->MinimumRangeToSelect, nullptr); });
+
+	FTargetScoringKernel Kernel;
+	Kernel.Reset(Locations.Num());
+	for (const FVector& Location : Locations)
+	{
+		Kernel.Add(Location, 1.f, MAX_FLT, true);
+	}
+
+	const FVector Origin = Camera->GetOwner()->GetActorLocation();
+	const FVector Forward = Camera->Camera->GetForwardVector();
+	FTargetScoringWeights Weights;
+	Weights.Angle = 1.f;
+	Weights.Priority = 1.f;
+	Weights.Recency = 1.f;
+
+	const double KernelStart = FPlatformTime::Seconds();
+	Measure(Csv, TEXT("ScoreKernel"), Layout, Count, Samples, []() {},
+		[&]() { Kernel.Score(Origin, Origin, Forward, Camera->MinimumRangeToSelect, Weights); Kernel.SelectBest(); });
+	UE_LOG(LogTargetingBenchmark, Log, TEXT("%-20s %-5s %7d targets: %.2fns per candidate (incl. timing overhead)"), TEXT("ScoreKernel"), GetLayoutName(Layout), Count,
+		(FPlatformTime::Seconds() - KernelStart) * 1.0e9 / (double(Samples) * FMath::Max(Kernel.Num(), 1)));
+
+	float Direction = 1.f;
+	Measure(Csv, TEXT("NavigateTargets"), Layout, Count, Samples,
+		[&]() { Lock(); Camera->NavigateTargets(0.f); Direction = -Direction; },
+		[&]() { Camera->NavigateTargets(Direction); });
+
+	Measure(Csv, TEXT("DoActionLocked"), Layout, Count, Samples, Lock, [Camera]() { Camera->DoActionLocked(); });
+	Measure(Csv, TEXT("TickLocked"), Layout, Count, Samples, Lock,
+		[Camera, DeltaTime]() { Camera->TickComponent(DeltaTime, LEVELTICK_All, &Camera->PrimaryComponentTick); });
+
+	Measure(Csv, TEXT("DoActionFree"), Layout, Count, Samples, Unlock, [Camera]() { Camera->DoActionFree(); });
+	Measure(Csv, TEXT("TickFree"), Layout, Count, Samples, Unlock,
+		[Camera, DeltaTime]() { Camera->TickComponent(DeltaTime, LEVELTICK_All, &Camera->PrimaryComponentTick); });
+
+	Unlock();
+
+	for (AActor* Target : Targets)
+	{
+		if (IsValid(Target))
+		{
+			Target->Destroy();
+		}
+	}
+}
+
+void FTargetingBenchmark::Run(const TArray<FString>& Args, UWorld* World)
+{
+	ACharacter* Player = UGameplayStatics::GetPlayerCharacter(World, 0);
+	UDynamicCameraComponent* Camera = Player ? Player->FindComponentByClass<UDynamicCameraComponent>() : nullptr;
+	if (Camera == nullptr)
+	{
+		UE_LOG(LogTargetingBenchmark, Error, TEXT("Targeting.Benchmark needs a player character with a UDynamicCameraComponent."));
+		return;
+	}
+
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	FSettings Settings;
+	FParse::Value(*Command, TEXT("Min="), Settings.MinTargets);
+	FParse::Value(*Command, TEXT("Max="), Settings.MaxTargets);
+	FParse::Value(*Command, TEXT("Samples="), Settings.Samples);
+	Settings.MinTargets = FMath::Max(1, Settings.MinTargets);
+	Settings.Samples = FMath::Max(1, Settings.Samples);
+
+	FString LayoutName = TEXT("All");
+	FParse::Value(*Command, TEXT("Layout="), LayoutName);
+	for (ELayout Layout : { ELayout::Ring, ELayout::Grid, ELayout::Disk })
+	{
+		if (LayoutName == TEXT("All") || LayoutName == GetLayoutName(Layout))
+		{
+			Settings.Layouts.Add(Layout);
+		}
+	}
+
+	Settings.TargetClass = ParseTargetClass(Command);
+
+	if (Settings.TargetClass == nullptr || Settings.Layouts.Num() == 0)
+	{
+		UE_LOG(LogTargetingBenchmark, Error, TEXT("Targeting.Benchmark: invalid Class or Layout."));
+		return;
+	}
+
+	// Every call is timed within a single frame: async visibility would never land.
+	IConsoleVariable* AsyncVisibility = IConsoleManager::Get().FindConsoleVariable(TEXT("Targeting.AsyncVisibility"));
+	const int32 PreviousAsyncVisibility = AsyncVisibility ? AsyncVisibility->GetInt() : 0;
+	if (AsyncVisibility)
+	{
+		AsyncVisibility->Set(0, ECVF_SetByCode);
+	}
+
+	FString Csv = TEXT("Function,Layout,Targets,Samples,MeanUs,P50Us,P90Us,P99Us,MaxUs\n");
+
+	for (ELayout Layout : Settings.Layouts)
+	{
+		for (int32 Count = Settings.MinTargets; Count <= Settings.MaxTargets; Count *= 10)
+		{
+			RunCount(Csv, Settings, Layout, Count, World, Camera);
+		}
+	}
+
+	if (AsyncVisibility)
+	{
+		AsyncVisibility->Set(PreviousAsyncVisibility, ECVF_SetByCode);
+	}
+
+	WriteCsv(Csv, TEXT("TargetingBenchmark"));
+}
+
+UClass* FTargetingBenchmark::ParseTargetClass(const FString& Command)
+{
+	// BP_Dummy carries the dummy mesh, the native ADummy has no root to be located with.
+	FString ClassName = TEXT("Dummy");
+	FParse::Value(*Command, TEXT("Class="), ClassName);
+	return ClassName == TEXT("AI")
+		? AAICharacter::StaticClass()
+		: LoadClass<AActor>(nullptr, TEXT("/Game/_Sandbox/Blueprints/BP_Dummy.BP_Dummy_C"));
+}
+
+void FTargetingBenchmark::WriteCsv(const FString& Csv, const TCHAR* Name)
+{
+	FProfilingReport::WriteCsv(Csv, TEXT("TargetingBenchmark"), Name);
+}
+
+void FTargetingBenchmark::RunPool(const TArray<FString>& Args, UWorld* World)
+{
+	UTargetPoolSubsystem* Pool = UTargetPoolSubsystem::Get(World);
+	ACharacter* Player = UGameplayStatics::GetPlayerCharacter(World, 0);
+
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	int32 Count = 200;
+	int32 Rounds = 20;
+	FParse::Value(*Command, TEXT("Count="), Count);
+	FParse::Value(*Command, TEXT("Rounds="), Rounds);
+	Count = FMath::Max(1, Count);
+	Rounds = FMath::Max(1, Rounds);
+
+	UClass* TargetClass = ParseTargetClass(Command);
+	if (Pool == nullptr || Player == nullptr || TargetClass == nullptr)
+	{
+		UE_LOG(LogTargetingBenchmark, Error, TEXT("Targeting.Benchmark.Pool needs a game world with a player character, and a valid Class."));
+		return;
+	}
+
+	TArray<FVector> Locations;
+	GenerateLayout(ELayout::Disk, Count, Player->GetActorLocation(), 3000.f, Locations);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Targets from an earlier run would be collected by the first measure.
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+
+	FString Csv = TEXT("Mode,Targets,Rounds,PrewarmMs,MeanRoundMs,MaxRoundMs,GcMs\n");
+	TArray<AActor*> Targets;
+	Targets.Reserve(Count);
+
+	auto Report = [&](const TCHAR* Mode, double PrewarmMs, const TArray<double>& RoundTimings)
+	{
+		const uint64 GcStartCycles = FPlatformTime::Cycles64();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS, true);
+		const double GcMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - GcStartCycles);
+
+		double Total = 0.0;
+		double Max = 0.0;
+		for (double Timing : RoundTimings)
+		{
+			Total += Timing;
+			Max = FMath::Max(Max, Timing);
+		}
+
+		Csv += FString::Printf(TEXT("%s,%d,%d,%.2f,%.3f,%.3f,%.2f\n"), Mode, Count, Rounds, PrewarmMs, Total / RoundTimings.Num(), Max, GcMs);
+		UE_LOG(LogTargetingBenchmark, Log, TEXT("%-6s %d targets x %d rounds: prewarm %.2fms, round %.3fms (max %.3fms), GC %.2fms"),
+			Mode, Count, Rounds, PrewarmMs, Total / RoundTimings.Num(), Max, GcMs);
+	};
+
+	// Spawn every target of a round, then destroy them: the destroyed actors are collected by the following GC.
+	TArray<double> RoundTimings;
+	for (int32 Round = 0; Round < Rounds; ++Round)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (const FVector& Location : Locations)
+		{
+			Targets.Add(World->SpawnActor<AActor>(TargetClass, Location, FRotator::ZeroRotator, SpawnParameters));
+		}
+		for (AActor* Target : Targets)
+		{
+			if (Target)
+			{
+				Target->Destroy();
+			}
+		}
+		RoundTimings.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+		Targets.Reset();
+	}
+	Report(TEXT("Spawn"), 0.0, RoundTimings);
+
+	// Same churn through the pool, pre-warmed like at level load.
+	const int32 PreviouslyPooled = Pool->GetNumPooled(TargetClass);
+	const uint64 PrewarmStartCycles = FPlatformTime::Cycles64();
+	Pool->Prewarm(TargetClass, PreviouslyPooled + Count);
+	const double PrewarmMs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - PrewarmStartCycles);
+
+	RoundTimings.Reset();
+	for (int32 Round = 0; Round < Rounds; ++Round)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		for (const FVector& Location : Locations)
+		{
+			Targets.Add(Pool->AcquireTarget(TargetClass, FTransform(Location)));
+		}
+		for (AActor* Target : Targets)
+		{
+			Pool->ReleaseTarget(Target);
+		}
+		RoundTimings.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles));
+		Targets.Reset();
+	}
+	Report(TEXT("Pool"), PrewarmMs, RoundTimings);
+
+	WriteCsv(Csv, TEXT("TargetPool"));
+}
+
+void FTargetingBenchmark::RunCandidateSet(const TArray<FString>& Args, UWorld* World)
+{
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	int32 MinCount = 16;
+	int32 MaxCount = 16384;
+	int32 Ops = 200000;
+	FParse::Value(*Command, TEXT("Min="), MinCount);
+	FParse::Value(*Command, TEXT("Max="), MaxCount);
+	FParse::Value(*Command, TEXT("Ops="), Ops);
+	MinCount = FMath::Max(1, MinCount);
+	Ops = FMath::Max(1, Ops);
+
+	FString Csv = TEXT("Container,Candidates,Ops,NsPerOp,IterateNs\n");
+
+	for (int32 Count = MinCount; Count <= MaxCount; Count *= 4)
+	{
+		// Keys only: the containers never dereference the candidates, so no actor has to be spawned.
+		// Twice as many actors as candidates come and go, each with up to two overlapping colliders.
+		TArray<AActor*> Universe;
+		Universe.SetNumUninitialized(Count * 2);
+		for (int32 Index = 0; Index < Universe.Num(); ++Index)
+		{
+			Universe[Index] = reinterpret_cast<AActor*>(UPTRINT(Index + 1) * 64);
+		}
+
+		enum class EOp : uint8 { Enter, Leave, Lookup };
+		struct FOp
+		{
+			EOp Op;
+			AActor* Actor;
+		};
+
+		// Deterministic churn, generated up front so both containers replay the exact same events.
+		TArray<FOp> Churn;
+		Churn.Reserve(Ops);
+		TArray<uint8> Overlaps;
+		Overlaps.SetNumZeroed(Universe.Num());
+		FRandomStream Stream(1337);
+		for (int32 Op = 0; Op < Ops; ++Op)
+		{
+			const int32 Index = Stream.RandHelper(Universe.Num());
+			const float Roll = Stream.FRand();
+			if (Roll < 0.5f)
+			{
+				Churn.Add({ EOp::Lookup, Universe[Index] });
+			}
+			else if (Overlaps[Index] == 0 || (Overlaps[Index] == 1 && Roll < 0.6f))
+			{
+				++Overlaps[Index];
+				Churn.Add({ EOp::Enter, Universe[Index] });
+			}
+			else
+			{
+				--Overlaps[Index];
+				Churn.Add({ EOp::Leave, Universe[Index] });
+			}
+		}
+
+		// Starts from Count candidates, half of the universe.
+		auto Fill = [&](auto&& Add)
+		{
+			for (int32 Index = 0; Index < Count; ++Index)
+			{
+				Add(Universe[Index * 2]);
+			}
+		};
+
+		int32 Found = 0;
+		auto Iterate = [&Found](const TArray<AActor*>& Candidates)
+		{
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			UPTRINT Sum = 0;
+			for (AActor* Candidate : Candidates)
+			{
+				Sum += UPTRINT(Candidate);
+			}
+			Found += int32(Sum & 1);
+			return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1.0e6;
+		};
+
+		// Former ObjectsInRange handling.
+		TArray<AActor*> Array;
+		Fill([&Array](AActor* Actor) { Array.AddUnique(Actor); });
+		uint64 StartCycles = FPlatformTime::Cycles64();
+		for (const FOp& Op : Churn)
+		{
+			switch (Op.Op)
+			{
+			case EOp::Enter:
+				Array.AddUnique(Op.Actor);
+				break;
+			case EOp::Leave:
+				if (Array.Contains(Op.Actor))
+				{
+					Array.RemoveSingle(Op.Actor);
+				}
+				break;
+			default:
+				Found += Array.Contains(Op.Actor) ? 1 : 0;
+				break;
+			}
+		}
+		const double ArrayNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1.0e6 / Ops;
+		const double ArrayIterateNs = Iterate(Array);
+
+		TArray<AActor*> Dense;
+		FTargetCandidateSet Set(Dense);
+		Fill([&Set](AActor* Actor) { Set.Add(Actor); });
+		StartCycles = FPlatformTime::Cycles64();
+		for (const FOp& Op : Churn)
+		{
+			switch (Op.Op)
+			{
+			case EOp::Enter:
+				Set.Add(Op.Actor);
+				break;
+			case EOp::Leave:
+				Set.Remove(Op.Actor);
+				break;
+			default:
+				Found += Set.Contains(Op.Actor) ? 1 : 0;
+				break;
+			}
+		}
+		const double SetNs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1.0e6 / Ops;
+		const double SetIterateNs = Iterate(Dense);
+
+		Csv += FString::Printf(TEXT("Array,%d,%d,%.1f,%.0f\n"), Count, Ops, ArrayNs, ArrayIterateNs);
+		Csv += FString::Printf(TEXT("CandidateSet,%d,%d,%.1f,%.0f\n"), Count, Ops, SetNs, SetIterateNs);
+		UE_LOG(LogTargetingBenchmark, Log, TEXT("%6d candidates: array %.1fns/op, candidate set %.1fns/op (%d)"), Count, ArrayNs, SetNs, Found);
+	}
+
+	WriteCsv(Csv, TEXT("CandidateSet"));
+}
+
+void FTargetingBenchmark::RunTick(const TArray<FString>& Args, UWorld* World)
+{
+	if (GTargetingTickRun.IsValid())
+	{
+		UE_LOG(LogTargetingBenchmark, Error, TEXT("Targeting.Benchmark.Tick is already running."));
+		return;
+	}
+
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	int32 Count = 10000;
+	int32 Warmup = 30;
+	int32 Frames = 300;
+	FParse::Value(*Command, TEXT("Count="), Count);
+	FParse::Value(*Command, TEXT("Warmup="), Warmup);
+	FParse::Value(*Command, TEXT("Frames="), Frames);
+
+	UClass* TargetClass = ParseTargetClass(Command);
+	if (World == nullptr || TargetClass == nullptr)
+	{
+		UE_LOG(LogTargetingBenchmark, Error, TEXT("Targeting.Benchmark.Tick: invalid world or Class."));
+		return;
+	}
+
+	GTargetingTickRun = MakeUnique<FTickRun>(World, TargetClass, FMath::Max(1, Count), FMath::Max(0, Warmup), FMath::Max(1, Frames));
+}
+
+FTargetingBenchmark::FTickRun::FTickRun(UWorld* InWorld, UClass* InTargetClass, int32 InCount, int32 InWarmup, int32 InFrames)
+	: World(InWorld)
+	, TargetClass(InTargetClass)
+	, Count(InCount)
+	, Warmup(InWarmup)
+	, Frames(InFrames)
+{
+	Csv = TEXT("Mode,Targets,Frames,MeanMs,P50Ms,P90Ms,P99Ms,MaxMs\n");
+	FrameTimings.Reserve(Frames);
+
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FTickRun::TickRun));
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddRaw(this, &FTickRun::OnBeginFrame);
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FTickRun::OnEndFrame);
+
+	SpawnTargets();
+}
+
+FTargetingBenchmark::FTickRun::~FTickRun()
+{
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+
+	DestroyTargets();
+}
+
+void FTargetingBenchmark::FTickRun::SpawnTargets()
+{
+	UWorld* TargetWorld = World.Get();
+	if (TargetWorld == nullptr)
+		return;
+
+	const ACharacter* Player = UGameplayStatics::GetPlayerCharacter(TargetWorld, 0);
+	const FVector Center = Player ? Player->GetActorLocation() : FVector::ZeroVector;
+
+	TArray<FVector> Locations;
+	GenerateLayout(ELayout::Disk, Count, Center, 10000.f, Locations);
+
+	Targets.Reset(Count);
+	for (const FVector& Location : Locations)
+	{
+		const FTransform Transform(Location);
+		AActor* Target = TargetWorld->SpawnActorDeferred<AActor>(TargetClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+		if (Target == nullptr)
+			continue;
+
+		if (Mode == EMode::ActorTick)
+		{
+			Target->PrimaryActorTick.bCanEverTick = true;
+			Target->PrimaryActorTick.bStartWithTickEnabled = true;
+		}
+
+		Target->FinishSpawning(Transform);
+		Targets.Add(Target);
+	}
+}
+
+void FTargetingBenchmark::FTickRun::DestroyTargets()
+{
+	for (const TWeakObjectPtr<AActor>& Target : Targets)
+	{
+		if (Target.IsValid())
+		{
+			Target->Destroy();
+		}
+	}
+	Targets.Reset();
+}
+
+bool FTargetingBenchmark::FTickRun::TickRun(float DeltaTime)
+{
+	if (!World.IsValid())
+	{
+		UE_LOG(LogTargetingBenchmark, Error, TEXT("Targeting.Benchmark.Tick: world went away, run aborted."));
+		GTargetingTickRun.Reset();
+		return false;
+	}
+
+	if (FrameTimings.Num() < Frames)
+		return true;
+
+	Report(Mode == EMode::ActorTick ? TEXT("ActorTick") : TEXT("Batched"), FrameTimings);
+	FrameTimings.Reset();
+	Frame = 0;
+
+	DestroyTargets();
+	Mode = EMode(uint8(Mode) + 1);
+
+	if (Mode == EMode::Done)
+	{
+		WriteCsv(Csv, TEXT("TargetingTickBenchmark"));
+		GTargetingTickRun.Reset();
+		return false;
+	}
+
+	SpawnTargets();
+	return true;
+}
+
+void FTargetingBenchmark::FTickRun::OnBeginFrame()
+{
+	FrameStartCycles = FPlatformTime::Cycles64();
+}
+
+void FTargetingBenchmark::FTickRun::OnEndFrame()
+{
+	if (FrameStartCycles == 0 || Frame++ < Warmup || FrameTimings.Num() >= Frames)
+		return;
+
+	FrameTimings.Add(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - FrameStartCycles));
+}
+
+void FTargetingBenchmark::FTickRun::Report(const TCHAR* ModeName, TArray<double>& Timings)
+{
+	Timings.Sort();
+
+	double Total = 0.0;
+	for (double Timing : Timings)
+	{
+		Total += Timing;
+	}
+
+	const double P50 = FProfilingReport::Percentile(Timings, 0.5);
+	const double P99 = FProfilingReport::Percentile(Timings, 0.99);
+
+	Csv += FString::Printf(TEXT("%s,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f\n"),
+		ModeName, Count, Timings.Num(), Total / Timings.Num(), P50, FProfilingReport::Percentile(Timings, 0.9), P99, Timings.Last());
+
+	UE_LOG(LogTargetingBenchmark, Log, TEXT("%-10s %7d targets: mean %.3fms p50 %.3fms p99 %.3fms"), ModeName, Count, Total / Timings.Num(), P50, P99);
+}
+
+#endif // !UE_BUILD_SHIPPING
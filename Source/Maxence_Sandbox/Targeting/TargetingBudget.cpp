@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetingBudget.h"
+#include "TargetingStats.h"
+
+#include <HAL/IConsoleManager.h>
+#include <HAL/PlatformTime.h>
+#include <Misc/CoreDelegates.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogTargetingBudget, Log, All);
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Budget level"), STAT_TargetingBudgetLevel, STATGROUP_Targeting);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Budget degradations"), STAT_TargetingBudgetDegradations, STATGROUP_Targeting);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Targeting frame time (ms)"), STAT_TargetingBudgetFrameMs, STATGROUP_Targeting);
+
+static TAutoConsoleVariable<float> CVarTargetingBudgetMs(
+	TEXT("Targeting.Budget.Ms"),
+	1.f,
+	TEXT("Targeting time per frame in milliseconds above which targeting degrades. 0 disables the governor."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarTargetingBudgetMaxLevel(
+	TEXT("Targeting.Budget.MaxLevel"),
+	3,
+	TEXT("Highest degradation level. Each level halves the visibility refresh traces and the angular ring sort rate."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarTargetingBudgetMaxCandidates(
+	TEXT("Targeting.Budget.MaxCandidates"),
+	32,
+	TEXT("Closest candidates a camera keeps from degradation level 2, halved on each level above."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarTargetingBudgetHeadroomRatio(
+	TEXT("Targeting.Budget.HeadroomRatio"),
+	0.6f,
+	TEXT("Fraction of the budget the targeting time has to stay under before the degradation level steps down."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarTargetingBudgetDegradeFrames(
+	TEXT("Targeting.Budget.DegradeFrames"),
+	5,
+	TEXT("Consecutive frames over budget before the degradation level steps up."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTargetingBudgetRestoreFrames(
+	TEXT("Targeting.Budget.RestoreFrames"),
+	60,
+	TEXT("Consecutive frames with headroom before the degradation level steps down."),
+	ECVF_Default);
+
+/** Degradation level from which the cameras cap their candidates. */
+static constexpr int32 CandidateCapLevel = 2;
+
+uint32 FTargetingBudget::FrameCycles = 0;
+int32 FTargetingBudget::ScopeDepth = 0;
+int32 FTargetingBudget::Level = 0;
+int32 FTargetingBudget::OverBudgetFrames = 0;
+int32 FTargetingBudget::UnderBudgetFrames = 0;
+int32 FTargetingBudget::Users = 0;
+FDelegateHandle FTargetingBudget::EndFrameHandle;
+
+FTargetingBudget::FScope::FScope()
+	: StartCycles(ScopeDepth++ == 0 ? FPlatformTime::Cycles() : 0)
+{
+}
+
+FTargetingBudget::FScope::~FScope()
+{
+	if (--ScopeDepth == 0)
+	{
+		FrameCycles += FPlatformTime::Cycles() - StartCycles;
+	}
+}
+
+void FTargetingBudget::AddUser()
+{
+	check(IsInGameThread());
+
+	if (Users++ == 0)
+	{
+		EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FTargetingBudget::EndFrame);
+	}
+}
+
+void FTargetingBudget::RemoveUser()
+{
+	check(IsInGameThread() && Users > 0);
+
+	if (--Users == 0)
+	{
+		FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+		EndFrameHandle.Reset();
+		Reset();
+	}
+}
+
+void FTargetingBudget::EndFrame()
+{
+	check(IsInGameThread());
+
+	const float FrameMs = float(FrameCycles * FPlatformTime::GetSecondsPerCycle() * 1000.0);
+	FrameCycles = 0;
+
+	SET_FLOAT_STAT(STAT_TargetingBudgetFrameMs, FrameMs);
+	CSV_CUSTOM_STAT(DynamicCamera, TargetingMs, FrameMs, ECsvCustomStatOp::Set);
+
+	const float BudgetMs = CVarTargetingBudgetMs.GetValueOnGameThread();
+	const int32 MaxLevel = BudgetMs > 0.f ? FMath::Max(0, CVarTargetingBudgetMaxLevel.GetValueOnGameThread()) : 0;
+
+	if (Level > MaxLevel)
+	{
+		SetLevel(MaxLevel, FrameMs, BudgetMs);
+	}
+	else if (FrameMs > BudgetMs && Level < MaxLevel)
+	{
+		UnderBudgetFrames = 0;
+		if (++OverBudgetFrames >= CVarTargetingBudgetDegradeFrames.GetValueOnGameThread())
+		{
+			SetLevel(Level + 1, FrameMs, BudgetMs);
+		}
+	}
+	else if (FrameMs < BudgetMs * CVarTargetingBudgetHeadroomRatio.GetValueOnGameThread() && Level > 0)
+	{
+		OverBudgetFrames = 0;
+		if (++UnderBudgetFrames >= CVarTargetingBudgetRestoreFrames.GetValueOnGameThread())
+		{
+			SetLevel(Level - 1, FrameMs, BudgetMs);
+		}
+	}
+	else
+	{
+		// Between the thresholds: the level holds.
+		OverBudgetFrames = 0;
+		UnderBudgetFrames = 0;
+	}
+
+	CSV_CUSTOM_STAT(DynamicCamera, BudgetLevel, Level, ECsvCustomStatOp::Set);
+}
+
+void FTargetingBudget::SetLevel(int32 NewLevel, float FrameMs, float BudgetMs)
+{
+	if (NewLevel > Level)
+	{
+		INC_DWORD_STAT(STAT_TargetingBudgetDegradations);
+		UE_LOG(LogTargetingBudget, Log, TEXT("Targeting over budget (%.2fms for %.2fms): degraded to level %d"), FrameMs, BudgetMs, NewLevel);
+	}
+	else
+	{
+		UE_LOG(LogTargetingBudget, Log, TEXT("Targeting back under budget (%.2fms for %.2fms): restored to level %d"), FrameMs, BudgetMs, NewLevel);
+	}
+
+	Level = NewLevel;
+	OverBudgetFrames = 0;
+	UnderBudgetFrames = 0;
+	SET_DWORD_STAT(STAT_TargetingBudgetLevel, Level);
+}
+
+int32 FTargetingBudget::GetTracesPerFrame(int32 Traces)
+{
+	return Traces > 0 ? FMath::Max(1, Traces >> Level) : 0;
+}
+
+int32 FTargetingBudget::GetMaxCandidates()
+{
+	if (Level < CandidateCapLevel)
+		return 0;
+
+	return FMath::Max(1, CVarTargetingBudgetMaxCandidates.GetValueOnGameThread() >> (Level - CandidateCapLevel));
+}
+
+bool FTargetingBudget::ShouldSortRing(uint64 Frame)
+{
+	return (Frame & ((uint64(1) << Level) - 1)) == 0;
+}
+
+void FTargetingBudget::Reset()
+{
+	FrameCycles = 0;
+	Level = 0;
+	OverBudgetFrames = 0;
+	UnderBudgetFrames = 0;
+	SET_DWORD_STAT(STAT_TargetingBudgetLevel, 0);
+}
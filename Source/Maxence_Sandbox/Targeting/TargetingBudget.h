@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Frame budget governor of the targeting work: camera gathers, visibility refreshes, angular ring sorts, lock and
+ * navigation selections and the batched target tick time themselves with FScope. The frame closes once per engine frame on FCoreDelegates::OnEndFrame,
+ * however many game instances run targeting (e.g. a PIE session with several clients).
+ *
+ * After Targeting.Budget.DegradeFrames frames over Targeting.Budget.Ms, the governor raises its degradation level:
+ * each level halves the visibility refresh traces and the angular ring sort rate, and from level 2 on the cameras
+ * only keep their Targeting.Budget.MaxCandidates closest candidates. It steps back down after
+ * Targeting.Budget.RestoreFrames frames under Targeting.Budget.HeadroomRatio of the budget.
+ * Every level change is logged and the level is in "stat Targeting" and in the DynamicCamera CSV stats.
+ */
+class MAXENCE_SANDBOX_API FTargetingBudget
+{
+public:
+	/** Adds the time spent in its scope to the current frame. Nested scopes count once, through the outermost one. */
+	struct MAXENCE_SANDBOX_API FScope
+	{
+		FScope();
+		~FScope();
+
+	private:
+		uint32 StartCycles;
+	};
+
+	/// Closes the budget frames while at least one targeting subsystem is alive. Called by the targeting subsystems.
+	static void AddUser();
+	static void RemoveUser();
+
+	/// Current degradation level, 0 when within budget or when Targeting.Budget.Ms is 0.
+	static int32 GetLevel() { return Level; }
+
+	/// Visibility refresh traces allowed this frame out of Traces.
+	static int32 GetTracesPerFrame(int32 Traces);
+
+	/// Candidates a camera keeps after a gather, 0 when unlimited.
+	static int32 GetMaxCandidates();
+
+	/// Whether the angular rings should be sorted on Frame.
+	static bool ShouldSortRing(uint64 Frame);
+
+	/// Back to level 0, e.g. between benchmark runs.
+	static void Reset();
+
+private:
+	/// Compares the targeting time of the frame with the budget, moves the degradation level and starts a new frame.
+	static void EndFrame();
+
+	static void SetLevel(int32 NewLevel, float FrameMs, float BudgetMs);
+
+	static uint32 FrameCycles;
+	static int32 ScopeDepth;
+	static int32 Level;
+	static int32 OverBudgetFrames;
+	static int32 UnderBudgetFrames;
+
+	static int32 Users;
+	static FDelegateHandle EndFrameHandle;
+};
@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include <Containers/Ticker.h>
+#include <Engine/NetConnection.h>
+#include <Engine/NetDriver.h>
+#include <Engine/World.h>
+#include <EngineUtils.h>
+#include <GameFramework/Pawn.h>
+#include <HAL/IConsoleManager.h>
+
+#include <Characters/Components/DynamicCameraComponent.h>
+#include <Profiling/ProfilingReport.h>
+
+DEFINE_LOG_CATEGORY_STATIC(LogTargetingNet, Log, All);
+
+/**
+ * Network cost of the lock-on replication, per client connection. Runnable headless, one server and N clients:
+ *   UE4Editor Maxence_Sandbox <Map>?listen -server -nullrhi -log -ExecCmds="Targeting.NetReport Interval=1 Samples=60"
+ *   UE4Editor Maxence_Sandbox 127.0.0.1 -game -nullrhi -unattended (once per client)
+ * or from a PIE session with several clients and "Run Dedicated Server". Every Interval seconds, logs the bytes per
+ * second each connection sends and receives and the cameras currently locked, and after Samples reports writes
+ * the averages to Saved/Profiling/TargetingNet.
+ */
+class FTargetingNetReport
+{
+public:
+	static void Run(const TArray<FString>& Args, UWorld* World);
+
+private:
+	struct FConnectionTotals
+	{
+		int64 OutBytesPerSecond = 0;
+		int64 InBytesPerSecond = 0;
+		int32 Samples = 0;
+	};
+
+	bool Tick(float DeltaTime);
+
+	/// Logs one report of World and accumulates it.
+	void Report(UWorld* World);
+
+	void WriteCsv() const;
+
+	TWeakObjectPtr<UWorld> World;
+	int32 SamplesLeft = 0;
+	TMap<FString, FConnectionTotals> Totals;
+	FDelegateHandle TickHandle;
+
+	static TUniquePtr<FTargetingNetReport> Current;
+};
+
+TUniquePtr<FTargetingNetReport> FTargetingNetReport::Current;
+
+static FAutoConsoleCommandWithWorldAndArgs GTargetingNetReportCommand(
+	TEXT("Targeting.NetReport"),
+	TEXT("Logs the bytes per second of every client connection and the locked cameras.\n")
+	TEXT("Interval=<seconds> Samples=<reports>: reports periodically and writes the averages to Saved/Profiling/TargetingNet. Interval=0 stops."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&FTargetingNetReport::Run));
+
+void FTargetingNetReport::Run(const TArray<FString>& Args, UWorld* InWorld)
+{
+	const FString Command = FString::Join(Args, TEXT(" "));
+
+	float Interval = 0.f;
+	int32 Samples = 0;
+	FParse::Value(*Command, TEXT("Interval="), Interval);
+	FParse::Value(*Command, TEXT("Samples="), Samples);
+
+	if (Current.IsValid())
+	{
+		FTicker::GetCoreTicker().RemoveTicker(Current->TickHandle);
+		Current->WriteCsv();
+		Current.Reset();
+	}
+
+	if (Interval <= 0.f)
+	{
+		FTargetingNetReport Report;
+		Report.Report(InWorld);
+		return;
+	}
+
+	Current = MakeUnique<FTargetingNetReport>();
+	Current->World = InWorld;
+	Current->SamplesLeft = Samples > 0 ? Samples : MAX_int32;
+	Current->TickHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(Current.Get(), &FTargetingNetReport::Tick), Interval);
+}
+
+bool FTargetingNetReport::Tick(float DeltaTime)
+{
+	if (!World.IsValid() || SamplesLeft-- <= 0)
+	{
+		WriteCsv();
+		Current.Reset();
+		return false;
+	}
+
+	Report(World.Get());
+	return true;
+}
+
+void FTargetingNetReport::Report(UWorld* InWorld)
+{
+	UNetDriver* NetDriver = InWorld ? InWorld->GetNetDriver() : nullptr;
+	if (NetDriver == nullptr)
+	{
+		UE_LOG(LogTargetingNet, Warning, TEXT("Targeting.NetReport: not a network game."));
+		return;
+	}
+
+	int32 Cameras = 0;
+	int32 LockedCameras = 0;
+	for (TActorIterator<APawn> It(InWorld); It; ++It)
+	{
+		if (const UDynamicCameraComponent* Camera = It->FindComponentByClass<UDynamicCameraComponent>())
+		{
+			++Cameras;
+			LockedCameras += Camera->GetReplicatedLockState().Target != nullptr;
+		}
+	}
+
+	UE_LOG(LogTargetingNet, Log, TEXT("%d cameras, %d locked"), Cameras, LockedCameras);
+
+	TArray<UNetConnection*> Connections = NetDriver->ClientConnections;
+	if (NetDriver->ServerConnection)
+	{
+		Connections.Add(NetDriver->ServerConnection);
+	}
+
+	for (UNetConnection* Connection : Connections)
+	{
+		const FString Name = Connection->LowLevelGetRemoteAddress(true);
+		UE_LOG(LogTargetingNet, Log, TEXT("%-24s out %6d B/s in %6d B/s"), *Name, Connection->OutBytesPerSecond, Connection->InBytesPerSecond);
+
+		FConnectionTotals& ConnectionTotals = Totals.FindOrAdd(Name);
+		ConnectionTotals.OutBytesPerSecond += Connection->OutBytesPerSecond;
+		ConnectionTotals.InBytesPerSecond += Connection->InBytesPerSecond;
+		++ConnectionTotals.Samples;
+	}
+}
+
+void FTargetingNetReport::WriteCsv() const
+{
+	if (Totals.Num() == 0)
+		return;
+
+	FString Csv = TEXT("Connection,Samples,OutBytesPerSecond,InBytesPerSecond\n");
+	for (const TPair<FString, FConnectionTotals>& Pair : Totals)
+	{
+		const FConnectionTotals& ConnectionTotals = Pair.Value;
+		Csv += FString::Printf(TEXT("%s,%d,%.1f,%.1f\n"), *Pair.Key, ConnectionTotals.Samples,
+			double(ConnectionTotals.OutBytesPerSecond) / ConnectionTotals.Samples, double(ConnectionTotals.InBytesPerSecond) / ConnectionTotals.Samples);
+	}
+
+	FProfilingReport::WriteCsv(Csv, TEXT("TargetingNet"), TEXT("TargetingNet"));
+}
+
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetingSharedViews.h"
+#include "TargetingStats.h"
+#include "TargetingSubsystem.h"
+
+#include <GameFramework/Actor.h>
+#include <HAL/IConsoleManager.h>
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared view queries"), STAT_TargetingSharedViewQueries, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Shared view hits"), STAT_TargetingSharedViewHits, STATGROUP_Targeting);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shared views"), STAT_TargetingSharedViews, STATGROUP_Targeting);
+
+static TAutoConsoleVariable<int32> CVarSharedViews(
+	TEXT("Targeting.SharedViews"),
+	1,
+	TEXT("1: cameras looking from the same place share their candidate gather and visibility cache (default).\n")
+	TEXT("0: every camera gathers and traces on its own."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarSharedViewsMergeDistance(
+	TEXT("Targeting.SharedViews.MergeDistance"),
+	50.f,
+	TEXT("Distance under which two camera eyes share a view. Keep it under Targeting.VisibilityCache.MoveThreshold\n")
+	TEXT("so a shared visibility result is as valid as one traced from the camera itself."),
+	ECVF_Default);
+
+bool FTargetingSharedViews::IsEnabled()
+{
+	return CVarSharedViews.GetValueOnGameThread() != 0;
+}
+
+int32 FTargetingSharedViews::Gather(const UTargetingSubsystem& Subsystem, const FVector& Eye, const FVector& Center, float Radius, const AActor* Ignore, TArray<AActor*>& OutCandidates)
+{
+	Prune();
+
+	const uint64 Frame = GFrameCounter;
+	const float MergeDistance = CVarSharedViewsMergeDistance.GetValueOnGameThread();
+
+	FView* View = nullptr;
+	for (const TUniquePtr<FView>& Candidate : Views)
+	{
+		if (FVector::DistSquared(Candidate->Eye, Eye) <= MergeDistance * MergeDistance)
+		{
+			View = Candidate.Get();
+			break;
+		}
+	}
+
+	if (View == nullptr)
+	{
+		View = Views.Add_GetRef(MakeUnique<FView>()).Get();
+		View->Id = NextViewId++;
+		View->GatherFrame = 0;
+		View->VisibilityFrame = 0;
+	}
+
+	// The view query covers this camera range when its sphere contains it, otherwise it is gathered again, wider.
+	const bool bCovered = View->GatherFrame == Frame
+		&& FVector::Dist(View->Center, Center) + Radius <= View->Radius;
+
+	if (bCovered)
+	{
+		INC_DWORD_STAT(STAT_TargetingSharedViewHits);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_TargetingSharedViewQueries);
+
+		// A margin of one merge distance lets the next cameras of the view reuse the query.
+		const float ViewRadius = View->GatherFrame == Frame
+			? FMath::Max(View->Radius, FVector::Dist(View->Center, Center) + Radius)
+			: Radius + MergeDistance;
+
+		if (View->GatherFrame != Frame)
+		{
+			View->Eye = Eye;
+			View->Center = Center;
+		}
+		View->Radius = ViewRadius;
+		View->GatherFrame = Frame;
+
+		View->Candidates.Reset();
+		Subsystem.QueryRadius(View->Center, View->Radius, View->Candidates);
+	}
+
+	const float RadiusSquared = Radius * Radius;
+	OutCandidates.Reset();
+	for (AActor* Candidate : View->Candidates)
+	{
+		if (Candidate != Ignore && FVector::DistSquared(Candidate->GetActorLocation(), Center) <= RadiusSquared)
+		{
+			OutCandidates.Add(Candidate);
+		}
+	}
+
+	return View->Id;
+}
+
+FTargetVisibilityCache* FTargetingSharedViews::UpdateVisibility(int32 ViewId, UWorld* World)
+{
+	FView* View = FindView(ViewId);
+	if (View == nullptr)
+		return nullptr;
+
+	// Every candidate of the view is kept up to date, whichever camera asks first.
+	if (View->VisibilityFrame != GFrameCounter)
+	{
+		View->VisibilityFrame = GFrameCounter;
+		View->Visibility.Update(World, View->Eye, View->Candidates);
+	}
+
+	return &View->Visibility;
+}
+
+FTargetVisibilityCache* FTargetingSharedViews::FindVisibility(int32 ViewId)
+{
+	FView* View = FindView(ViewId);
+	return View ? &View->Visibility : nullptr;
+}
+
+void FTargetingSharedViews::Reset()
+{
+	Views.Reset();
+	PruneFrame = 0;
+}
+
+FTargetingSharedViews::FView* FTargetingSharedViews::FindView(int32 ViewId)
+{
+	for (const TUniquePtr<FView>& View : Views)
+	{
+		if (View->Id == ViewId)
+			return View.Get();
+	}
+	return nullptr;
+}
+
+void FTargetingSharedViews::Prune()
+{
+	const uint64 Frame = GFrameCounter;
+	if (PruneFrame == Frame)
+		return;
+
+	PruneFrame = Frame;
+
+	Views.RemoveAllSwap([Frame](const TUniquePtr<FView>& View) { return View->GatherFrame + 1 < Frame; });
+
+	SET_DWORD_STAT(STAT_TargetingSharedViews, Views.Num());
+}
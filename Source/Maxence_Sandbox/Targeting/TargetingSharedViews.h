@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TargetVisibilityCache.h"
+
+class AActor;
+class UWorld;
+class UTargetingSubsystem;
+
+/**
+ * Candidate gather and visibility cache shared by the cameras of a world.
+ * Cameras whose eyes are within Targeting.SharedViews.MergeDistance of each other (split-screen players standing
+ * together, spectators and bots following a player) look from the same view: the view runs one spatial query
+ * and keeps one visibility cache per frame, and each camera only filters the view candidates against its own range.
+ * Views nobody gathered from during the last frame are dropped.
+ */
+class MAXENCE_SANDBOX_API FTargetingSharedViews
+{
+public:
+	/// Whether cameras gather through shared views (Targeting.SharedViews).
+	static bool IsEnabled();
+
+	/// Gathers the targets within Radius of Center, Ignore excepted, through the view Eye looks from.
+	/// <returns>Id of the view, to access its visibility cache.</returns>
+	int32 Gather(const UTargetingSubsystem& Subsystem, const FVector& Eye, const FVector& Center, float Radius, const AActor* Ignore, TArray<AActor*>& OutCandidates);
+
+	/// Visibility cache of the view, refreshed at most once per frame. nullptr if the view was dropped.
+	FTargetVisibilityCache* UpdateVisibility(int32 ViewId, UWorld* World);
+
+	/// Visibility cache of the view, nullptr if the view was dropped.
+	FTargetVisibilityCache* FindVisibility(int32 ViewId);
+
+	int32 Num() const { return Views.Num(); }
+
+	void Reset();
+
+private:
+	struct FView
+	{
+		int32 Id;
+		FVector Eye;
+		FVector Center;
+		float Radius;
+		uint64 GatherFrame;
+		uint64 VisibilityFrame;
+		TArray<AActor*> Candidates;
+		FTargetVisibilityCache Visibility;
+	};
+
+	FView* FindView(int32 ViewId);
+
+	/// Drops the views that were not gathered from during the last frame.
+	void Prune();
+
+	/// Owned views: their caches keep pending async traces and must not move.
+	TArray<TUniquePtr<FView>> Views;
+
+	int32 NextViewId = 0;
+	uint64 PruneFrame = 0;
+};
@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetingStats.h"
+
+#include <HAL/IConsoleManager.h>
+
+DEFINE_STAT(STAT_TargetingVisibilityTraces);
+
+CSV_DEFINE_CATEGORY(DynamicCamera, true);
+
+#if DYNAMIC_CAMERA_PROFILING
+
+int32 GDynamicCameraNamedEvents = 0;
+
+static FAutoConsoleVariableRef CVarDynamicCameraNamedEvents(
+	TEXT("DynamicCamera.NamedEvents"),
+	GDynamicCameraNamedEvents,
+	TEXT("1: camera and targeting scopes emit platform named events for external profilers."),
+	ECVF_Default);
+
+#endif
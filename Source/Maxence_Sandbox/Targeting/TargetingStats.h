@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/** Camera and targeting instrumentation. Stats and CSV stats are already off in Shipping, named events follow. */
+#define DYNAMIC_CAMERA_PROFILING (!UE_BUILD_SHIPPING)
+
+/** Camera entry points, displayed with "stat DynamicCamera". */
+DECLARE_STATS_GROUP(TEXT("DynamicCamera"), STATGROUP_DynamicCamera, STATCAT_Advanced);
+
+/** Targeting internals, displayed with "stat Targeting". */
+DECLARE_STATS_GROUP(TEXT("Targeting"), STATGROUP_Targeting, STATCAT_Advanced);
+
+/** Visibility traces issued this frame, synchronous and batched. */
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Visibility traces"), STAT_TargetingVisibilityTraces, STATGROUP_Targeting, MAXENCE_SANDBOX_API);
+
+/** Candidate count, traces issued, sort time and state transitions, captured with "csvprofile start". */
+CSV_DECLARE_CATEGORY_EXTERN(DynamicCamera);
+
+#if DYNAMIC_CAMERA_PROFILING
+
+/** Whether camera scopes emit platform named events (DynamicCamera.NamedEvents). */
+extern MAXENCE_SANDBOX_API int32 GDynamicCameraNamedEvents;
+
+/** Platform named event (PIX, Razor, VTune...) for the duration of a camera scope, when the channel is enabled. */
+struct FDynamicCameraNamedEvent
+{
+	explicit FDynamicCameraNamedEvent(const TCHAR* Name)
+		: bEmitted(GDynamicCameraNamedEvents != 0)
+	{
+		if (bEmitted)
+		{
+			FPlatformMisc::BeginNamedEvent(FColor(255, 160, 0), Name);
+		}
+	}
+
+	~FDynamicCameraNamedEvent()
+	{
+		if (bEmitted)
+		{
+			FPlatformMisc::EndNamedEvent();
+		}
+	}
+
+private:
+	bool bEmitted;
+};
+
+/** Cycle counter and named event for a camera scope. */
+#define DYNAMIC_CAMERA_SCOPE(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	FDynamicCameraNamedEvent ANONYMOUS_VARIABLE(DynamicCameraNamedEvent)(TEXT(#Stat))
+
+#else
+
+#define DYNAMIC_CAMERA_SCOPE(Stat)
+
+#endif
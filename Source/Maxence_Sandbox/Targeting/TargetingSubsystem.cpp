@@ -0,0 +1,677 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TargetingSubsystem.h"
+#include "TargetingStats.h"
+#include "TargetingBudget.h"
+#include "SandboxSubsystems.h"
+#include "Characters/Interfaces/Targetable.h"
+#include "Characters/Components/DynamicCameraComponent.h"
+#include "Characters/Components/TargetableComponent.h"
+
+#include <Async/ParallelFor.h>
+#include <Engine/Engine.h>
+#include <Engine/World.h>
+#include <Engine/GameInstance.h>
+#include <GameFramework/Actor.h>
+#include <GameFramework/PlayerController.h>
+#include <Camera/PlayerCameraManager.h>
+#include <HAL/IConsoleManager.h>
+
+static TAutoConsoleVariable<int32> CVarTargetingUseSpatialIndex(
+	TEXT("Targeting.UseSpatialIndex"),
+	1,
+	TEXT("1: cameras gather targets from the targeting spatial index (default).\n")
+	TEXT("0: cameras fall back to their overlap range sphere (A/B timing)."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTargetingBatchedTickParallelThreshold(
+	TEXT("Targeting.BatchedTick.ParallelThreshold"),
+	1024,
+	TEXT("Target count from which the batched target tick is split across worker threads."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTargetingSignificance(
+	TEXT("Targeting.Significance"),
+	1,
+	TEXT("1: targets update rates follow their significance (default).\n")
+	TEXT("0: every target updates at full rate."),
+	ECVF_Scalability);
+
+DECLARE_CYCLE_STAT(TEXT("Batched target tick"), STAT_TargetingBatchedTick, STATGROUP_Targeting);
+DECLARE_CYCLE_STAT(TEXT("Apply significance"), STAT_TargetingApplySignificance, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Significance changes"), STAT_TargetingSignificanceChanges, STATGROUP_Targeting);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Batched targets"), STAT_TargetingBatchedTargets, STATGROUP_Targeting);
+
+constexpr uint8 UTargetingSubsystem::UnknownSignificanceLevel;
+
+int32 UTargetingSubsystem::FTargetSlots::Add(AActor* Actor, const FVector& AimOffset)
+{
+	Targetables.Add(nullptr);
+	Roots.Add(Actor->GetRootComponent());
+	AimComponents.Add(nullptr);
+	AimSockets.Add(NAME_None);
+	AimOffsets.Add(AimOffset);
+	Priorities.Add(1.f);
+	AimPoints.Add(Actor->GetActorTransform().TransformPosition(AimOffset));
+	LockHighlights.Add(0.f);
+	Locked.Add(false);
+	LastLockTimes.Add(-MAX_dbl);
+	SignificanceReceivers.Add(Cast<ITargetable>(Actor));
+	SignificanceLevels.Add(UnknownSignificanceLevel);
+	SignificanceFlags.Add(0);
+	NewSignificanceLevels.Add(UnknownSignificanceLevel);
+	return Actors.Add(Actor);
+}
+
+void UTargetingSubsystem::FTargetSlots::SetTargetable(int32 Slot, UTargetableComponent* Targetable)
+{
+	Targetables[Slot] = Targetable;
+	AimComponents[Slot] = Targetable->GetAimComponent();
+	AimSockets[Slot] = Targetable->AimSocket;
+	AimOffsets[Slot] = Targetable->AimOffset;
+	Priorities[Slot] = Targetable->Priority;
+
+	if (AimComponents[Slot])
+	{
+		AimPoints[Slot] = AimComponents[Slot]->GetSocketLocation(AimSockets[Slot]);
+	}
+}
+
+void UTargetingSubsystem::FTargetSlots::RemoveAtSwap(int32 Slot)
+{
+	Actors.RemoveAtSwap(Slot, 1, false);
+	Targetables.RemoveAtSwap(Slot, 1, false);
+	Roots.RemoveAtSwap(Slot, 1, false);
+	AimComponents.RemoveAtSwap(Slot, 1, false);
+	AimSockets.RemoveAtSwap(Slot, 1, false);
+	AimOffsets.RemoveAtSwap(Slot, 1, false);
+	Priorities.RemoveAtSwap(Slot, 1, false);
+	AimPoints.RemoveAtSwap(Slot, 1, false);
+	LockHighlights.RemoveAtSwap(Slot, 1, false);
+	Locked.RemoveAtSwap(Slot, 1, false);
+	LastLockTimes.RemoveAtSwap(Slot, 1, false);
+	SignificanceReceivers.RemoveAtSwap(Slot, 1, false);
+	SignificanceLevels.RemoveAtSwap(Slot, 1, false);
+	SignificanceFlags.RemoveAtSwap(Slot, 1, false);
+	NewSignificanceLevels.RemoveAtSwap(Slot, 1, false);
+}
+
+void UTargetingSubsystem::FTargetSlots::Empty()
+{
+	Actors.Empty();
+	Targetables.Empty();
+	Roots.Empty();
+	AimComponents.Empty();
+	AimSockets.Empty();
+	AimOffsets.Empty();
+	Priorities.Empty();
+	AimPoints.Empty();
+	LockHighlights.Empty();
+	Locked.Empty();
+	LastLockTimes.Empty();
+	SignificanceReceivers.Empty();
+	SignificanceLevels.Empty();
+	SignificanceFlags.Empty();
+	NewSignificanceLevels.Empty();
+}
+
+UTargetingSubsystem* UTargetingSubsystem::Get(const UObject* WorldContextObject)
+{
+	return GetGameInstanceSubsystem<UTargetingSubsystem>(WorldContextObject);
+}
+
+bool UTargetingSubsystem::IsSpatialIndexEnabled()
+{
+	return CVarTargetingUseSpatialIndex.GetValueOnGameThread() != 0;
+}
+
+void UTargetingSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	FTargetingBudget::AddUser();
+}
+
+void UTargetingSubsystem::Deinitialize()
+{
+	FTargetingBudget::RemoveUser();
+
+	for (const TPair<AActor*, FTargetEntry>& Pair : Targets)
+	{
+		if (IsValid(Pair.Key) && Pair.Key->GetRootComponent())
+		{
+			Pair.Key->GetRootComponent()->TransformUpdated.Remove(Pair.Value.MovedHandle);
+		}
+		if (IsValid(Pair.Key))
+		{
+			Pair.Key->OnEndPlay.RemoveDynamic(this, &UTargetingSubsystem::OnTargetEndPlay);
+		}
+	}
+
+	Targets.Empty();
+	Handles.Empty();
+	FreeHandles.Empty();
+	Cells.Empty();
+	Slots.Empty();
+	Cameras.Empty();
+	SharedViews.Reset();
+	VisibilityTable.Unload();
+	VisibilityTableMap.Reset();
+	VisibilityTableWorld.Reset();
+
+	Super::Deinitialize();
+}
+
+const FTargetVisibilityTable* UTargetingSubsystem::GetVisibilityTable()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || FTargetVisibilityTable::GetUsage() == FTargetVisibilityTable::EUsage::Off)
+		return nullptr;
+
+	// The game instance keeps the subsystem across map changes.
+	if (World != VisibilityTableWorld.Get())
+	{
+		VisibilityTableWorld = World;
+
+		const FString MapName = UWorld::RemovePIEPrefix(World->GetOutermost()->GetName());
+		if (MapName != VisibilityTableMap)
+		{
+			VisibilityTableMap = MapName;
+			VisibilityTable.Load(FTargetVisibilityTable::GetPath(MapName));
+		}
+	}
+
+	return VisibilityTable.IsLoaded() ? &VisibilityTable : nullptr;
+}
+
+void UTargetingSubsystem::RegisterTarget(AActor* Target, FVector AimOffset)
+{
+	if (!IsValid(Target) || Targets.Contains(Target) || Target->GetRootComponent() == nullptr)
+		return;
+
+	const FVector Location = Target->GetActorLocation();
+
+	FTargetEntry& Entry = Targets.Add(Target);
+	Entry.Cell = GetCell(Location);
+	Entry.MovedHandle = Target->GetRootComponent()->TransformUpdated.AddUObject(this, &UTargetingSubsystem::OnTargetMoved);
+	Entry.Slot = Slots.Add(Target, AimOffset);
+	Entry.Handle = AllocateHandle(Target);
+
+	// Out of the index as soon as the actor goes away, whether destroyed or streamed out.
+	Target->OnEndPlay.AddUniqueDynamic(this, &UTargetingSubsystem::OnTargetEndPlay);
+
+	AddToCell(Entry.Cell, Target, Location);
+}
+
+void UTargetingSubsystem::RegisterTargetable(UTargetableComponent* Targetable)
+{
+	AActor* Target = Targetable->GetOwner();
+	RegisterTarget(Target, Targetable->AimOffset);
+
+	if (const FTargetEntry* Entry = Targets.Find(Target))
+	{
+		Slots.SetTargetable(Entry->Slot, Targetable);
+	}
+}
+
+void UTargetingSubsystem::UnregisterTarget(AActor* Target)
+{
+	FTargetEntry Entry;
+	if (!Targets.RemoveAndCopyValue(Target, Entry))
+		return;
+
+	if (Target->GetRootComponent())
+	{
+		Target->GetRootComponent()->TransformUpdated.Remove(Entry.MovedHandle);
+	}
+
+	RemoveFromCell(Entry.Cell, Target);
+
+	Slots.RemoveAtSwap(Entry.Slot);
+	if (Entry.Slot < Slots.Num())
+	{
+		Targets.FindChecked(Slots.Actors[Entry.Slot]).Slot = Entry.Slot;
+	}
+
+	Target->OnEndPlay.RemoveDynamic(this, &UTargetingSubsystem::OnTargetEndPlay);
+	ReleaseHandle(Entry.Handle);
+
+	OnTargetRemoved.Broadcast(Entry.Handle, Target);
+}
+
+void UTargetingSubsystem::OnTargetEndPlay(AActor* Target, EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterTarget(Target);
+}
+
+FTargetHandle UTargetingSubsystem::AllocateHandle(AActor* Target)
+{
+	uint32 Index;
+	if (FreeHandles.Num() > 0)
+	{
+		Index = FreeHandles.Pop(false);
+	}
+	else
+	{
+		Index = Handles.AddDefaulted();
+		check(Index <= FTargetHandle::IndexMask);
+	}
+
+	FHandleSlot& Slot = Handles[Index];
+	Slot.Actor = Target;
+	return FTargetHandle(Index, Slot.Generation);
+}
+
+void UTargetingSubsystem::ReleaseHandle(FTargetHandle Handle)
+{
+	FHandleSlot& Slot = Handles[Handle.GetIndex()];
+	Slot.Actor = nullptr;
+
+	// Wraps back to 1: a handle would have to be held across 4095 reuses of its slot to resolve again.
+	Slot.Generation = Slot.Generation < FTargetHandle::MaxGeneration ? Slot.Generation + 1 : 1;
+	FreeHandles.Add(Handle.GetIndex());
+}
+
+FTargetHandle UTargetingSubsystem::GetHandle(const AActor* Target) const
+{
+	const FTargetEntry* Entry = Targets.Find(Target);
+	return Entry ? Entry->Handle : FTargetHandle();
+}
+
+AActor* UTargetingSubsystem::Resolve(FTargetHandle Handle) const
+{
+	if (Handle.IsNull() || !Handles.IsValidIndex(Handle.GetIndex()))
+		return nullptr;
+
+	const FHandleSlot& Slot = Handles[Handle.GetIndex()];
+	return Slot.Generation == Handle.GetGeneration() ? Slot.Actor : nullptr;
+}
+
+bool UTargetingSubsystem::IsRegistered(const AActor* Target) const
+{
+	return Targets.Contains(Target);
+}
+
+UTargetableComponent* UTargetingSubsystem::GetTargetable(const AActor* Target) const
+{
+	const FTargetEntry* Entry = Targets.Find(Target);
+	return Entry ? Slots.Targetables[Entry->Slot] : nullptr;
+}
+
+FVector UTargetingSubsystem::GetAimPoint(const AActor* Target) const
+{
+	const FTargetEntry* Entry = Targets.Find(Target);
+	if (Entry == nullptr)
+		return Target->GetActorLocation();
+
+	return Slots.AimPoints[Entry->Slot];
+}
+
+void UTargetingSubsystem::SetTargetLocked(const AActor* Target, bool bLocked)
+{
+	if (const FTargetEntry* Entry = Targets.Find(Target))
+	{
+		Slots.Locked[Entry->Slot] = bLocked;
+
+		if (bLocked)
+		{
+			Slots.LastLockTimes[Entry->Slot] = GetGameInstance()->GetWorld()->GetTimeSeconds();
+		}
+	}
+}
+
+bool UTargetingSubsystem::GetScoringInputs(const AActor* Target, FVector& OutAimPoint, float& OutPriority, float& OutTimeSinceLocked) const
+{
+	const FTargetEntry* Entry = Targets.Find(Target);
+	if (Entry == nullptr)
+		return false;
+
+	OutAimPoint = Slots.AimPoints[Entry->Slot];
+	OutPriority = Slots.Priorities[Entry->Slot];
+	OutTimeSinceLocked = float(FMath::Min(GetGameInstance()->GetWorld()->GetTimeSeconds() - Slots.LastLockTimes[Entry->Slot], double(MAX_FLT)));
+	return true;
+}
+
+void UTargetingSubsystem::RegisterCamera(UDynamicCameraComponent* Camera)
+{
+	Cameras.AddUnique(Camera);
+}
+
+void UTargetingSubsystem::UnregisterCamera(UDynamicCameraComponent* Camera)
+{
+	Cameras.RemoveSwap(Camera);
+}
+
+float UTargetingSubsystem::GetLockHighlight(const AActor* Target) const
+{
+	const FTargetEntry* Entry = Targets.Find(Target);
+	return Entry ? Slots.LockHighlights[Entry->Slot] : 0.f;
+}
+
+void UTargetingSubsystem::Tick(float DeltaTime)
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetingBatchedTick);
+
+	FTargetingBudget::FScope BudgetScope;
+
+	const int32 NumSlots = Slots.Num();
+	INC_DWORD_STAT_BY(STAT_TargetingBatchedTargets, NumSlots);
+
+	const float HighlightStep = FMath::Clamp(DeltaTime * LockHighlightSpeed, 0.f, 1.f);
+
+	bool bSignificance = CVarTargetingSignificance.GetValueOnGameThread() != 0 && SignificanceLevels.Num() > 0;
+	TArray<FSignificanceView, TInlineAllocator<4>> Views;
+	if (bSignificance)
+	{
+		PrepareSignificance(Views);
+
+		// Without any view every target would score as out of sight and fall to the lowest level.
+		bSignificance = Views.Num() > 0;
+	}
+
+	if (!bSignificance && bSignificanceApplied)
+	{
+		ResetSignificance();
+	}
+
+	USceneComponent* const* Roots = Slots.Roots.GetData();
+	USceneComponent* const* AimComponents = Slots.AimComponents.GetData();
+	const FName* AimSockets = Slots.AimSockets.GetData();
+	const FVector* AimOffsets = Slots.AimOffsets.GetData();
+	FVector* AimPoints = Slots.AimPoints.GetData();
+	float* LockHighlights = Slots.LockHighlights.GetData();
+	const bool* Locked = Slots.Locked.GetData();
+	const uint8* SignificanceFlags = Slots.SignificanceFlags.GetData();
+	uint8* NewSignificanceLevels = Slots.NewSignificanceLevels.GetData();
+
+	const FSignificanceView* ViewData = Views.GetData();
+	const int32 NumViews = Views.Num();
+	const FTargetSignificanceWeights& Weights = SignificanceWeights;
+	const FTargetSignificanceLevel* Levels = SignificanceLevels.GetData();
+	const int32 NumLevels = SignificanceLevels.Num();
+
+	// Slots are independent: each iteration only reads its root and aim transforms and writes its own slot.
+	// Tickables run after the world tick groups, no animation evaluation writes the sockets meanwhile.
+	auto TickSlot = [=, &Weights](int32 Slot)
+	{
+		const FVector AimPoint = AimComponents[Slot]
+			? AimComponents[Slot]->GetSocketLocation(AimSockets[Slot])
+			: Roots[Slot]->GetComponentTransform().TransformPosition(AimOffsets[Slot]);
+		AimPoints[Slot] = AimPoint;
+		LockHighlights[Slot] = FMath::Clamp(LockHighlights[Slot] + (Locked[Slot] ? HighlightStep : -HighlightStep), 0.f, 1.f);
+
+		if (!bSignificance)
+			return;
+
+		FTargetSignificanceInputs Inputs;
+		Inputs.bInRange = (SignificanceFlags[Slot] & SF_InRange) != 0;
+		Inputs.bCurrentTarget = (SignificanceFlags[Slot] & SF_CurrentTarget) != 0;
+
+		for (int32 ViewIndex = 0; ViewIndex < NumViews; ++ViewIndex)
+		{
+			const FSignificanceView& View = ViewData[ViewIndex];
+			const FVector ToTarget = AimPoint - View.Location;
+			const float Distance = ToTarget.Size();
+
+			Inputs.Distance = FMath::Min(Inputs.Distance, Distance);
+			Inputs.bInView |= FVector::DotProduct(View.Forward, ToTarget) >= View.CosHalfFOV * Distance;
+		}
+
+		const float Score = Weights.Score(Inputs);
+
+		int32 Level = 0;
+		while (Level < NumLevels - 1 && Score < Levels[Level].MinScore)
+		{
+			++Level;
+		}
+		NewSignificanceLevels[Slot] = uint8(Level);
+	};
+
+	const bool bSingleThread = NumSlots < CVarTargetingBatchedTickParallelThreshold.GetValueOnGameThread();
+	ParallelFor(NumSlots, TickSlot, bSingleThread);
+
+	if (bSignificance)
+	{
+		ApplySignificance();
+	}
+}
+
+void UTargetingSubsystem::PrepareSignificance(TArray<FSignificanceView, TInlineAllocator<4>>& OutViews)
+{
+	// Every player controller of the world, not only the local ones: a dedicated server has none but runs the AI
+	// of its clients. Their camera managers follow the client cameras.
+	UWorld* World = GetGameInstance()->GetWorld();
+	if (World == nullptr)
+		return;
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		const APlayerCameraManager* CameraManager = PlayerController ? PlayerController->PlayerCameraManager : nullptr;
+		if (CameraManager == nullptr)
+			continue;
+
+		// The horizontal FOV bounds the view frustum, the cone slightly overestimates what is in view.
+		OutViews.Add(FSignificanceView{
+			CameraManager->GetCameraLocation(),
+			CameraManager->GetCameraRotation().Vector(),
+			FMath::Cos(FMath::DegreesToRadians(CameraManager->GetFOVAngle() * 0.5f)) });
+	}
+
+	FMemory::Memzero(Slots.SignificanceFlags.GetData(), Slots.SignificanceFlags.Num());
+
+	for (int32 Index = Cameras.Num() - 1; Index >= 0; --Index)
+	{
+		const UDynamicCameraComponent* Camera = Cameras[Index].Get();
+		if (Camera == nullptr)
+		{
+			Cameras.RemoveAtSwap(Index);
+			continue;
+		}
+
+		for (AActor* Candidate : Camera->ObjectsInRange)
+		{
+			if (const FTargetEntry* Entry = Targets.Find(Candidate))
+			{
+				Slots.SignificanceFlags[Entry->Slot] |= SF_InRange;
+			}
+		}
+
+		if (const FTargetEntry* Entry = Targets.Find(Camera->GetCurrentTarget()))
+		{
+			Slots.SignificanceFlags[Entry->Slot] |= SF_CurrentTarget;
+		}
+	}
+}
+
+void UTargetingSubsystem::ApplySignificance()
+{
+	DYNAMIC_CAMERA_SCOPE(STAT_TargetingApplySignificance);
+
+	// Update rate changes re-register tick functions: only touch the targets whose level changed.
+	for (int32 Slot = 0; Slot < Slots.Num(); ++Slot)
+	{
+		const uint8 Level = Slots.NewSignificanceLevels[Slot];
+		if (Level == Slots.SignificanceLevels[Slot])
+			continue;
+
+		Slots.SignificanceLevels[Slot] = Level;
+		INC_DWORD_STAT(STAT_TargetingSignificanceChanges);
+
+		if (ITargetable* Receiver = Slots.SignificanceReceivers[Slot])
+		{
+			Receiver->ApplySignificance(SignificanceLevels[Level]);
+		}
+	}
+
+	bSignificanceApplied = true;
+}
+
+void UTargetingSubsystem::ResetSignificance()
+{
+	const FTargetSignificanceLevel FullRate;
+
+	for (int32 Slot = 0; Slot < Slots.Num(); ++Slot)
+	{
+		if (Slots.SignificanceLevels[Slot] == UnknownSignificanceLevel)
+			continue;
+
+		Slots.SignificanceLevels[Slot] = UnknownSignificanceLevel;
+		Slots.NewSignificanceLevels[Slot] = UnknownSignificanceLevel;
+
+		if (ITargetable* Receiver = Slots.SignificanceReceivers[Slot])
+		{
+			Receiver->ApplySignificance(FullRate);
+		}
+	}
+
+	bSignificanceApplied = false;
+}
+
+bool UTargetingSubsystem::IsTickable() const
+{
+	// Cameras without targets still close their budget frames here.
+	return Slots.Num() > 0 || Cameras.Num() > 0;
+}
+
+ETickableTickType UTargetingSubsystem::GetTickableTickType() const
+{
+	return HasAnyFlags(RF_ClassDefaultObject) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UTargetingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTargetingSubsystem, STATGROUP_Tickables);
+}
+
+template<typename VisitorType>
+void UTargetingSubsystem::ForEachItemInRadius(const FVector& Origin, float Radius, VisitorType&& Visitor) const
+{
+	const FIntPoint MinCell = GetCell(Origin - FVector(Radius, Radius, 0.f));
+	const FIntPoint MaxCell = GetCell(Origin + FVector(Radius, Radius, 0.f));
+
+	// Sparse worlds: walking the occupied cells is cheaper than probing every cell of the query box.
+	const int64 BoxCellCount = int64(MaxCell.X - MinCell.X + 1) * int64(MaxCell.Y - MinCell.Y + 1);
+	if (BoxCellCount > Cells.Num())
+	{
+		for (const TPair<FIntPoint, TArray<FCellItem>>& Cell : Cells)
+		{
+			if (Cell.Key.X < MinCell.X || Cell.Key.X > MaxCell.X || Cell.Key.Y < MinCell.Y || Cell.Key.Y > MaxCell.Y)
+				continue;
+
+			for (const FCellItem& Item : Cell.Value)
+			{
+				Visitor(Item);
+			}
+		}
+		return;
+	}
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			if (const TArray<FCellItem>* Items = Cells.Find(FIntPoint(X, Y)))
+			{
+				for (const FCellItem& Item : *Items)
+				{
+					Visitor(Item);
+				}
+			}
+		}
+	}
+}
+
+void UTargetingSubsystem::QueryRadius(const FVector& Origin, float Radius, TArray<AActor*>& OutTargets, const AActor* Ignore) const
+{
+	const float RadiusSquared = Radius * Radius;
+
+	ForEachItemInRadius(Origin, Radius, [&](const FCellItem& Item)
+	{
+		if (Item.Actor != Ignore && FVector::DistSquared(Item.Location, Origin) <= RadiusSquared)
+		{
+			OutTargets.Add(Item.Actor);
+		}
+	});
+}
+
+void UTargetingSubsystem::QueryCone(const FVector& Origin, const FVector& Direction, float HalfAngleDegrees, float Radius, TArray<AActor*>& OutTargets, const AActor* Ignore) const
+{
+	const float RadiusSquared = Radius * Radius;
+	const float CosHalfAngle = FMath::Cos(FMath::DegreesToRadians(HalfAngleDegrees));
+	const FVector Forward = Direction.GetSafeNormal();
+
+	ForEachItemInRadius(Origin, Radius, [&](const FCellItem& Item)
+	{
+		if (Item.Actor == Ignore)
+			return;
+
+		const FVector ToItem = Item.Location - Origin;
+		const float DistanceSquared = ToItem.SizeSquared();
+		if (DistanceSquared > RadiusSquared)
+			return;
+
+		// Compare against cos without normalizing: dot >= cos * |ToItem|.
+		if (FVector::DotProduct(Forward, ToItem) >= CosHalfAngle * FMath::Sqrt(DistanceSquared))
+		{
+			OutTargets.Add(Item.Actor);
+		}
+	});
+}
+
+FIntPoint UTargetingSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UTargetingSubsystem::AddToCell(const FIntPoint& Cell, AActor* Target, const FVector& Location)
+{
+	Cells.FindOrAdd(Cell).Add(FCellItem{ Target, Location });
+}
+
+void UTargetingSubsystem::RemoveFromCell(const FIntPoint& Cell, AActor* Target)
+{
+	TArray<FCellItem>* Items = Cells.Find(Cell);
+	if (Items == nullptr)
+		return;
+
+	const int32 ItemIndex = Items->IndexOfByPredicate([Target](const FCellItem& Item) { return Item.Actor == Target; });
+	if (ItemIndex != INDEX_NONE)
+	{
+		Items->RemoveAtSwap(ItemIndex, 1, false);
+	}
+
+	if (Items->Num() == 0)
+	{
+		Cells.Remove(Cell);
+	}
+}
+
+void UTargetingSubsystem::OnTargetMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	AActor* Target = UpdatedComponent->GetOwner();
+	FTargetEntry* Entry = Targets.Find(Target);
+	if (Entry == nullptr)
+		return;
+
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	const FIntPoint NewCell = GetCell(Location);
+
+	if (NewCell != Entry->Cell)
+	{
+		RemoveFromCell(Entry->Cell, Target);
+		AddToCell(NewCell, Target, Location);
+		Entry->Cell = NewCell;
+		return;
+	}
+
+	// Same cell: only refresh the cached location.
+	if (TArray<FCellItem>* Items = Cells.Find(NewCell))
+	{
+		if (FCellItem* Item = Items->FindByPredicate([Target](const FCellItem& CellItem) { return CellItem.Actor == Target; }))
+		{
+			Item->Location = Location;
+		}
+	}
+}
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Components/SceneComponent.h"
+#include "Tickable.h"
+#include "TargetSignificance.h"
+#include "TargetingSharedViews.h"
+#include "TargetVisibilityTable.h"
+#include "TargetHandle.h"
+#include "TargetingSubsystem.generated.h"
+
+class ITargetable;
+class UDynamicCameraComponent;
+class UTargetableComponent;
+
+/// A target left the index: unregistered, released to its pool or its actor ended play. Its handle does not resolve anymore.
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnTargetRemoved, FTargetHandle, AActor*);
+
+/**
+ * Registry of every ITargetable actor of the world, bucketed in a uniform 2D spatial hash.
+ * A target is only re-hashed when its root component moves, so cameras can gather candidates
+ * with a radius or cone query instead of listening to a physics overlap sphere.
+ *
+ * Targets do not tick themselves: their per-frame work (aim point, lock highlight) runs here in one batched tick
+ * over contiguous slots, in parallel above Targeting.BatchedTick.ParallelThreshold. The same pass scores the
+ * significance of each target (distance, view, camera range, current target) and throttles its update rates.
+ *
+ * The tick counts in the targeting budget governor (FTargetingBudget), which closes its frame on FCoreDelegates::OnEndFrame.
+ *
+ * Cameras hold targets through generation-checked FTargetHandle rather than actor pointers. Targets leave the index
+ * as soon as their actor ends play, and OnTargetRemoved lets the cameras drop them in O(1) instead of polling IsValid.
+ *
+ * UE 4.22 has no world subsystems: this lives on the game instance, which owns a single world at a time.
+ */
+UCLASS(config = Game)
+class MAXENCE_SANDBOX_API UTargetingSubsystem : public UGameInstanceSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Returns the targeting subsystem of the world context, if any. */
+	static UTargetingSubsystem* Get(const UObject* WorldContextObject);
+
+	/** Whether cameras should query the spatial index instead of their range sphere (Targeting.UseSpatialIndex). */
+	static bool IsSpatialIndexEnabled();
+
+	void Initialize(FSubsystemCollectionBase& Collection) override;
+	void Deinitialize() override;
+
+	/** Adds a target to the index. Called by targetables at BeginPlay. */
+	/// <param name="AimOffset">Point the cameras look at, relative to the target root.</param>
+	UFUNCTION(BlueprintCallable, Category = "Targeting")
+		void RegisterTarget(AActor* Target, FVector AimOffset = FVector::ZeroVector);
+
+	/// Adds the owner of Targetable to the index with the component aim socket and priority.
+	void RegisterTargetable(UTargetableComponent* Targetable);
+
+	/** Removes a target from the index, e.g. when it dies before its actor goes away. Targets are removed at EndPlay anyway. */
+	UFUNCTION(BlueprintCallable, Category = "Targeting")
+		void UnregisterTarget(AActor* Target);
+
+	/// Handle of a registered target, the null handle otherwise.
+	FTargetHandle GetHandle(const AActor* Target) const;
+
+	/// Registered target of Handle, nullptr once it left the index. O(1).
+	AActor* Resolve(FTargetHandle Handle) const;
+
+	/// Broadcast after a target left the index.
+	FOnTargetRemoved OnTargetRemoved;
+
+	/// Gathers every registered target within Radius of Origin.
+	/// <param name="Ignore">Actor to skip (usually the querying camera owner).</param>
+	void QueryRadius(const FVector& Origin, float Radius, TArray<AActor*>& OutTargets, const AActor* Ignore = nullptr) const;
+
+	/// Gathers every registered target within Radius of Origin and HalfAngleDegrees of Direction.
+	void QueryCone(const FVector& Origin, const FVector& Direction, float HalfAngleDegrees, float Radius, TArray<AActor*>& OutTargets, const AActor* Ignore = nullptr) const;
+
+	bool IsRegistered(const AActor* Target) const;
+
+	int32 GetNumTargets() const { return Targets.Num(); }
+
+	/// Registered targets, in batched tick order.
+	const TArray<AActor*>& GetTargets() const { return Slots.Actors; }
+
+	/// Targetable component of a registered target, nullptr for ITargetable only actors.
+	UTargetableComponent* GetTargetable(const AActor* Target) const;
+
+	/// Aim point, priority and seconds since the last lock of Target, in one lookup.
+	/// <returns>false if Target is not registered.</returns>
+	bool GetScoringInputs(const AActor* Target, FVector& OutAimPoint, float& OutPriority, float& OutTimeSinceLocked) const;
+
+	/// World point the cameras look at, refreshed by the batched tick. Falls back to the actor location when not registered.
+	FVector GetAimPoint(const AActor* Target) const;
+
+	/// Flags the target as locked by a camera, its lock highlight blends towards 1.
+	void SetTargetLocked(const AActor* Target, bool bLocked);
+
+	/// Gather and visibility views shared by the cameras of the world.
+	FTargetingSharedViews& GetSharedViews() { return SharedViews; }
+
+	/// Baked visibility of the current map, mapped on first use. nullptr when the map has no bake or Targeting.VisibilityTable is 0.
+	const FTargetVisibilityTable* GetVisibilityTable();
+
+	/// Cameras whose current target and candidates raise the significance of the targets.
+	void RegisterCamera(UDynamicCameraComponent* Camera);
+	void UnregisterCamera(UDynamicCameraComponent* Camera);
+
+	/** Lock highlight blend of the target in [0, 1], for materials that used to be driven from the target tick. */
+	UFUNCTION(BlueprintPure, Category = "Targeting")
+		float GetLockHighlight(const AActor* Target) const;
+
+	// FTickableGameObject
+	void Tick(float DeltaTime) override;
+	bool IsTickable() const override;
+	ETickableTickType GetTickableTickType() const override;
+	TStatId GetStatId() const override;
+
+protected:
+	/** Size of a hash cell in world units. Should be in the order of the typical query radius / 4. */
+	UPROPERTY(config)
+		float CellSize = 1250.f;
+
+	/** Lock highlight blend speed, in full blends per second. */
+	UPROPERTY(config)
+		float LockHighlightSpeed = 8.f;
+
+	/** Significance score weights. */
+	UPROPERTY(config)
+		FTargetSignificanceWeights SignificanceWeights;
+
+	/** Update rates per significance level, from the highest MinScore down. Empty disables the significance. */
+	UPROPERTY(config)
+		TArray<FTargetSignificanceLevel> SignificanceLevels;
+
+private:
+	struct FCellItem
+	{
+		AActor* Actor;
+		FVector Location;
+	};
+
+	struct FTargetEntry
+	{
+		FIntPoint Cell;
+		FDelegateHandle MovedHandle;
+
+		/** Index of the target in the batched tick slots. */
+		int32 Slot;
+
+		FTargetHandle Handle;
+	};
+
+	/** Slot of the handle table. */
+	struct FHandleSlot
+	{
+		AActor* Actor = nullptr;
+		uint32 Generation = 1;
+	};
+
+	/** Batched tick data, structure of arrays indexed by FTargetEntry::Slot. */
+	struct FTargetSlots
+	{
+		TArray<AActor*> Actors;
+		TArray<UTargetableComponent*> Targetables;
+		TArray<USceneComponent*> Roots;
+		TArray<USceneComponent*> AimComponents;
+		TArray<FName> AimSockets;
+		TArray<FVector> AimOffsets;
+		TArray<float> Priorities;
+		TArray<FVector> AimPoints;
+		TArray<float> LockHighlights;
+		TArray<bool> Locked;
+		TArray<double> LastLockTimes;
+
+		/** Significance receiver (the target itself when native), current level and camera flags. */
+		TArray<ITargetable*> SignificanceReceivers;
+		TArray<uint8> SignificanceLevels;
+		TArray<uint8> SignificanceFlags;
+		TArray<uint8> NewSignificanceLevels;
+
+		int32 Add(AActor* Actor, const FVector& AimOffset);
+
+		/// Fills Slot from the component settings.
+		void SetTargetable(int32 Slot, UTargetableComponent* Targetable);
+
+		/// Swap removes Slot: the last slot moves into it.
+		void RemoveAtSwap(int32 Slot);
+
+		void Empty();
+
+		int32 Num() const { return Actors.Num(); }
+	};
+
+	/** Point of view the significance is scored from. */
+	struct FSignificanceView
+	{
+		FVector Location;
+		FVector Forward;
+		float CosHalfFOV;
+	};
+
+	enum ESignificanceFlags : uint8
+	{
+		SF_InRange = 1 << 0,
+		SF_CurrentTarget = 1 << 1
+	};
+
+	static constexpr uint8 UnknownSignificanceLevel = MAX_uint8;
+
+	/** Gathers the player views and flags the targets known by the registered cameras. */
+	void PrepareSignificance(TArray<FSignificanceView, TInlineAllocator<4>>& OutViews);
+
+	/** Applies the levels picked by the batched tick where they changed. */
+	void ApplySignificance();
+
+	/** Restores the highest level on every target, when the significance is switched off. */
+	void ResetSignificance();
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	void AddToCell(const FIntPoint& Cell, AActor* Target, const FVector& Location);
+	void RemoveFromCell(const FIntPoint& Cell, AActor* Target);
+
+	void OnTargetMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	UFUNCTION()
+		void OnTargetEndPlay(AActor* Target, EEndPlayReason::Type EndPlayReason);
+
+	/// Takes a slot of the handle table for Target.
+	FTargetHandle AllocateHandle(AActor* Target);
+
+	/// Frees the slot of Handle and bumps its generation.
+	void ReleaseHandle(FTargetHandle Handle);
+
+	/** Calls Visitor on every item of the cells overlapping the query circle. */
+	template<typename VisitorType>
+	void ForEachItemInRadius(const FVector& Origin, float Radius, VisitorType&& Visitor) const;
+
+	TMap<AActor*, FTargetEntry> Targets;
+	TMap<FIntPoint, TArray<FCellItem>> Cells;
+
+	FTargetSlots Slots;
+
+	/// Handle table, slots are recycled through FreeHandles.
+	TArray<FHandleSlot> Handles;
+	TArray<uint32> FreeHandles;
+
+	TArray<TWeakObjectPtr<UDynamicCameraComponent>> Cameras;
+
+	FTargetingSharedViews SharedViews;
+
+	/// Baked visibility table, the map and the world it was looked up for.
+	FTargetVisibilityTable VisibilityTable;
+	FString VisibilityTableMap;
+	TWeakObjectPtr<UWorld> VisibilityTableWorld;
+
+	/// Whether the significance levels currently throttle the targets.
+	bool bSignificanceApplied = false;
+};